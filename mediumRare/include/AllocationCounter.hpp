@@ -0,0 +1,21 @@
+#pragma once
+
+#include "types.hpp"
+
+// Debug builds replace the global operator new/delete to count heap allocations (see AllocationCounter.cpp).
+// Define MR_TRACK_ALLOCATIONS=0 to turn it off, or =1 to turn it on in release builds
+#if !defined(MR_TRACK_ALLOCATIONS)
+#	if defined(NDEBUG)
+#		define MR_TRACK_ALLOCATIONS 0
+#	else
+#		define MR_TRACK_ALLOCATIONS 1
+#	endif
+#endif
+
+namespace mr {
+	constexpr bool kAllocationTrackingEnabled = MR_TRACK_ALLOCATIONS != 0;
+
+	// Number of calls to the global operator new since the start of the program, always 0 if tracking is disabled.
+	// Take the difference of two calls to get the number of allocations in between
+	u64 GetNumAllocations();
+}
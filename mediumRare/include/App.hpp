@@ -3,9 +3,11 @@
 #include "types.hpp"
 #include "RendererOptions.hpp"
 #include "Pipeline.hpp"
+#include "FrameAllocator.hpp"
 
 #include <lvk/HelpersImGui.h>
 #include <lvk/LVK.h>
+#include <implot/implot.h>
 
 #include <GLFW/glfw3.h>
 
@@ -29,9 +31,17 @@ namespace mr {
 	const vec3 kInitialCameraTarget = vec3( 0.0f, 0.5f,  0.0f );
 	const vec3 kInitialCameraAngles = vec3( -18.5f, 180.0f, 0.0f );
 
+	struct AppConfig {
+		bool headless       = false; // no window and no swapchain, frames are rendered into an offscreen present texture
+		bool softwareDevice = false; // prefer a CPU Vulkan implementation (lavapipe), only used in headless mode
+		u32  width          = 1920;  // only used in headless mode
+		u32  height         = 1080;
+		f32  fixedDeltaSeconds = 0.0f; // use this instead of the measured frame time if > 0
+	};
+
 	class App final {
 	public:
-		explicit App( std::string skyboxTexFilename = "../../data/immenstadter_horn_2k_prefilter.ktx", std::string skyboxIrrFilename = "../../data/immenstadter_horn_2k_irradiance.ktx" );
+		explicit App( const AppConfig &cfg = {}, std::string skyboxTexFilename = "../../data/immenstadter_horn_2k_prefilter.ktx", std::string skyboxIrrFilename = "../../data/immenstadter_horn_2k_irradiance.ktx" );
 		virtual ~App();
 
 		virtual void run( std::function<void( u32 width, u32 height, f32 aspectRatio, f32 deltaSeconds )> );
@@ -47,13 +57,29 @@ namespace mr {
 
 		bool IsMSAAEnabled( void ) const { return _numSamples > 1; }
 
+		// Swapchain image or the offscreen texture that replaces it in headless mode
+		lvk::TextureHandle getPresentTexture( void ) const { return config.headless ? lvk::TextureHandle( presentTexture ) : ctx->getCurrentSwapchainTexture(); }
+		lvk::Format getPresentFormat( void ) const         { return config.headless ? ctx->getFormat( presentTexture ) : ctx->getSwapchainFormat(); }
+		lvk::SubmitHandle submitFrame( lvk::ICommandBuffer &buf );
+
+		void requestExit( void ) { exitRequested = true; }
+
+		// Something outside of the input and the camera changed (animations, streaming), draw the next frame
+		void requestRedraw( void ) { redrawRequested = true; }
+
 	public:
+		const AppConfig                     config;
 		GLFWwindow                          *window = nullptr;
 		std::unique_ptr<lvk::IContext>      ctx;
 		lvk::Holder<lvk::TextureHandle>     depthTexture;
+		lvk::Holder<lvk::TextureHandle>     presentTexture; // headless mode only
 		std::unique_ptr<lvk::ImGuiRenderer> imgui;
+		ImPlotContext                       *implotCtx = nullptr;
 
 		FramesPerSecondCounter fpsCounter = FramesPerSecondCounter( 0.5f );
+		FrameArena             frameArena; // reset before every frame
+		OnDemandRendering      onDemand;
+		LowLatencyMode         lowLatency;
 
 		struct MouseState {
 			vec2 pos         = vec2( 0.0f );
@@ -72,9 +98,28 @@ namespace mr {
 
 		u32 _numSamples = 1;
 
+		static constexpr u32 kMaxFramesInFlight = 3;
+
 	protected:
+		f64 getTimeSeconds( void ) const;
+		void waitForFrameInFlight( void );
+		void createDepthTexture( u32 width, u32 height );
+
+		// Submitted frames, indexed by frame number modulo kMaxFramesInFlight
+		struct SubmittedFrame {
+			lvk::SubmitHandle handle;
+			f64               inputTime = 0.0; // when the input of this frame was sampled
+		};
+		SubmittedFrame submittedFrames[kMaxFramesInFlight];
+		u64            numSubmittedFrames  = 0;
+		u64            numMeasuredFrames   = 0; // the frames before it were waited for and measured once
+		f64            inputTime           = 0.0;
+		f64            maxLatencyResetTime = 0.0;
+
 		std::vector<GLFWmousebuttonfun> mouseButtonCallbacks;
 		std::vector<GLFWkeyfun>         keyCallbacks;
+		bool                            exitRequested   = false;
+		bool                            redrawRequested = true; // set by the input callbacks and requestRedraw()
 
 	public:
 		// Grid
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "types.hpp"
+#include "GPUProfiler.hpp"
+#include "CameraPath.hpp"
+
+#include <vector>
+
+namespace mr {
+	struct BenchmarkConfig {
+		bool        enabled           = false;
+		bool        softwareDevice    = false;
+		u32         width             = 1920;
+		u32         height            = 1080;
+		u32         warmupFrames      = 60;  // not measured: pipeline creation, shadow map, eye adaptation, ...
+		u32         numFrames         = 0;   // measured frames, 0: 600 for the built-in path, the whole recorded path otherwise
+		f32         fixedDeltaSeconds = 1.0f / 60.0f;
+		const char *outputFileName    = "benchmark.json";
+
+		// recorded with the camera path panel, replaces the built-in path over Bistro
+		const char                 *cameraPathFileName   = nullptr;
+		std::vector<CameraPathKey> cameraPath;
+		bool                       cameraPathHasOptions = false;
+
+		// option sweep instead of a single configuration, see OptionSweep
+		const char *sweepFactors        = nullptr; // "all" (one factor at a time) or a comma separated list of factor names
+		u32         sweepViewpoints     = 5;
+		u32         sweepSettleFrames   = 16;      // after every change of combination or viewpoint: pipelines, eye adaptation, ...
+		u32         sweepMeasuredFrames = 32;
+		const char *sweepPass           = nullptr; // comma separated GPUProfiler scopes summed next to the frame time, e.g. "Mesh,Impostors"
+
+		// 12-byte quantized vertices instead of 20-byte float ones, see quantizeVertices().
+		// The size of the loaded vertex data is filled in by the application and written into the report
+		bool quantizedVertices = false;
+		u64  vertexDataSize    = 0;
+
+		// The vertex shaders of the mesh pipelines fetch and decode the vertices from the vertex buffer themselves,
+		// instead of the vertex input state, see VertexInput.sp
+		bool vertexPulling = false;
+
+		// Cell size of the static batching in world units, see batchStaticNodes(). The mesh cache is rebuilt when it changes.
+		// 0 uses one cell for the whole scene, a negative size turns the batching off
+		f32 batchCellSize = 20.0f;
+		// The same for the alpha-tested nodes, batched apart so that the batches stay about the size of a tree for the impostors
+		f32 batchAlphaTestedCellSize = 5.0f;
+
+		// Measures the CPU occlusion culling over a grid of views and exits before the device is created, see OcclusionCuller
+		bool occlusionBenchmark = false;
+
+		// Bakes the potentially visible sets into the cache and exits before the device is created, see PVS
+		bool bakePVS = false;
+
+		// Renders the shadow map every frame instead of only when the light changes, so that the benchmark and the sweep
+		// measure the shadow pass too
+		bool shadowEveryFrame = false;
+	};
+
+	// --benchmark [--benchmark-output <file.json>] [--benchmark-frames <n>] [--benchmark-size <w>x<h>] [--camera-path <file>] [--software]
+	// --sweep <all|factor,factor,...> [--sweep-viewpoints <n>] [--sweep-frames <n>] [--sweep-pass <scope,scope,...>] implies --benchmark
+	// --quantized-vertices
+	// --vertex-pulling
+	// --batch-cell-size <size>
+	// --occlusion-benchmark
+	// --bake-pvs
+	// --shadow-every-frame
+	// Returns false and prints the usage on invalid arguments, the camera path is loaded here
+	bool ParseBenchmarkArgs( int argc, char *argv[], BenchmarkConfig &cfg );
+
+	// Deterministic benchmark run: every frame advances the camera path and the simulation by the same fixed time step,
+	// so two runs of the same build render exactly the same frames.
+	// GPU timings come from the GPUProfiler and arrive GPUProfiler::kFramesInFlight frames late,
+	// the run is finished once both the CPU and the GPU samples of all measured frames have been collected.
+	class Benchmark final {
+	public:
+		explicit Benchmark( const BenchmarkConfig &cfg );
+
+		// Places the camera for the frame about to be rendered and restores the recorded renderer options, if any
+		void beginFrame( bool *options );
+		CameraPositioner_Path &getCameraPositioner() { return _path; }
+
+		// Call once per frame after submitting it
+		void addFrame( f32 cpuMs, u32 numDraws, u64 numTriangles, u64 numAllocations, const GPUProfiler &profiler );
+
+		bool isFinished() const { return _gpuFrameMs.size() >= _numFrames && _cpuMs.size() >= _numFrames; }
+
+		// Measured frames must not allocate on the heap (only checked when allocation tracking is compiled in)
+		bool hasFailed() const  { return _numFramesWithAllocations > 0; }
+
+		// The enabled renderer options are written into the report to identify the configuration. The GPU times of the triangle
+		// culling in the main and in the shadow pass are compared in the report and printed
+		bool writeJSON( const bool *options, u32 numOptions ) const;
+
+	private:
+		struct Series {
+			const char      *name  = nullptr;
+			u32              depth = 0;
+			std::vector<f32> samples;
+		};
+
+		// nullptr if the pass never ran
+		const Series *findPass( const char *name ) const;
+
+		const BenchmarkConfig _cfg;
+		u32                   _numFrames = 0;
+		CameraPositioner_Path _path;
+
+		u64 _frameIndex         = 0; // frames rendered so far, including the warm-up
+		u64 _numResolvedFrames  = 0;
+		f64 _lastFrameTimestamp = 0.0;
+
+		std::vector<f32> _cpuMs;       // CPU time spent recording and submitting the frame
+		std::vector<f32> _frameMs;     // wall time between two frames, includes waiting for the GPU
+		std::vector<f32> _gpuFrameMs;
+		std::vector<u32> _numDraws;
+		std::vector<u64> _numTriangles;
+		std::vector<Series> _passes;   // indexed like the scopes of the GPUProfiler
+
+		u32 _numFramesWithAllocations = 0;
+		u64 _numAllocations           = 0;
+	};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "types.hpp"
+#include "RendererOptions.hpp"
+
+#include <shared/Camera.h>
+
+#include <vector>
+
+namespace mr {
+	static_assert( RendererOption::MAX <= 32, "Renderer options must fit into CameraPathKey::userFlags" );
+
+	u32  PackRendererOptions( const bool *options );
+	void UnpackRendererOptions( u32 mask, bool *options );
+
+	// Binary track: a small header followed by one 36-byte record per key (time, position, orientation, options).
+	// The options of a track recorded with a different set of RendererOption are ignored on load (hasOptions = false)
+	bool SaveCameraPath( const char *fileName, const std::vector<CameraPathKey> &keys );
+	bool LoadCameraPath( const char *fileName, std::vector<CameraPathKey> &keys, bool &hasOptions );
+
+	// Samples the active camera and the renderer options once per frame
+	class CameraPathRecorder final {
+	public:
+		void start();
+		void stop()               { _recording = false; }
+		bool isRecording() const  { return _recording; }
+
+		void addFrame( f32 deltaSeconds, const mat4 &view, const vec3 &position, const bool *options );
+
+		const std::vector<CameraPathKey> &getKeys() const { return _keys; }
+
+	private:
+		std::vector<CameraPathKey> _keys;
+		f32                        _time      = 0.0f;
+		bool                       _recording = false;
+	};
+
+	struct CameraPathPlayback {
+		bool playing      = false;
+		bool fixedRate    = false;         // advance by fixedDeltaSeconds every frame instead of the measured frame time
+		f32  fixedDeltaSeconds = 1.0f / 60.0f;
+		bool applyOptions = true;          // restore the recorded renderer options
+		bool hasOptions   = false;
+		char fileName[256] = "camera.path";
+	};
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <lvk/LVK.h>
+
+#include "types.hpp"
+#include "GPUProfiler.hpp"
+
+namespace mr {
+	// Adjusts the render scale to hit a target GPU frame time. The GPU cost is roughly proportional to the number of pixels,
+	// so the controller drives the pixel ratio (scale squared) with an incremental PID on the relative frame time error.
+	// The GPU times arrive GPUProfiler::kFramesInFlight frames late, hence the small gains and the dead band
+	class DynamicResolution final {
+	public:
+		struct Params {
+			bool enabled   = false;
+			f32  targetMs  = 16.0f;
+			f32  minScale  = 0.5f;
+			f32  maxScale  = 1.0f;
+			f32  kp        = 0.10f;
+			f32  ki        = 0.05f;
+			f32  kd        = 0.02f;
+			f32  deadBand  = 0.03f; // relative error that is ignored
+			f32  sharpness = 0.2f;  // stops of sharpening reduction, 0 is the strongest
+		} params;
+
+		// Call once per frame after GPUProfiler::beginFrame(), uses the frame resolved by it if any
+		void update( const GPUProfiler &profiler );
+
+		f32 getScale() const { return params.enabled ? _scale : 1.0f; }
+
+		// Rounded to multiples of 8 pixels so that small changes of the scale do not touch every frame
+		lvk::Dimensions getRenderSize( const lvk::Dimensions &size ) const;
+
+	private:
+		f32 _scale      = 1.0f;
+		f32 _pixelRatio = 1.0f;
+		f32 _error[2]   = {}; // previous errors for the incremental form
+		u64 _numResolvedFrames = 0;
+	};
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <lvk/LVK.h>
+
+#include "types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace mr {
+	// Fixed-capacity vector for frame-scoped data: the storage is inline, nothing is ever allocated
+	template <typename T, u32 Capacity>
+	class FixedVector final {
+	public:
+		void clear()                    { _size = 0; }
+		void push_back( const T &value ) {
+			LVK_ASSERT( _size < Capacity );
+			if ( _size < Capacity )
+				_data[_size++] = value;
+		}
+
+		u32  size() const              { return _size; }
+		bool empty() const             { return _size == 0; }
+		static constexpr u32 capacity() { return Capacity; }
+
+		T       &operator[]( u32 i )       { return _data[i]; }
+		const T &operator[]( u32 i ) const { return _data[i]; }
+
+		T       *begin()       { return _data; }
+		T       *end()         { return _data + _size; }
+		const T *begin() const { return _data; }
+		const T *end() const   { return _data + _size; }
+
+	private:
+		T   _data[Capacity] = {};
+		u32 _size           = 0;
+	};
+
+	// Linear allocator reset at the start of every frame: the backing memory is allocated once, allocations are a pointer bump,
+	// nothing is freed individually. Only for trivially destructible data that does not outlive the frame
+	class FrameArena final {
+	public:
+		explicit FrameArena( size_t capacity = 256 * 1024 ) : _memory( std::make_unique<u8[]>( capacity ) ), _capacity( capacity ) {}
+
+		void reset() {
+			_highWaterMark = std::max( _highWaterMark, _offset );
+			_offset        = 0;
+		}
+
+		void *allocate( size_t size, size_t alignment = alignof(std::max_align_t) ) {
+			const size_t offset = ( _offset + alignment - 1 ) & ~( alignment - 1 );
+			if ( offset + size > _capacity ) {
+				LVK_ASSERT_MSG( false, "FrameArena is full" );
+				return nullptr;
+			}
+			_offset = offset + size;
+			return _memory.get() + offset;
+		}
+
+		template <typename T>
+		T *allocateArray( size_t count ) {
+			static_assert( std::is_trivially_destructible_v<T> );
+			return static_cast<T*>( allocate( count * sizeof(T), alignof(T) ) );
+		}
+
+		// printf into the arena, the string is valid until the next reset()
+		const char *format( const char *fmt, ... ) {
+			va_list args;
+			va_start( args, fmt );
+			va_list argsCopy;
+			va_copy( argsCopy, args );
+			const s32 length = vsnprintf( nullptr, 0, fmt, argsCopy );
+			va_end( argsCopy );
+
+			char *str = length >= 0 ? allocateArray<char>( length + 1 ) : nullptr;
+			if ( str )
+				vsnprintf( str, length + 1, fmt, args );
+			va_end( args );
+			return str ? str : "";
+		}
+
+		size_t getUsed() const          { return _offset; }
+		size_t getHighWaterMark() const { return std::max( _highWaterMark, _offset ); }
+		size_t getCapacity() const      { return _capacity; }
+
+	private:
+		std::unique_ptr<u8[]> _memory;
+		size_t                _capacity      = 0;
+		size_t                _offset        = 0;
+		size_t                _highWaterMark = 0;
+	};
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types.hpp"
+#include "Impostors.hpp"
+
+#include <vector>
+
+namespace mr {
+	// Everything the recording of a frame needs from the simulation. Two of them are kept: while the main thread
+	// records and submits frame N from one, the simulation thread fills the other one for frame N+1
+	struct FrameState {
+		// Inputs, captured on the main thread before the simulation starts
+		glm::mat4   view = glm::mat4( 1.0f );
+		glm::mat4   proj = glm::mat4( 1.0f );
+		LightParams light;
+		bool        cullingCPU       = false;
+		bool        hlod             = false;
+		bool        impostors        = false;
+		bool        occlusionCulling = false; // on top of cullingCPU, see OcclusionCuller
+		bool        pvs              = false;
+		bool        triangleCulling  = false;
+		f32         projScale        = 1.0f;  // viewport height in pixels / 2 tan(fovY / 2), for the screen space error of the HLOD proxies
+
+		// Outputs
+		glm::mat4        lightView = glm::mat4( 1.0f );
+		glm::mat4        lightProj = glm::mat4( 1.0f );
+		glm::vec3        lightDir  = glm::vec3( 0.0f );
+		std::vector<u32> instanceCounts;          // 0 or 1 per instance of VkMesh, only written with CPU culling, PVS, HLOD or impostors
+		std::vector<BoundingBox> instanceBoxes;   // world space, per instance of VkMesh, written with instanceCounts
+		std::vector<Impostors::Instance> impostorInstances; // reserved for all candidates, so the simulation never allocates
+		u64              impostorSelection = 0;   // see Impostors::getSelectionHash()
+		std::vector<u32> triangleCullInstances;   // candidates of TriangleCuller, reserved for all of them
+		std::vector<glm::mat4> globalTransforms;  // of the scene, the simulation owns it while it runs and the recording reads this copy
+		u64              transformsVersion = 0;   // changes with globalTransforms
+		u32              numVisibleMeshes    = 0;
+		u64              numVisibleTriangles = 0;
+		f32              simulationMs        = 0.0f;
+	};
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <lvk/LVK.h>
+
+#include "types.hpp"
+
+#include <array>
+#include <stdio.h>
+
+namespace mr {
+	// Per-pass GPU timings from timestamp queries written around debug group labels.
+	// Every frame in flight has its own range of queries. A range is read back only when its frame slot comes around again,
+	// i.e. kFramesInFlight frames later, after waiting on the submit handle of that frame which has completed by then,
+	// so reading the results never stalls the CPU. Nothing is allocated after construction.
+	class GPUProfiler final {
+	public:
+		static constexpr u32 kMaxScopes         = 32;  // distinct scope names
+		static constexpr u32 kMaxScopesPerFrame = 32;
+		static constexpr u32 kMaxDepth          = 8;
+		static constexpr u32 kFramesInFlight    = 3;
+		static constexpr u32 kHistorySize       = 256; // rolling window for the statistics and the graphs
+		static constexpr u32 kQueriesPerFrame   = 2 * kMaxScopesPerFrame;
+
+		struct Stats {
+			f32 last = 0.0f;
+			f32 min  = 0.0f;
+			f32 avg  = 0.0f;
+			f32 p99  = 0.0f;
+		};
+
+		struct Scope {
+			const char *name  = nullptr;
+			u32         depth = 0;
+			u32         numSamples = 0; // in the history, up to kHistorySize
+			u32         head       = 0; // next write position in the history ring buffer
+			u64         lastFrame  = 0; // last frame that contained this scope
+			std::array<f32, kHistorySize> history = {};
+			Stats       stats;
+		};
+
+		explicit GPUProfiler( lvk::IContext &ctx );
+		~GPUProfiler();
+
+		// Must be called outside of rendering, before any other scope of the frame
+		void beginFrame( lvk::ICommandBuffer &buf );
+		void endFrame( lvk::ICommandBuffer &buf );
+		void frameSubmitted( lvk::SubmitHandle handle );
+
+		// Debug group label + timestamps. The name must outlive the profiler (string literals)
+		void pushScope( lvk::ICommandBuffer &buf, const char *name, u32 colorRGBA = 0xffffffff );
+		void popScope( lvk::ICommandBuffer &buf );
+
+		bool startCSV( const char *fileName );
+		void stopCSV();
+		bool isWritingCSV() const { return _csv != nullptr; }
+
+		u32          getNumScopes() const           { return _numScopes; }
+		const Scope &getScope( u32 i ) const        { return _scopes[i]; }
+		u64          getNumResolvedFrames() const   { return _numResolvedFrames; }
+
+		// Frame scope (the whole command buffer) is always the first one
+		const Scope &getFrameScope() const          { return _scopes[0]; }
+
+	private:
+		struct Entry {
+			u16 scope;
+			u16 queryBegin;
+			u16 queryEnd;
+		};
+
+		struct FrameSlot {
+			lvk::SubmitHandle handle;
+			u64               frameIndex = 0;
+			u32               numQueries = 0;
+			u32               numEntries = 0;
+			bool              pending    = false;
+			std::array<Entry, kMaxScopesPerFrame> entries;
+		};
+
+		u32  findOrAddScope( const char *name, u32 depth );
+		void beginTimestamp( lvk::ICommandBuffer &buf, const char *name );
+		void endTimestamp( lvk::ICommandBuffer &buf );
+		void resolve( FrameSlot &slot );
+		void updateStats( Scope &scope );
+
+		lvk::IContext                   &_ctx;
+		lvk::Holder<lvk::QueryPoolHandle> _queryPool;
+		f64                              _timestampToMs = 0.0;
+
+		std::array<Scope, kMaxScopes>         _scopes;
+		u32                                   _numScopes = 0;
+		std::array<FrameSlot, kFramesInFlight> _slots;
+		u64                                   _frameIndex        = 0;
+		u64                                   _numResolvedFrames = 0;
+
+		// indices into the entries of the current slot, ~0u for scopes that did not fit
+		std::array<u32, kMaxDepth> _stack;
+		u32                        _stackSize = 0;
+
+		std::array<u64, kQueriesPerFrame> _timestamps;
+		std::array<f32, kHistorySize>     _scratch;
+
+		FILE *_csv = nullptr;
+	};
+}
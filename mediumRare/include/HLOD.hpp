@@ -0,0 +1,59 @@
+#pragma once
+
+#include <shared/Scene/Scene.h>
+#include <shared/Scene/VtxData.h>
+
+#include "types.hpp"
+
+#include <vector>
+
+namespace mr {
+	// Hierarchical LOD for distant blocks of the scene. build() clusters the mesh nodes with an octree over their world space boxes
+	// and adds one simplified proxy node per material of every cluster to the scene. At runtime select() draws a cluster as its
+	// proxies once their simplification error gets below the pixel error, and as its original nodes otherwise
+	class HLOD final {
+	public:
+		struct BuildParams {
+			u32 maxNodesPerCluster = 256;   // octree cells with more nodes are split
+			u32 maxDepth           = 5;
+			f32 targetRatio        = 0.05f; // proxy triangles relative to the cluster
+			f32 targetError        = 0.05f; // relative to the extents of the merged geometry, see meshopt_simplify()
+		};
+
+		struct Params {
+			f32 pixelError = 1.0f; // screen space error of the proxies at which they replace their cluster
+		} params;
+
+		struct Cluster {
+			BoundingBox box;        // world space, of the original nodes
+			f32         error;      // world space, the largest simplification error of the proxies
+			u32         firstNode;  // original nodes in _nodes
+			u32         numNodes;
+			u32         firstProxy; // proxy nodes in _nodes
+			u32         numProxies;
+		};
+
+		// Needs float vertices, i.e. runs before quantizeVertices(), and the global transforms and bounding boxes of the scene.
+		// The proxies are new meshes and nodes under the root node, drawn like any other node
+		void build( Scene &scene, MeshData &meshData, const BuildParams &buildParams );
+
+		bool load( const char *fileName );
+		bool save( const char *fileName ) const;
+
+		// visible has one flag per instance, instanceForNode maps the scene nodes to them. Clears the flags of the original nodes
+		// of the clusters drawn as proxies and of the proxies of all others, useProxies = false draws every cluster as its nodes.
+		// projScale is the viewport height in pixels divided by 2 tan(fovY / 2). Returns the number of clusters drawn as proxies
+		u32 select( bool useProxies, const glm::vec3 &cameraPos, f32 projScale, const std::vector<u32> &instanceForNode, u32 *visible ) const;
+
+		// Scene nodes of the proxies of all clusters
+		std::vector<u32> getProxyNodes() const;
+
+		bool empty() const              { return _clusters.empty(); }
+		u32  getNumClusters() const     { return u32( _clusters.size() ); }
+		const Cluster &getCluster( u32 i ) const { return _clusters[i]; }
+
+	private:
+		std::vector<Cluster> _clusters;
+		std::vector<u32>     _nodes;
+	};
+}
@@ -3,12 +3,18 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "RendererOptions.hpp"
+#include "GPUProfiler.hpp"
+#include "CameraPath.hpp"
+#include "FrameAllocator.hpp"
+#include "DynamicResolution.hpp"
 #include "types.hpp"
 #include <span>
 
+#include <shared/UtilsFPS.h>
 #include <shared/Scene/Scene.h>
 #include <shared/Scene/VtxData.h>
 #include <deps/src/ImGuizmo/ImGuizmo.h>
+#include <implot/implot.h>
 
 using TextureCache = std::vector<lvk::Holder<lvk::TextureHandle>>;
 
@@ -17,21 +23,31 @@ namespace mr {
 
 	f32 __computeMaxItemWidth( const char **items, size_t itemsLength );
 
-	ImVec2 ImGuiFPSComponent( const float fps, const ImVec2 pos = { 10, 10 } );
+	ImVec2 ImGuiFPSComponent( const FramesPerSecondCounter &fpsCounter, u64 numFrameAllocations, OnDemandRendering &onDemand, LowLatencyMode &lowLatency,
+		const ImVec2 pos = { 10, 10 } );
+	ImVec2 ImGuiGPUProfilerComponent( GPUProfiler &profiler, const ImVec2 pos = { 10, 10 } );
 	ImVec2 ImGuiCameraControlsComponent( glm::vec3 &cameraPos, glm::vec3 &cameraAngles, bool &changedCameraType, const ImVec2 pos = { 10, 10 } );
+	ImVec2 ImGuiCameraPathComponent( CameraPathRecorder &recorder, CameraPositioner_Path &player, CameraPathPlayback &playback, const ImVec2 pos = { 10, 10 } );
 
 	ImVec2 ImGuiRenderOptionsComponent( std::span<bool> options, const ImVec2 pos = { 10, 10 } );
 
-	s32 __renderSceneTreeUI( const Scene &scene, s32 node, s32 selectedNode );
-	ImVec2 ImGuiSceneGraphComponent( const Scene &scene, s32 &selectedNode, const ImVec2 pos = { 10, 10 } );
+	// Labels are formatted into the frame arena
+	const char *__nodeLabel( const Scene &scene, s32 node, FrameArena &arena );
+	s32 __renderSceneTreeUI( const Scene &scene, s32 node, s32 selectedNode, FrameArena &arena );
+	ImVec2 ImGuiSceneGraphComponent( const Scene &scene, s32 &selectedNode, FrameArena &arena, const ImVec2 pos = { 10, 10 } );
 
 	bool __editTransformUI( const mat4 &view, const mat4 &proj, mat4 &matrix );
 	bool __editMaterialUI( Scene &scene, MeshData &meshData, s32 node, s32 &outUpdateMaterialIndex, const TextureCache &textureCache );
-	ImVec2 ImGuiEditNodeComponent( Scene &scene, MeshData &meshData, const mat4 &view, const mat4 &proj, s32 node, s32 &outUpdateMaterialIndex, const TextureCache &textureCache );
+	// The scene transforms may be recalculated on the simulation thread meanwhile: the gizmo starts from globalTransform, the global
+	// transform of the node as rendered, and an edit is returned in outLocalTransform, to be applied by the caller
+	ImVec2 ImGuiEditNodeComponent( Scene &scene, MeshData &meshData, const mat4 &view, const mat4 &proj, s32 node, const mat4 &globalTransform, bool &outTransformEdited, mat4 &outLocalTransform, s32 &outUpdateMaterialIndex, const TextureCache &textureCache, FrameArena &arena );
 
 	ImVec2 ImGuiLightControlsComponent( LightParams &lightParams, u32 shadowMapIndex, const ImVec2 pos = { 10, 10 } );
 
-	ImVec2 ImGuiSSAOControlsComponent( SSAOpc &pc, CombinePC &comb, s32 &blurPasses, f32 &depthThreshold, u32 ssaoTextureIndex, const ImVec2 pos = { 10, 10 } );
+	bool __blurKernelComboUI( const char *label, BlurKernel &kernel );
+	ImVec2 ImGuiSSAOControlsComponent( SSAOpc &pc, CombinePC &comb, s32 &blurPasses, BlurKernel &blurKernel, f32 &depthThreshold, u32 ssaoTextureIndex, const ImVec2 pos = { 10, 10 } );
 
-	ImVec2 ImGuiBloomToneMapControlsComponent( ToneMapPC &pcHDR, BrightPassPC &brightPassPC, s32 &blurPasses, const ImVec2 pos = { 10, 10 } );
+	ImVec2 ImGuiBloomToneMapControlsComponent( ToneMapPC &pcHDR, BrightPassPC &brightPassPC, LuminancePC &luminancePC, BloomParams &bloom, s32 &blurPasses, BlurKernel &blurKernel, const ImVec2 pos = { 10, 10 } );
+
+	ImVec2 ImGuiDynamicResolutionComponent( DynamicResolution &dynamicResolution, const lvk::Dimensions &renderSize, const lvk::Dimensions &fbSize, const ImVec2 pos = { 10, 10 } );
 }
\ No newline at end of file
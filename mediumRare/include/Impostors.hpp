@@ -0,0 +1,113 @@
+#pragma once
+
+#include <lvk/LVK.h>
+#include <shared/Scene/VtxData.h>
+
+#include "types.hpp"
+#include "Pipeline.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace mr {
+	// Octahedral impostors of the big alpha-tested meshes, i.e. the Bistro trees. bake() renders every such mesh from
+	// kFramesPerSide^2 directions, spread over the sphere by an octahedral mapping, into one tile of two atlases: the albedo with
+	// the coverage in alpha, and the local space normal with the depth along the view direction. Beyond params.distance the instances
+	// of these meshes are drawn as camera facing quads that sample the closest frame, see Impostor.vert
+	class Impostors final {
+	public:
+		static constexpr u32 kFramesPerSide = 8;
+		static constexpr u32 kFrameSize     = 64; // texels
+		static constexpr u32 kTileSize      = kFramesPerSide * kFrameSize;
+		static constexpr u32 kMaxImpostors  = 16;
+		static constexpr u32 kMinTriangles  = 1000; // smaller meshes are cheaper to draw than their impostor
+
+		struct Params {
+			f32 distance  = 50.0f; // world units from the camera to the center of an instance
+			f32 fadeRange = 10.0f; // the impostors dither in over this range in front of distance, the meshes are dropped behind it
+		} params;
+
+		// Per instance drawn as an impostor, read by Impostor.vert
+		struct Instance {
+			u32 transformId;
+			u32 impostor;
+			f32 fade; // coverage of the dithered fade-in
+			u32 padding;
+		};
+
+		// What bake() needs from VkMesh
+		struct BakeInputs {
+			lvk::VertexInput streams;
+			const char      *vertexDefines;
+			u64              bufferDrawData;
+			u64              bufferMaterials;
+			u64              bufferVertexBounds;
+			std::function<void( lvk::ICommandBuffer&, u32 )> drawMesh; // binds the buffers and draws the first instance of a mesh
+		};
+
+		// Picks the meshes, drawNodes are the instances of VkMesh
+		Impostors( const std::unique_ptr<lvk::IContext> &ctx, const MeshData &meshData, const std::vector<DrawNode> &drawNodes );
+
+		// The atlases are KTX files in the texture cache, fileName is the list of meshes they were baked for.
+		// load() fails when the list differs from the meshes picked for the current scene
+		bool load( const char *fileName );
+		void bake( const BakeInputs &inputs );
+		bool save( const char *fileName ) const;
+
+		void createPipelines( lvk::Format colorFormat, lvk::Format depthFormat, u32 numSamples, lvk::Format shadowFormat );
+
+		// visible has one flag per instance of VkMesh. The visible instances of the impostor meshes beyond the fade range are replaced
+		// by impostors: their flags are cleared and they are added to instances. Returns the number of impostors
+		u32 select( bool enabled, const glm::vec3 &cameraPos, const std::vector<glm::mat4> &globalTransforms, u32 *visible,
+			std::vector<Instance> &instances ) const;
+
+		// Changes with the instances replaced by impostors and the dither levels of their fades, not with every step of a fade.
+		// They depend on the camera, and the same instances are drawn into the shadow map, so it is redrawn whenever this changes
+		static u64 getSelectionHash( const std::vector<Instance> &instances );
+
+		// Records the impostors of a frame into the instance buffer, outside of rendering and before draw(). The frames in flight
+		// keep their instances
+		void upload( lvk::ICommandBuffer &buf, const std::vector<Instance> &instances );
+
+		// eye is the camera position with w = 1, or the direction towards the light with w = 0 for the shadow map
+		void draw( lvk::ICommandBuffer &buf, bool shadowPass, const glm::mat4 &viewProj, const glm::vec4 &eye, u64 bufferTransforms,
+			u64 bufferLight, u32 skyboxIrradiance ) const;
+
+		bool empty() const                    { return _meshes.empty(); }
+		u32  getNumMeshes() const             { return u32( _meshes.size() ); }
+		u32  getNumCandidateInstances() const { return u32( _candidates.size() ); }
+		u64  getNumTriangles() const          { return _numTriangles; }
+		u32  getAtlasSize() const             { return _atlasSize; }
+
+	private:
+		// GPU data of one impostor, see Impostor.sp
+		struct ImpostorGPU {
+			glm::vec4 centerRadius; // bounding sphere of the mesh, local space
+			glm::vec4 tile;         // xy: UV of the tile in the atlases, z: UV size of a frame
+		};
+
+		struct Candidate {
+			u32 instance; // of VkMesh
+			u32 node;
+			u32 impostor;
+		};
+
+		const std::unique_ptr<lvk::IContext> &_ctx;
+
+		std::vector<u32>         _meshes; // one impostor per mesh
+		std::vector<ImpostorGPU> _impostors;
+		std::vector<Candidate>   _candidates;
+		u64                      _numTriangles = 0; // of all candidates, LOD 0
+		u32                      _atlasSize    = 0;
+		u32                      _numInstances = 0; // uploaded for this frame
+
+		lvk::Holder<lvk::TextureHandle> _textureAlbedo;
+		lvk::Holder<lvk::TextureHandle> _textureNormalDepth;
+		lvk::Holder<lvk::SamplerHandle> _sampler;
+		lvk::Holder<lvk::BufferHandle>  _bufferImpostors;
+		lvk::Holder<lvk::BufferHandle>  _bufferInstances;
+
+		std::unique_ptr<Pipeline> _pipeline;
+		std::unique_ptr<Pipeline> _pipelineShadow;
+	};
+}
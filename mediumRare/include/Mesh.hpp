@@ -11,6 +11,7 @@
 
 #include <shared/Scene/VtxData.h>
 #include <shared/Scene/Scene.h>
+#include <shared/Utils.h>
 #include <shared/UtilsGLTF.h>
 #include "types.hpp"
 #include "Pipeline.hpp"
@@ -43,13 +44,25 @@ public:
 		_ctx->upload( _bufferIndirect, _drawCommands.data(), sizeof(VkDrawIndexedIndirectCommand) * numCommands, sizeof(u32) );
 	}
 
-	void selectTo( IndirectBuffer &buf, const std::function<bool( const DrawIndexedIndirectCommand& )> &pred ) const {
+	// Recorded into the frame, outside of rendering, so the frames in flight keep drawing the previous commands
+	void uploadIndirectBuffer( lvk::ICommandBuffer &cmdBuf ) {
+		const u32 numCommands = _drawCommands.size();
+
+		cmdBuf.cmdUpdateBuffer( _bufferIndirect, 0, sizeof(u32), &numCommands );
+		cmdUpdateBufferChunked( cmdBuf, _bufferIndirect, sizeof(u32), sizeof(DrawIndexedIndirectCommand) * numCommands, _drawCommands.data() );
+	}
+
+	// cmdBuf: nullptr - uploaded right away, only before the first frame
+	void selectTo( IndirectBuffer &buf, const std::function<bool( const DrawIndexedIndirectCommand& )> &pred, lvk::ICommandBuffer *cmdBuf = nullptr ) const {
 		buf._drawCommands.clear();
 		for ( const auto &c : _drawCommands ) {
 			if ( pred(c) )
 				buf._drawCommands.push_back( c );
 		}
-		buf.uploadIndirectBuffer();
+		if ( cmdBuf )
+			buf.uploadIndirectBuffer( *cmdBuf );
+		else
+			buf.uploadIndirectBuffer();
 	}
 
 	DrawIndexedIndirectCommand *getDrawIndexedIndirectCommand() const {
@@ -67,6 +80,13 @@ struct DrawData {
 	u32 materialId;
 };
 
+// Dequantization of the positions and the vertex stream of the vertex pulling, one per instance like DrawData, see VertexInput.sp
+struct VertexBounds {
+	vec4       offset;
+	vec4       scale;
+	glm::uvec4 stream; // x: VertexLayout, y: byte offset of the first vertex of the mesh, z: stride in bytes
+};
+
 using TextureCache = std::vector<lvk::Holder<lvk::TextureHandle>>;
 using TextureFiles = std::vector<std::string>;
 
@@ -101,13 +121,15 @@ GLTFMaterialDataGPU convertToGPUMaterial( const std::unique_ptr<lvk::IContext>&
 
 class VkMesh final {
 public:
-	VkMesh( const std::unique_ptr<lvk::IContext> &ctx, const MeshData &meshData, const Scene &scene, lvk::StorageType indirectStorage = lvk::StorageType_Device )
-		: ctx( ctx ), numIndices_( (u32)meshData.indexData.size() ), numMeshes_( (u32)meshData.meshes.size() ),
+	// With vertexPulling the pipelines have no vertex input state and fetch the vertices from the buffer address in the push constants
+	VkMesh( const std::unique_ptr<lvk::IContext> &ctx, const MeshData &meshData, const Scene &scene, lvk::StorageType indirectStorage = lvk::StorageType_Device,
+		bool vertexPulling = false )
+		: ctx( ctx ), numIndices_( (u32)meshData.indexData.size() ), numMeshes_( (u32)meshData.meshes.size() ), vertexPulling_( vertexPulling ),
 		bufferIndirect_( ctx, meshData.getMeshFileHeader().meshCount, indirectStorage), textureFiles_( meshData.textureFiles ) {
 		
 		const MeshFileHeader header = meshData.getMeshFileHeader();
-		const u32 *indices          = meshData.indexData.data();
 		const u8 *vertexData       = meshData.vertexData.data();
+		const u32 vertexSize       = meshData.streams.getVertexSize();
 
 		std::vector<GLTFMaterialDataGPU> materials;
 		materials.reserve( meshData.materials.size() );
@@ -116,20 +138,14 @@ public:
 			materials.push_back( convertToGPUMaterial(ctx, mat, textureFiles_, textureCache_) );
 		}
 
+		// storage for the triangle culling and the vertex pulling, see mr::TriangleCuller
 		bufferVertices_ = ctx->createBuffer({
-			.usage     = lvk::BufferUsageBits_Vertex,
+			.usage     = lvk::BufferUsageBits_Vertex | lvk::BufferUsageBits_Storage,
 			.storage   = lvk::StorageType_Device,
 			.size      = header.vertexDataSize,
 			.data      = vertexData,
 			.debugName = "Buffer: vertex"
 		});
-		bufferIndices_ = ctx->createBuffer({
-			.usage     = lvk::BufferUsageBits_Index,
-			.storage   = lvk::StorageType_Device,
-			.size      = header.indexDataSize,
-			.data      = indices,
-			.debugName = "Buffer: index"
-		});
 		bufferTransforms_ = ctx->createBuffer({
 			.usage     = lvk::BufferUsageBits_Storage,
 			.storage   = lvk::StorageType_Device,
@@ -145,91 +161,250 @@ public:
 			.debugName = "Buffer: materials"
 		});
 
-		std::vector<DrawIndexedIndirectCommand> drawCommands;
-		std::vector<DrawData> drawData;
-
-		const u32 numCommands = header.meshCount;
-
-		bufferIndirect_._drawCommands.resize( numCommands );
-		drawData.resize( numCommands );
-
-		DrawIndexedIndirectCommand *cmd = bufferIndirect_._drawCommands.data();
-		DrawData * dd = drawData.data();
+		std::vector<VertexBounds> vertexBounds;
 
-		LVK_ASSERT( scene.meshForNode.size() == numCommands );
-
-		u32 ddIndex = 0;
-		for( auto &i : scene.meshForNode ) {
-			const Mesh &mesh = meshData.meshes[i.second];
-			const u32 lod    = std::min<u32>( 0, mesh.lodCount - 1 ); // TODO: implement dynamic LOD
+		// One instanced draw command per mesh, with the nodes of the mesh as its instances. The per-instance data (DrawData,
+		// VertexBounds, drawNodes_) is indexed by gl_InstanceIndex, which starts at baseInstance
+		std::vector<std::vector<u32>> nodesForMesh( numMeshes_ );
+		for ( auto &i : scene.meshForNode ) {
+			nodesForMesh[i.second].push_back( i.first );
+		}
+		for ( std::vector<u32> &nodes : nodesForMesh ) {
+			std::sort( nodes.begin(), nodes.end() );
+		}
 
-			*cmd++ = {
-				.count         = mesh.getLODIndicesCount( lod ),
-				.instanceCount = 1,
-				.firstIndex    = mesh.indexOffset,
-				.baseVertex    = (s32)mesh.vertexOffset,
-				.baseInstance  = ddIndex++
-			};
-			*dd++ = {
-				.transformId = i.first,
-				.materialId  = mesh.materialID
-			};
+		const u32 numInstances = (u32)scene.meshForNode.size();
+
+		bufferIndirect_._drawCommands.clear();
+		drawData_.reserve( numInstances );
+		vertexBounds.reserve( numInstances );
+		drawNodes_.reserve( numInstances );
+
+		// The indices are relative to Mesh::vertexOffset (see rebaseMeshIndices()), so every mesh with less than 65536 vertices
+		// is drawn from the 16-bit index buffer. With the vertex pulling the 32-bit index buffer starts with a copy of the 16-bit
+		// indices at the same positions, and every draw command can be drawn from it
+		std::vector<u16> indices16;
+		std::vector<u32> indices32;
+
+		// 16-bit draws first, draw() splits the commands where the index type changes
+		for ( const bool pass16 : { true, false } ) {
+			for ( u32 m = 0; m != numMeshes_; m++ ) {
+				const Mesh &mesh = meshData.meshes[m];
+				const u32 *src   = meshData.indexData.data() + mesh.indexOffset;
+				const u32 lod    = std::min<u32>( 0, mesh.lodCount - 1 ); // TODO: implement dynamic LOD
+				const bool fitsUI16 = !mesh.getIndicesCount() || *std::max_element( src, src + mesh.getIndicesCount() ) <= 0xFFFF;
+
+				if ( nodesForMesh[m].empty() || fitsUI16 != pass16 )
+					continue;
+
+				u32 firstIndex = 0;
+				if ( pass16 ) {
+					firstIndex = (u32)indices16.size();
+					indices16.insert( indices16.end(), src, src + mesh.getIndicesCount() );
+				} else {
+					firstIndex = (u32)indices32.size();
+					indices32.insert( indices32.end(), src, src + mesh.getIndicesCount() );
+				}
+
+				bufferIndirect_._drawCommands.push_back({
+					.count         = mesh.getLODIndicesCount( lod ),
+					.instanceCount = (u32)nodesForMesh[m].size(),
+					.firstIndex    = firstIndex + mesh.lodOffset[lod] - mesh.lodOffset[0],
+					.baseVertex    = (s32)mesh.vertexOffset,
+					.baseInstance  = (u32)drawNodes_.size()
+				});
+				for ( u32 node : nodesForMesh[m] ) {
+					drawData_.push_back({
+						.transformId = node,
+						.materialId  = mesh.materialID
+					});
+					// offset and scale are not read by the shaders with float positions
+					vertexBounds.push_back( meshData.isQuantized() ? VertexBounds {
+						.offset = vec4( meshData.vertexBounds[m].min_, 0.0f ),
+						.scale  = vec4( meshData.vertexBounds[m].getSize(), 0.0f ),
+						.stream = glm::uvec4( VertexLayout_Quantized, mesh.vertexOffset * vertexSize, vertexSize, 0 )
+					} : VertexBounds {
+						.offset = vec4( 0.0f ),
+						.scale  = vec4( 1.0f ),
+						.stream = glm::uvec4( VertexLayout_Float, mesh.vertexOffset * vertexSize, vertexSize, 0 )
+					} );
+					drawNodes_.push_back( { .node = node, .mesh = m } );
+				}
+			}
+			if ( pass16 ) {
+				numCommands16_  = (u32)bufferIndirect_._drawCommands.size();
+				numInstances16_ = (u32)drawNodes_.size();
+				// TriangleCull.comp reads the 16-bit indices in pairs
+				if ( indices16.size() & 1 ) {
+					indices16.push_back( 0 );
+				}
+				if ( vertexPulling_ ) {
+					indices32.assign( indices16.begin(), indices16.end() );
+				}
+			}
+		}
+		indexDataSize16_ = indices16.size() * sizeof(u16);
+		indexDataSize32_ = indices32.size() * sizeof(u32);
+
+		// LVK does not create empty buffers
+		if ( !indices16.empty() ) {
+			bufferIndices16_ = ctx->createBuffer({
+				.usage     = lvk::BufferUsageBits_Index | lvk::BufferUsageBits_Storage,
+				.storage   = lvk::StorageType_Device,
+				.size      = indexDataSize16_,
+				.data      = indices16.data(),
+				.debugName = "Buffer: index (16-bit)"
+			});
+		}
+		if ( !indices32.empty() ) {
+			bufferIndices_ = ctx->createBuffer({
+				.usage     = lvk::BufferUsageBits_Index | lvk::BufferUsageBits_Storage,
+				.storage   = lvk::StorageType_Device,
+				.size      = indexDataSize32_,
+				.data      = indices32.data(),
+				.debugName = "Buffer: index"
+			});
 		}
 		bufferIndirect_.uploadIndirectBuffer();
 		
+		// rewritten by cullInstances()
+		culledDrawData_ = drawData_;
+		culledCommands_ = bufferIndirect_._drawCommands;
 		bufferDrawData_ = ctx->createBuffer({
 			.usage     = lvk::BufferUsageBits_Storage,
 			.storage   = lvk::StorageType_Device,
-			.size      = sizeof(DrawData) * numCommands,
-			.data      = drawData.data(),
+			.size      = sizeof(DrawData) * numInstances,
+			.data      = drawData_.data(),
 			.debugName = "Buffer: drawData"
 		});
+		bufferVertexBounds_ = ctx->createBuffer({
+			.usage     = lvk::BufferUsageBits_Storage,
+			.storage   = lvk::StorageType_Device,
+			.size      = sizeof(VertexBounds) * numInstances,
+			.data      = vertexBounds.data(),
+			.debugName = "Buffer: vertex bounds"
+		});
 	}
 
 	void draw( lvk::ICommandBuffer &buf, const Pipeline &pipeline, const mat4 &view, const mat4 &proj, u32 skyboxIrradianceIndex = 0,
 		bool wireframe = false, const IndirectBuffer *indirectBuffer = nullptr ) const {
 	
-		buf.cmdBindIndexBuffer( bufferIndices_, lvk::IndexFormat_UI32 );
-		buf.cmdBindVertexBuffer( 0, bufferVertices_ );
+		if ( !vertexPulling_ )
+			buf.cmdBindVertexBuffer( 0, bufferVertices_ );
 		buf.cmdBindRenderPipeline( wireframe ? pipeline._pipelineWireframe : pipeline._pipeline );
 		buf.cmdBindDepthState( { .compareOp = lvk::CompareOp_Less, .isDepthWriteEnabled = true } );
+		// Same layout as PerFrameData in common.sp, without the light
 		const struct {
 			mat4 viewProj;
 			u64  bufferTransforms;
 			u64  bufferDrawData;
 			u64  bufferMaterials;
+			u64  bufferLight;
 			u32  skyboxIrradiance;
+			u64  bufferVertexBounds;
+			u64  bufferVertices;
 		} pc = {
-			.viewProj         = proj * view,
-			.bufferTransforms = ctx->gpuAddress( bufferTransforms_ ),
-			.bufferDrawData   = ctx->gpuAddress( bufferDrawData_ ),
-			.bufferMaterials  = ctx->gpuAddress( bufferMaterials_ ),
-			.skyboxIrradiance = skyboxIrradianceIndex
+			.viewProj           = proj * view,
+			.bufferTransforms   = ctx->gpuAddress( bufferTransforms_ ),
+			.bufferDrawData     = ctx->gpuAddress( bufferDrawData_ ),
+			.bufferMaterials    = ctx->gpuAddress( bufferMaterials_ ),
+			.bufferLight        = 0,
+			.skyboxIrradiance   = skyboxIrradianceIndex,
+			.bufferVertexBounds = ctx->gpuAddress( bufferVertexBounds_ ),
+			.bufferVertices     = ctx->gpuAddress( bufferVertices_ )
 		};
 		static_assert( sizeof(pc) <= 128 );
 		buf.cmdPushConstants( pc );
-		if ( !indirectBuffer )
-			indirectBuffer = &bufferIndirect_;
-		buf.cmdDrawIndexedIndirectCount( indirectBuffer->_bufferIndirect, sizeof(u32), indirectBuffer->_bufferIndirect,
-			0, numMeshes_, sizeof(DrawIndexedIndirectCommand) );
+		drawIndirect( buf, indirectBuffer ? *indirectBuffer : bufferIndirect_ );
 	}
 
 	void draw( lvk::ICommandBuffer &buf, const Pipeline &pipeline, const void *pc, size_t pcSize, const lvk::DepthState depthState, bool wireframe = false,
 		const IndirectBuffer *indirectBuffer = nullptr ) const {
 		
-		buf.cmdBindIndexBuffer( bufferIndices_, lvk::IndexFormat_UI32 );
-		buf.cmdBindVertexBuffer( 0, bufferVertices_ );
+		if ( !vertexPulling_ )
+			buf.cmdBindVertexBuffer( 0, bufferVertices_ );
 		buf.cmdBindRenderPipeline( wireframe ? pipeline._pipelineWireframe : pipeline._pipeline );
 		buf.cmdBindDepthState( depthState );
 		buf.cmdPushConstants( pc, pcSize );
-		if ( !indirectBuffer )
-			indirectBuffer = &bufferIndirect_;
-		buf.cmdDrawIndexedIndirectCount(indirectBuffer->_bufferIndirect, sizeof(u32), indirectBuffer->_bufferIndirect,
-			0, numMeshes_, sizeof(DrawIndexedIndirectCommand));
+		drawIndirect( buf, indirectBuffer ? *indirectBuffer : bufferIndirect_ );
 	}
 
-	void updateGlobalTransforms(const mat4* data, size_t numMatrices) const {
-		ctx->upload(bufferTransforms_, data, numMatrices * sizeof(mat4));
+	// Two indirect draws, one per index buffer. Every IndirectBuffer drawn here keeps the order of bufferIndirect_
+	// (see IndirectBuffer::selectTo()), so its commands of the 16-bit buffer come first. With the vertex pulling the vertex layout
+	// is a property of the instance and the 32-bit index buffer holds all indices: one cmdDrawIndexedIndirectCount() draws every
+	// command, with the count in front of the commands
+	void drawIndirect( lvk::ICommandBuffer &buf, const IndirectBuffer &indirectBuffer ) const {
+		const std::vector<DrawIndexedIndirectCommand> &commands = indirectBuffer._drawCommands;
+		if ( vertexPulling_ ) {
+			if ( !commands.empty() ) {
+				buf.cmdBindIndexBuffer( bufferIndices_, lvk::IndexFormat_UI32 );
+				buf.cmdDrawIndexedIndirectCount( indirectBuffer._bufferIndirect, sizeof(u32), indirectBuffer._bufferIndirect, 0,
+					u32( commands.size() ), sizeof(DrawIndexedIndirectCommand) );
+			}
+			return;
+		}
+		const u32 numCommands16 = u32( std::partition_point( commands.begin(), commands.end(), [this]( const DrawIndexedIndirectCommand &c ) {
+			return c.baseInstance < numInstances16_;
+		}) - commands.begin() );
+		const u32 numCommands32 = u32( commands.size() ) - numCommands16;
+
+		if ( numCommands16 ) {
+			buf.cmdBindIndexBuffer( bufferIndices16_, lvk::IndexFormat_UI16 );
+			buf.cmdDrawIndexedIndirect( indirectBuffer._bufferIndirect, sizeof(u32), numCommands16, sizeof(DrawIndexedIndirectCommand) );
+		}
+		if ( numCommands32 ) {
+			buf.cmdBindIndexBuffer( bufferIndices_, lvk::IndexFormat_UI32 );
+			buf.cmdDrawIndexedIndirect( indirectBuffer._bufferIndirect, sizeof(u32) + numCommands16 * sizeof(DrawIndexedIndirectCommand),
+				numCommands32, sizeof(DrawIndexedIndirectCommand) );
+		}
+	}
+
+	// Draws the first instance of one mesh on its own, the pipeline and the push constants are up to the caller (see mr::Impostors::bake())
+	void drawMesh( lvk::ICommandBuffer &buf, u32 meshIndex ) const {
+		const std::vector<DrawIndexedIndirectCommand> &commands = bufferIndirect_._drawCommands;
+		for ( u32 i = 0; i != commands.size(); i++ ) {
+			const DrawIndexedIndirectCommand &c = commands[i];
+			if ( drawNodes_[c.baseInstance].mesh != meshIndex )
+				continue;
+			buf.cmdBindVertexBuffer( 0, bufferVertices_ );
+			if ( i < numCommands16_ )
+				buf.cmdBindIndexBuffer( bufferIndices16_, lvk::IndexFormat_UI16 );
+			else
+				buf.cmdBindIndexBuffer( bufferIndices_, lvk::IndexFormat_UI32 );
+			buf.cmdDrawIndexed( c.count, 1, c.firstIndex, c.baseVertex, c.baseInstance );
+			return;
+		}
+	}
+
+	// CPU culling, visible has one flag per instance (nullptr - all visible). The visible instances of every draw command are moved
+	// to the front of its range of DrawData and only those are drawn. The culled ones stay behind them, so the IndirectBuffers
+	// selected from bufferIndirect_ still draw every instance once. Recorded into the frame, outside of rendering, so the frames
+	// in flight keep their DrawData and instance counts
+	void cullInstances( lvk::ICommandBuffer &buf, const u32 *visible ) const {
+		DrawIndexedIndirectCommand *cmd = culledCommands_.data();
+		DrawData *dd                    = culledDrawData_.data();
+
+		for ( const DrawIndexedIndirectCommand &c : bufferIndirect_._drawCommands ) {
+			const u32 end = c.baseInstance + c.instanceCount;
+			u32 numVisible = 0;
+			for ( u32 i = c.baseInstance; i != end; i++ ) {
+				if ( !visible || visible[i] )
+					dd[c.baseInstance + numVisible++] = drawData_[i];
+			}
+			for ( u32 i = c.baseInstance, culled = c.baseInstance + numVisible; visible && i != end; i++ ) {
+				if ( !visible[i] )
+					dd[culled++] = drawData_[i];
+			}
+			(cmd++)->instanceCount = numVisible;
+		}
+		cmdUpdateBufferChunked( buf, bufferDrawData_, 0, culledDrawData_.size() * sizeof(DrawData), culledDrawData_.data() );
+		cmdUpdateBufferChunked( buf, bufferIndirect_._bufferIndirect, sizeof(u32), culledCommands_.size() * sizeof(DrawIndexedIndirectCommand),
+			culledCommands_.data() );
+	}
+
+	// Recorded into the frame, outside of rendering
+	void updateGlobalTransforms(lvk::ICommandBuffer& buf, const mat4* data, size_t numMatrices) const {
+		cmdUpdateBufferChunked(buf, bufferTransforms_, 0, numMatrices * sizeof(mat4), data);
 	}
 
 	void updateMaterial(const Material* materials, s32 updateMaterialIndex) const {
@@ -239,18 +414,33 @@ public:
 		ctx->upload(bufferMaterials_, &mat, sizeof(mat), sizeof(mat) * updateMaterialIndex);
 	}
 
-	DrawIndexedIndirectCommand *getDrawIndexedIndirectCommand() const { return bufferIndirect_.getDrawIndexedIndirectCommand(); }
-
 public:
 	const std::unique_ptr<lvk::IContext>& ctx;
 
 	uint32_t numIndices_ = 0, numMeshes_  = 0;
+	bool     vertexPulling_ = false;
+
+	// draw commands [0, numCommands16_) with the instances [0, numInstances16_) use bufferIndices16_, the others bufferIndices_
+	uint32_t numCommands16_   = 0;
+	uint32_t numInstances16_  = 0;
+	uint64_t indexDataSize16_ = 0;
+	uint64_t indexDataSize32_ = 0;
+
+	// per instance, in the order of the draw commands
+	std::vector<DrawData> drawData_;
+	std::vector<DrawNode> drawNodes_;
+
+	// staging of cullInstances()
+	mutable std::vector<DrawData>                   culledDrawData_;
+	mutable std::vector<DrawIndexedIndirectCommand> culledCommands_;
 
+	lvk::Holder<lvk::BufferHandle> bufferIndices16_;
 	lvk::Holder<lvk::BufferHandle> bufferIndices_;
 	lvk::Holder<lvk::BufferHandle> bufferVertices_;
 	lvk::Holder<lvk::BufferHandle> bufferTransforms_;
 	lvk::Holder<lvk::BufferHandle> bufferDrawData_;
 	lvk::Holder<lvk::BufferHandle> bufferMaterials_;
+	lvk::Holder<lvk::BufferHandle> bufferVertexBounds_;
 
 	IndirectBuffer bufferIndirect_;
 
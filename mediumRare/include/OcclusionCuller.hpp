@@ -0,0 +1,114 @@
+#pragma once
+
+#include <shared/Scene/VtxData.h>
+
+#include "types.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace mr {
+	class SimulationThread;
+
+	// Software occlusion culling on the CPU, after Masked Occlusion Culling (Andersson et al. 2016). The biggest opaque meshes, the
+	// building shells of Bistro, are rasterized into a low resolution depth buffer of kTileWidth x kTileHeight tiles. A tile does not
+	// keep per-pixel depths: every row of it is a 32-bit coverage mask, and the tile has two depth layers. zMax0 is the farthest depth
+	// of the whole tile, zMax1 the farthest depth of the pixels in the masks, merged into zMax0 once they cover the tile. The boxes of
+	// the instances are then tested against zMax0 on worker threads. The depths of the tiles are stored per row, and updated and tested
+	// 4 tiles at a time with SSE2 or NEON, or with a scalar fallback. Only needs the mesh data and the transforms, no GPU
+	class OcclusionCuller final {
+	public:
+		static constexpr u32 kWidth      = 320;
+		static constexpr u32 kHeight     = 180;
+		static constexpr u32 kTileWidth  = 32; // one bit per pixel of a row
+		static constexpr u32 kTileHeight = 4;
+		static constexpr u32 kTilesX     = kWidth / kTileWidth;
+		static constexpr u32 kTilesY     = kHeight / kTileHeight;
+
+		static constexpr u32 kTileStride = ( kTilesX + 3 ) & ~3u; // tiles per row of the depths, padded to whole SIMD ops
+
+		static_assert( kWidth % kTileWidth == 0 && kHeight % kTileHeight == 0 );
+
+		// z / w. The depths of the tiles and the projected corners of the boxes are rounded differently, a box is only hidden when
+		// it is farther than that behind the occluders, so an occluder never culls its own box
+		static constexpr f32 kDepthTolerance = 1e-5f;
+
+		struct Params {
+			f32 minOccluderSize      = 4.0f;  // world units, the second largest extent of the box of an instance
+			u32 maxOccluders         = 64;
+			u32 maxOccluderTriangles = 65536; // over all occluders, LOD 0
+		};
+
+		// Picks the occluders among the instances of VkMesh: opaque meshes with big world space boxes, the largest first.
+		// numThreads includes the calling thread, 0 picks it from the hardware concurrency
+		OcclusionCuller( const MeshData &meshData, const std::vector<DrawNode> &drawNodes, const std::vector<glm::mat4> &globalTransforms,
+			const Params &params, u32 numThreads = 0 );
+		~OcclusionCuller();
+
+		OcclusionCuller( const OcclusionCuller& )            = delete;
+		OcclusionCuller &operator=( const OcclusionCuller& ) = delete;
+
+		// Clears the depth buffer and rasterizes the occluders whose flags in visible are set, i.e. the ones in the frustum.
+		// visible has one flag per instance of VkMesh. Returns the number of rasterized triangles
+		u32 renderOccluders( const glm::mat4 &viewProj, const std::vector<glm::mat4> &globalTransforms, const u32 *visible );
+
+		// boxes are world space. Boxes crossing the near plane are always visible
+		bool isBoxVisible( const BoundingBox &box ) const;
+
+		// Same flags as the CPU culling: clears the ones of the visible instances whose boxes are hidden by the occluders, the boxes
+		// are split over the worker threads. Call after renderOccluders(). Returns the number of cleared flags
+		u32 cullInstances( const BoundingBox *boxes, u32 *visible, u32 count );
+
+		bool empty() const                   { return _occluders.empty(); }
+		u32  getNumOccluders() const         { return u32( _occluders.size() ); }
+		u64  getNumOccluderTriangles() const { return _numOccluderTriangles; }
+		u32  getNumThreads() const           { return u32( _workers.size() ) + 1; }
+
+	private:
+		// The depths of the tile are in _zMax0 and _zMax1
+		struct Tile {
+			u32 mask[kTileHeight]; // coverage of the working layer, bit x is the pixel x of the row
+		};
+
+		struct OccluderMesh {
+			u32 firstVertex; // in _positions
+			u32 numVertices;
+			u32 firstIndex;  // in _indices, relative to firstVertex
+			u32 numIndices;
+		};
+
+		struct Occluder {
+			u32 instance; // of VkMesh
+			u32 node;
+			u32 mesh;     // in _meshes
+		};
+
+		// Clip space, clipped against the near plane and the viewport
+		void rasterizeTriangle( const glm::vec4 &v0, const glm::vec4 &v1, const glm::vec4 &v2 );
+		void rasterizeScreenTriangle( const glm::vec3 &s0, const glm::vec3 &s1, const glm::vec3 &s2 );
+		// 4 tiles of the row ty from tx, the farthest depth of the triangle in a tile is zA * x + zB * y + zC at one of its corners,
+		// clamped to zMax. Tiles whose masks are all empty are left as they are
+		void updateTiles( u32 ty, u32 tx, const u32 ( *masks )[kTileHeight], f32 zA, f32 zB, f32 zC, f32 zMax );
+		void testRange( u32 thread );
+
+		std::vector<glm::vec3>    _positions; // local space
+		std::vector<u32>          _indices;
+		std::vector<OccluderMesh> _meshes;
+		std::vector<Occluder>     _occluders;
+		u64                       _numOccluderTriangles = 0;
+		std::vector<glm::vec4>    _clipPositions; // of one occluder, reserved for the largest one
+
+		std::vector<Tile> _tiles;
+		std::vector<f32>  _zMax0; // reference layer, farthest depth of the tile, kTileStride per row
+		std::vector<f32>  _zMax1; // working layer, farthest depth of the covered pixels
+		glm::mat4         _viewProj = glm::mat4( 1.0f );
+
+		// The batch of cullInstances() split over the workers, the calling thread takes the last slice
+		std::vector<std::unique_ptr<SimulationThread>> _workers;
+		const BoundingBox *_batchBoxes   = nullptr;
+		u32               *_batchVisible = nullptr;
+		u32                _batchCount   = 0;
+		u32                _batchThreads = 1;
+		std::vector<u32>   _batchCulled; // per thread
+	};
+}
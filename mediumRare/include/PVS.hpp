@@ -0,0 +1,60 @@
+#pragma once
+
+#include <shared/Scene/Scene.h>
+#include <shared/Scene/VtxData.h>
+
+#include "types.hpp"
+
+#include <vector>
+
+namespace mr {
+	// Potentially visible sets of the mesh nodes for a grid of view cells over the scene, baked on the CPU. Rays are cast from a few
+	// sample points in every cell against the world space triangles of all nodes, a node is visible from the cell when a ray hits it
+	// before any opaque triangle. Alpha-tested and transparent nodes, the windows and the foliage, do not stop the rays. To stay
+	// conservative the nodes whose boxes touch a cell are always visible from it, and every set is dilated by its neighbouring cells.
+	// A set is a run-length encoded bitset over the nodes in Morton order of their box centers, identical sets are stored once
+	class PVS final {
+	public:
+		struct BakeParams {
+			f32 cellSize       = 8.0f; // world units, grows until the grid has at most kMaxCells cells
+			u32 samplesPerCell = 8;
+			u32 raysPerSample  = 256;
+			u32 numThreads     = 0;    // 0 uses the hardware concurrency, the result does not depend on it
+		};
+
+		static constexpr u32 kMaxCells = 1u << 16;
+
+		// Needs the global transforms and the bounding boxes of the scene. alwaysVisibleNodes are left out of the sets and of the
+		// rays, i.e. the HLOD proxies, which are simplified versions of the nodes they replace
+		void bake( const Scene &scene, const MeshData &meshData, const std::vector<u32> &alwaysVisibleNodes, const BakeParams &params );
+
+		// Fails when the file was baked for another scene or mesh cache, i.e. when the counts, the transforms of the nodes or the
+		// bounds of the meshes differ, and when it is truncated
+		bool load( const char *fileName, const Scene &scene, const MeshData &meshData );
+		bool save( const char *fileName ) const;
+
+		// visible has one flag per instance, instanceForNode maps the scene nodes to them. Clears the flags of the nodes that are not
+		// potentially visible from the cell of cameraPos, cameras outside of the grid see everything. Returns the number of cleared flags
+		u32 select( const glm::vec3 &cameraPos, const std::vector<u32> &instanceForNode, u32 *visible ) const;
+
+		bool empty() const       { return _nodes.empty(); }
+		u32  getNumNodes() const { return u32( _nodes.size() ); }
+		u32  getNumCells() const { return _dims.x * _dims.y * _dims.z; }
+		u64  getDataSize() const { return _data.size(); }
+
+	private:
+		glm::vec3  _gridMin  = glm::vec3( 0.0f );
+		f32        _cellSize = 1.0f;
+		glm::uvec3 _dims     = glm::uvec3( 0 );
+
+		std::vector<u32> _nodes;       // the bits of the sets
+		std::vector<u32> _cellOffsets; // into _data, per cell
+		std::vector<u8>  _data;
+
+		// what the sets were baked for, see load()
+		u32 _numSceneNodes = 0;
+		u32 _numMeshes     = 0;
+		u32 _numIndices    = 0;
+		u64 _contentHash   = 0;
+	};
+}
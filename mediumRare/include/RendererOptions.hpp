@@ -12,9 +12,11 @@ namespace mr {
 		MSAAx4,
 		MSAAx8,
 		MSAAx16,
+		TAA,
 		SSAO,
 		BlurSSAO,
 		Bloom,
+		FusedPostProcess,
 		ToneMappingNone,
 		ToneMappingReinhard,
 		ToneMappingUchimura,
@@ -22,6 +24,12 @@ namespace mr {
 		CullingNone,
 		CullingCPU,
 		CullingGPU,
+		PipelinedSimulation,
+		HLODProxies,
+		TreeImpostors,
+		OcclusionCulling,
+		PVSCulling,
+		TriangleCulling,
 
 		MAX
 	};
@@ -38,13 +46,46 @@ namespace mr {
 		case RendererOption::MSAAx4:					return "MSAAx4";
 		case RendererOption::MSAAx8:					return "MSAAx8";
 		case RendererOption::MSAAx16:					return "MSAAx16";
+		case RendererOption::TAA:						return "TAA";
+		case RendererOption::SSAO:						return "SSAO";
+		case RendererOption::BlurSSAO:					return "BlurSSAO";
 		case RendererOption::Bloom:						return "Bloom";
+		case RendererOption::FusedPostProcess:			return "FusedPostProcess";
 		case RendererOption::ToneMappingNone:			return "ToneMappingNone";
 		case RendererOption::ToneMappingReinhard:		return "ToneMappingReinhard";
 		case RendererOption::ToneMappingUchimura:		return "ToneMappingUchimura";
 		case RendererOption::ToneMappingKhronosPBR:		return "ToneMappingKhronosPBR";
+		case RendererOption::CullingNone:				return "CullingNone";
+		case RendererOption::CullingCPU:				return "CullingCPU";
+		case RendererOption::CullingGPU:				return "CullingGPU";
+		case RendererOption::PipelinedSimulation:		return "PipelinedSimulation";
+		case RendererOption::HLODProxies:				return "HLODProxies";
+		case RendererOption::TreeImpostors:				return "TreeImpostors";
+		case RendererOption::OcclusionCulling:			return "OcclusionCulling";
+		case RendererOption::PVSCulling:				return "PVSCulling";
+		case RendererOption::TriangleCulling:			return "TriangleCulling";
 		case RendererOption::MAX:						return "MAX";
 		default:										return "Invalid";
 		}
 	}
+
+	// Must match the BlurKernel_* constants in Blur.comp and Bloom.comp
+	enum BlurKernel : unsigned int {
+		BlurKernel_Reference = 0,
+		BlurKernel_LinearSampling,
+		BlurKernel_SharedMemory,
+		BlurKernel_SharedMemoryFused,
+
+		BlurKernel_Count
+	};
+
+	static const char *BlurKernelToString( const BlurKernel kernel ) {
+		switch( kernel ) {
+		case BlurKernel_Reference:						return "Reference (17 fetches)";
+		case BlurKernel_LinearSampling:					return "Linear sampling (9 fetches)";
+		case BlurKernel_SharedMemory:					return "Shared memory";
+		case BlurKernel_SharedMemoryFused:				return "Shared memory fused 2D";
+		default:										return "Invalid";
+		}
+	}
 }
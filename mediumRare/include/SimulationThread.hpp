@@ -0,0 +1,32 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace mr {
+	// Runs a single job on its own thread: kick() starts it, wait() blocks until it is done.
+	// The job is set once, so kicking it every frame never allocates
+	class SimulationThread final {
+	public:
+		explicit SimulationThread( std::function<void()> job );
+		~SimulationThread();
+
+		SimulationThread( const SimulationThread& )            = delete;
+		SimulationThread &operator=( const SimulationThread& ) = delete;
+
+		void kick();
+		void wait(); // returns immediately if the job was not kicked
+
+	private:
+		void threadProc();
+
+		std::function<void()>   _job;
+		std::mutex              _mutex;
+		std::condition_variable _cv;
+		bool                    _pending = false;
+		bool                    _quit    = false;
+		std::thread             _thread;
+	};
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "types.hpp"
+#include "GPUProfiler.hpp"
+
+#include <shared/Camera.h>
+
+#include <functional>
+#include <vector>
+
+namespace mr {
+	// One knob of the renderer, e.g. SSAO on/off or the anti-aliasing mode. Level 0 is the baseline,
+	// the settings that are mutually exclusive are the levels of one factor so that they cannot overwrite each other
+	struct SweepFactor {
+		const char               *name;   // used on the command line and in the report
+		std::function<void(u32)>  apply;  // level
+		std::vector<const char*>  levels; // names for the report, empty for off/on
+	};
+
+	// Sweep over the selected factors: every combination is rendered from every viewpoint,
+	// each (combination, viewpoint) cell gets a few settling frames followed by measured frames.
+	// The combinations are a full factorial design when it has at most kMaxCombinations, otherwise and for "all" the
+	// baseline plus one combination per factor level with every other factor at its baseline (one factor at a time).
+	// The effect of a level is the mean of the paired differences between the cells that only differ by that factor
+	// being at the level instead of the baseline, reported with a 95% confidence interval (Student's t).
+	// Optionally the same for the GPU time of a few profiler scopes, e.g. "Shadow Pass,Shadow Impostors", summed per frame.
+	class OptionSweep final {
+	public:
+		static constexpr u32 kMaxFactors        = 32;
+		static constexpr u32 kMaxCombinations   = 1024; // of the full factorial design
+		static constexpr u32 kMaxMeasuredFrames = 256;  // per cell
+
+		// factorNames: comma separated subset of the factor names or "all"
+		// passName: comma separated GPUProfiler scope names to report next to the frame time, or nullptr
+		OptionSweep( std::vector<SweepFactor> factors, const char *factorNames, const CameraPositioner_Path &path, u32 numViewpoints,
+			u32 settleFrames, u32 measuredFrames, const char *passName = nullptr );
+
+		bool isValid() const { return !_factors.empty(); }
+
+		// Applies the factor levels of the current combination and places the camera on the current viewpoint
+		void beginFrame();
+		CameraPositioner_Path &getCameraPositioner() { return _path; }
+
+		// Call once per frame after submitting it
+		void addFrame( f32 cpuMs, const GPUProfiler &profiler );
+
+		bool isFinished() const { return _frameIndex >= getNumFrames() + GPUProfiler::kFramesInFlight + 1; }
+
+		// Prints the table to stdout and writes the JSON report
+		bool writeReport( const char *fileName ) const;
+
+	private:
+		struct Effect {
+			f64 mean      = 0.0;
+			f64 halfWidth = 0.0; // of the 95% confidence interval
+			u32 numPairs  = 0;
+		};
+
+		u64    getNumFrames() const { return u64( getNumCells() ) * ( _settleFrames + _measuredFrames ); }
+		u32    getNumCells() const  { return _numCombinations * _numViewpoints; }
+		u32    getNumLevels( u32 factor ) const { return _factors[factor].levels.empty() ? 2 : u32( _factors[factor].levels.size() ); }
+		u32    getLevel( u32 combination, u32 factor ) const { return _levels[combination * _factors.size() + factor]; }
+		void   getLevelName( u32 factor, u32 level, char *name, size_t size ) const;
+		s64    getSampleIndex( u64 frame ) const; // -1 for settling frames
+		f64    getCellValue( const std::vector<f32> &samples, u32 cell ) const;
+		Effect computeEffect( const std::vector<f32> &samples, u32 factor, u32 level ) const;
+
+		std::vector<SweepFactor> _factors;
+		bool                     _oneFactorAtATime = false;
+		u32                      _numCombinations  = 0;
+		std::vector<u8>          _levels;  // [combination * _factors.size() + factor]
+		std::vector<u32>         _strides; // of the factor levels in the index of a combination, full factorial only
+		CameraPositioner_Path    _path;
+		u32                      _numViewpoints  = 1;
+		u32                      _settleFrames   = 0;
+		u32                      _measuredFrames = 1;
+
+		u64 _frameIndex        = 0;
+		u64 _numResolvedFrames = 0;
+		s64 _currentCombination = -1;
+
+		// [cell * _measuredFrames + i], cell = combination * _numViewpoints + viewpoint, negative when missing
+		std::vector<f32> _cpuMs;
+		std::vector<f32> _gpuMs;
+		std::vector<f32> _passMs;
+
+		const char *_passName     = nullptr;
+		bool        _passWasFound = false;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <lvk/LVK.h>
+#include <glm/ext.hpp>
+
+#include "types.hpp"
+
+namespace mr {
+	// Camera jitter and history bookkeeping of the temporal anti-aliasing, the resolve itself is TAA.comp.
+	// Every frame the projection is offset by a sub-pixel amount from a Halton(2, 3) sequence, the resolve reprojects
+	// the accumulated history with the motion vectors and blends the new frame into it
+	class TemporalAA final {
+	public:
+		static constexpr u32 kNumJitterSamples = 8;
+
+		struct Params {
+			f32 feedbackMin = 0.88f; // history weight where it differs a lot from the new frame
+			f32 feedbackMax = 0.97f; // and where it agrees with it
+			f32 clipGamma   = 1.0f;  // size of the neighbourhood box in standard deviations
+		} params;
+
+		// Call once per frame before rendering. viewProj is the unjittered matrix of this frame.
+		// The history is dropped when TAA was off in the previous frame or the rendered region changed
+		void update( bool enabled, const glm::mat4 &viewProj, const lvk::Dimensions &renderSize );
+
+		// After the resolve: this frame becomes the history of the next one
+		void endFrame();
+
+		void invalidateHistory() { _historyValid = false; }
+
+		bool isEnabled() const      { return _enabled; }
+		bool isHistoryValid() const { return _historyValid; }
+
+		// Projection with the sub-pixel offset of this frame, unchanged when disabled
+		glm::mat4 jitter( const glm::mat4 &proj ) const;
+
+		glm::vec2 getJitterNDC() const           { return _jitterNDC; }
+		const glm::mat4 &getPrevViewProj() const { return _prevViewProj; }
+
+		// Ping-pong history textures: the resolve reads the previous one and writes the current one
+		u32 getHistoryIndex() const     { return _historyIndex; }
+		u32 getPrevHistoryIndex() const { return _historyIndex ^ 1; }
+
+	private:
+		bool            _enabled      = false;
+		bool            _historyValid = false;
+		u32             _frameIndex   = 0;
+		u32             _historyIndex = 0;
+		glm::vec2       _jitterNDC    = glm::vec2( 0.0f );
+		glm::mat4       _viewProj     = glm::mat4( 1.0f );
+		glm::mat4       _prevViewProj = glm::mat4( 1.0f );
+		lvk::Dimensions _renderSize   = {};
+	};
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <lvk/LVK.h>
+#include <shared/Scene/VtxData.h>
+
+#include "types.hpp"
+#include "Pipeline.hpp"
+
+#include <vector>
+
+namespace mr {
+	// Triangle culling in a compute pre-pass, after Wihlidal, "Optimizing the Graphics Pipeline with Compute" (GDC 2016). The visible
+	// instances of the meshes with at least params.minTriangles triangles, the static batches of Bistro, are taken out of the instanced
+	// draw commands of VkMesh. Before every pass TriangleCull.comp tests their triangles against the view of the pass: outside of the
+	// frustum, zero-area, back-facing and too small to cover a sample. The others are appended to a compacted index buffer, with one
+	// indirect draw command per instance, which is drawn with the pipelines of VkMesh. The triangles keep their order within a workgroup
+	// only, the workgroups of an instance append in any order
+	class TriangleCuller final {
+	public:
+		static constexpr u32 kGroupSize = 64;    // triangles per workgroup, see TriangleCull.comp
+		static constexpr u32 kMaxGroups = 65535; // of one dispatch
+
+		enum Pass : u32 {
+			Pass_Main = 0,
+			Pass_Shadow,
+
+			Pass_Count
+		};
+
+		struct Params {
+			u32 minTriangles = 16384;   // of a mesh, LOD 0
+			u32 maxTriangles = 1u << 21; // of the selected instances of a frame, the size of the compacted index buffers
+		};
+
+		// LOD 0 of a mesh in the index buffers of VkMesh
+		struct MeshDraw {
+			u32  firstIndex = 0;
+			u32  numIndices = 0;
+			s32  baseVertex = 0;
+			bool indices16  = false;
+		};
+
+		// What the pre-pass and the draws need from VkMesh. The vertex and index buffers are read as storage buffers
+		struct MeshInputs {
+			lvk::BufferHandle     vertices;
+			lvk::BufferHandle     indices16;        // read as pairs of indices
+			lvk::BufferHandle     indices32;
+			u64                   bufferTransforms = 0;
+			u32                   vertexSize       = 0;
+			const char           *vertexDefines    = nullptr;
+			std::vector<MeshDraw> meshDraws;        // per mesh
+		};
+
+		// Picks the candidates among the instances of VkMesh, drawNodes
+		TriangleCuller( const std::unique_ptr<lvk::IContext> &ctx, const MeshData &meshData, const std::vector<DrawNode> &drawNodes,
+			const MeshInputs &inputs, const Params &params );
+
+		TriangleCuller( const TriangleCuller& )            = delete;
+		TriangleCuller &operator=( const TriangleCuller& ) = delete;
+
+		// visible has one flag per instance of VkMesh. Moves the visible candidates into instances, as long as their triangles fit into
+		// the compacted index buffers, and clears their flags. Returns the number of moved instances
+		u32 select( bool enabled, u32 *visible, std::vector<u32> &instances ) const;
+
+		// Records the slots of the selected instances of a frame into the command buffer, outside of rendering and before cull().
+		// The slot and the command buffers are only written by the GPU timeline, so the frames in flight never see the next ones
+		void upload( lvk::ICommandBuffer &buf, const std::vector<u32> &instances );
+
+		// Records the pre-pass of one pass, outside of rendering. The pass must then depend on getIndexBuffer() and getCommandBuffer().
+		// backface matches lvk::CullMode_Back, the small primitive test assumes one sample per pixel at its center
+		void cull( lvk::ICommandBuffer &buf, Pass pass, const glm::mat4 &viewProj, const lvk::Dimensions &viewport, bool backface,
+			bool smallPrimitives );
+
+		// Same push constants as VkMesh::draw(), with the draw data and the vertex bounds of the candidates
+		void draw( lvk::ICommandBuffer &buf, Pass pass, const Pipeline &pipeline, const glm::mat4 &viewProj, u64 bufferMaterials,
+			u64 bufferLight, u32 skyboxIrradiance, bool wireframe ) const;
+
+		lvk::BufferHandle getIndexBuffer( Pass pass ) const   { return _bufferIndices[pass]; }
+		lvk::BufferHandle getCommandBuffer( Pass pass ) const { return _bufferCommands[pass]; }
+
+		bool empty() const                    { return _candidates.empty(); }
+		u32  getNumMeshes() const             { return _numMeshes; }
+		u32  getNumCandidateInstances() const { return u32( _candidates.size() ); }
+		u64  getNumTriangles() const          { return _numTriangles; }
+		u32  getMaxTriangles() const          { return _maxTriangles; }
+
+	private:
+		// Per selected instance, read by TriangleCull.comp
+		struct SlotGPU {
+			glm::vec4 boundsOffset; // dequantization of the positions, see VertexInput.sp
+			glm::vec4 boundsScale;
+			u64       indices;      // buffer address
+			u32       firstIndex;
+			u32       numTriangles;
+			s32       baseVertex;
+			u32       indices16;
+			u32       transformId;
+			u32       firstGroup;   // the slots of a dispatch are sorted by their first workgroup
+			u32       firstOutput;  // first index in the compacted index buffer
+			u32       padding[3];
+		};
+		static_assert( sizeof(SlotGPU) == 80 );
+
+		// Same layout as DrawIndexedIndirectCommand in Mesh.hpp
+		struct CommandGPU {
+			u32 count;
+			u32 instanceCount;
+			u32 firstIndex;
+			s32 baseVertex;
+			u32 baseInstance;
+		};
+
+		struct Candidate {
+			u32 instance; // of VkMesh
+			u32 mesh;
+			u32 numTriangles;
+		};
+
+		const std::unique_ptr<lvk::IContext> &_ctx;
+
+		lvk::BufferHandle       _vertices;
+		u32                     _vertexSize = 0;
+		std::vector<Candidate>  _candidates;
+		std::vector<SlotGPU>    _slotTemplates;    // per candidate, without the per-frame offsets
+		std::vector<SlotGPU>    _slots;            // of this frame, reserved for all candidates
+		std::vector<CommandGPU> _commands;         // of this frame with zero counts, reserved for all candidates
+		u32                     _numMeshes    = 0;
+		u64                     _numTriangles = 0; // of all candidates, LOD 0
+		u32                     _maxTriangles = 0;
+		u64                     _bufferTransforms = 0;
+
+		// uploaded for this frame
+		u32 _numSlots  = 0;
+		u32 _numGroups = 0;
+
+		lvk::Holder<lvk::BufferHandle> _bufferDrawData;     // per candidate, gl_InstanceIndex of the draws
+		lvk::Holder<lvk::BufferHandle> _bufferVertexBounds; // per candidate
+		lvk::Holder<lvk::BufferHandle> _bufferSlots;                // updated by upload()
+		lvk::Holder<lvk::BufferHandle> _bufferIndices[Pass_Count];
+		lvk::Holder<lvk::BufferHandle> _bufferCommands[Pass_Count]; // reset by cull()
+
+		lvk::Holder<lvk::ShaderModuleHandle>    _comp;
+		lvk::Holder<lvk::ComputePipelineHandle> _pipeline;
+	};
+}
@@ -25,6 +25,34 @@ struct LightParams {
     bool operator==( const LightParams& ) const = default;
 };
 
+// Stop redrawing while nothing changes, see App::run()
+struct OnDemandRendering {
+    bool enabled        = false;
+    f32  minRefreshRate = 1.0f; // Hz, redraw at least this often while idle so the stats stay alive
+    f32  settleSeconds  = 3.0f; // keep drawing after the last change until temporal effects (eye adaptation) have converged
+    bool idle           = false; // the current frame is only drawn because of minRefreshRate
+};
+
+// Wait for the GPU before sampling the input instead of queueing frames, see App::run()
+struct LowLatencyMode {
+    bool enabled           = false;
+    s32  maxFramesInFlight = 1;    // frames the CPU may run ahead of the GPU when enabled, 3 otherwise
+    f32  latencyMs         = 0.0f; // input sampling to GPU completion, smoothed
+    f32  maxLatencyMs      = 0.0f; // over the last second
+};
+
+// Scene node and mesh of an instance of VkMesh, indexed by gl_InstanceIndex
+struct DrawNode {
+    u32 node;
+    u32 mesh;
+};
+
+// Vertex layouts of MeshData. The vertex pulling decodes them per draw command, see VertexInput.sp
+enum VertexLayout : u32 {
+    VertexLayout_Float     = 0, // 20 bytes: vec3 position, half2 uv, 2_10_10_10 normal, see convertAIMesh()
+    VertexLayout_Quantized = 1, // 12 bytes, see quantizeVertices()
+};
+
 struct LightData {
     glm::mat4 viewProjBias;
     glm::vec4 lightDir;
@@ -32,6 +60,13 @@ struct LightData {
     u32       shadowSampler;
 };
 
+// Matrices of the object motion vectors pass, see Velocity.sp
+struct MotionData {
+    glm::mat4 viewProj;     // jittered
+    glm::mat4 prevViewProj; // unjittered
+    glm::vec4 jitter;       // xy: NDC offset of this frame
+};
+
 struct SSAOpc {
     u32 textureDepth;
     u32 textureRot;
@@ -42,6 +77,8 @@ struct SSAOpc {
     f32 radius;
     f32 attScale;
     f32 distScale;
+    f32 uvMaxX = 1.0f; // rendered region of the depth buffer with dynamic resolution
+    f32 uvMaxY = 1.0f;
 };
 
 struct CombinePC {
@@ -55,14 +92,29 @@ struct CombinePC {
 struct BrightPassPC {
     u32 texColor;
     u32 texOut;
-    u32 texLuminance;
     u32 sampler;
     f32 exposure;
 };
 
+struct BloomParams {
+    bool mipChain = true;  // progressive downsample/upsample bloom instead of the ping-pong Gaussian
+    s32  numMips  = 6;
+    s32  maxMips  = 6;
+    f32  radius   = 1.0f;  // upsample tent filter radius in texels
+};
+
+struct LuminancePC {
+    u64 bufferLuminance;
+    u32 texColor;
+    u32 sampler;
+    f32 exposure;
+    f32 deltaSeconds;
+    f32 adaptationSpeed = 1.5f;
+};
+
 struct ToneMapPC {
+    u64 bufferLuminance;
     u32 texColor;
-    u32 texLuminance;
     u32 texBloom;
     u32 sampler;
     u32 tonemapMode = 1;
@@ -0,0 +1,56 @@
+#include <../shaders/Impostor.sp>
+#if !SHADOW_PASS
+#include <../../data/shaders/Shadow.sp>
+#endif
+
+layout (location = 0) in vec2 uv;
+layout (location = 1) in vec3 planePos;
+layout (location = 2) in flat vec3 depthAxis;
+layout (location = 3) in flat vec4 frameRect;
+layout (location = 4) in flat mat3 normalMatrix;
+layout (location = 7) in flat float fade;
+
+#if !SHADOW_PASS
+layout (location = 0) out vec4 out_FragColor;
+#endif
+
+// SHADOW_PASS: depth only, for the shadow map
+void main() {
+	// half a texel inside the frame, the bilinear taps would read the neighbouring frames otherwise
+	const vec2 halfTexel = 0.5 / vec2(textureBindlessSize2D(pc.texAlbedo));
+	const vec2 tc        = clamp(uv, frameRect.xy + halfTexel, frameRect.zw - halfTexel);
+
+	const vec4 albedo = textureBindless2D(pc.texAlbedo, pc.smpl, tc);
+
+	// screen-door fade-in against the same 4x4 Bayer pattern as runAlphaTest()
+	const mat4 thresholdMatrix = mat4(
+		1.0  / 17.0,  9.0 / 17.0,  3.0 / 17.0, 11.0 / 17.0,
+		13.0 / 17.0,  5.0 / 17.0, 15.0 / 17.0,  7.0 / 17.0,
+		4.0  / 17.0, 12.0 / 17.0,  2.0 / 17.0, 10.0 / 17.0,
+		16.0 / 17.0,  8.0 / 17.0, 14.0 / 17.0,  6.0 / 17.0
+	);
+	if (albedo.a < 0.5 || fade < thresholdMatrix[int(mod(gl_FragCoord.x, 4.0))][int(mod(gl_FragCoord.y, 4.0))])
+		discard;
+
+	const vec4 normalDepth = textureBindless2D(pc.texNormalDepth, pc.smpl, tc);
+#if SHADOW_PASS
+	// the depth bias of the pipeline does not apply to gl_FragDepth, push the surface away from the light instead
+	const vec3 worldPos    = planePos + depthAxis * (1.0 - 2.0 * normalDepth.w - 0.02);
+#else
+	const vec3 worldPos    = planePos + depthAxis * (1.0 - 2.0 * normalDepth.w);
+#endif
+	const vec4 clipPos     = pc.viewProj * vec4(worldPos, 1.0);
+	gl_FragDepth = clipPos.z / clipPos.w;
+
+#if !SHADOW_PASS
+	const vec3 n = normalize(normalMatrix * (normalDepth.xyz * 2.0 - 1.0));
+
+	// same lighting as main.frag, without the normal map
+	float NdotL  = clamp( dot( n, -normalize(pc.light.lightDir.xyz) ), 0.1, 1.0 );
+	const vec4 f0 = vec4(0.04);
+	vec3 sky      = vec3(-n.x, n.y, -n.z); // rotate skybox
+	vec4 diffuse  = (textureBindlessCube(pc.texSkyboxIrradiance, 0, sky) + vec4(NdotL)) * vec4(albedo.rgb, 1.0) * (vec4(1.0) - f0);
+
+	out_FragColor = diffuse * shadow( pc.light.viewProjBias * vec4(worldPos, 1.0), pc.light.shadowTexture, pc.light.shadowSampler );
+#endif
+}
@@ -0,0 +1,51 @@
+#include <../shaders/Impostor.sp>
+
+layout (location = 0) out vec2 uv;
+layout (location = 1) out vec3 planePos;      // world space, on the plane of the frame
+layout (location = 2) out flat vec3 depthAxis; // world space, from the near plane of the frame to the center
+layout (location = 3) out flat vec4 frameRect; // UV
+layout (location = 4) out flat mat3 normalMatrix;
+layout (location = 7) out flat float fade;
+
+const vec2 kCorners[6] = vec2[]( vec2(-1, -1), vec2(1, -1), vec2(1, 1), vec2(1, 1), vec2(-1, 1), vec2(-1, -1) );
+
+// One quad per instance, facing the viewer. It samples the frame closest to the view direction: every corner is projected along the
+// view ray onto the plane the frame was rendered on, which keeps the silhouette in place while the frame is off by a few degrees
+void main() {
+	const ImpostorInstance inst = pc.instances.instances[gl_InstanceIndex];
+	const Impostor imp          = pc.impostors.impostors[inst.impostor];
+	const mat4 model            = pc.transforms.model[inst.transformId];
+	const mat3 invModel         = inverse(mat3(model));
+
+	const vec3  center = imp.centerRadius.xyz;
+	const float radius = imp.centerRadius.w;
+
+	// everything below in the local space of the mesh
+	const vec3 eyeLocal = pc.eye.w > 0.0 ? invModel * (pc.eye.xyz - model[3].xyz) : vec3(0.0);
+	const vec3 viewDir  = normalize(pc.eye.w > 0.0 ? eyeLocal - center : invModel * pc.eye.xyz);
+
+	const vec2 frame    = clamp(round((octEncode(viewDir) * 0.5 + 0.5) * float(kFramesPerSide - 1)), 0.0, float(kFramesPerSide - 1));
+	const vec3 frameDir = octDecode(frame / float(kFramesPerSide - 1) * 2.0 - 1.0);
+
+	vec3 right, up;
+	frameBasis(viewDir, right, up);
+	const vec2 corner = kCorners[gl_VertexIndex];
+	const vec3 p      = center + (corner.x * right + corner.y * up) * radius;
+
+	vec3 frameRight, frameUp;
+	frameBasis(frameDir, frameRight, frameUp);
+	const vec3 rayDir = pc.eye.w > 0.0 ? p - eyeLocal : -viewDir;
+	const vec3 q      = p + rayDir * (dot(center - p, frameDir) / dot(rayDir, frameDir));
+	const vec2 f      = vec2(dot(q - center, frameRight), dot(q - center, frameUp)) / radius;
+
+	// the viewport of the bake is flipped like all the others, +y of the frame is at the top of the tile
+	const vec2 frameUV = imp.tile.xy + frame * imp.tile.z;
+	uv           = frameUV + vec2(0.5 + 0.5 * f.x, 0.5 - 0.5 * f.y) * imp.tile.z;
+	frameRect    = vec4(frameUV, frameUV + imp.tile.z);
+	planePos     = (model * vec4(q, 1.0)).xyz;
+	depthAxis    = mat3(model) * (frameDir * radius);
+	normalMatrix = mat3(model);
+	fade         = inst.fade;
+
+	gl_Position = pc.viewProj * model * vec4(p, 1.0);
+}
@@ -0,0 +1,24 @@
+#include <../shaders/common.sp>
+
+layout ( location = 0 ) in vec2 uv;
+layout ( location = 1 ) in vec3 normal;
+layout ( location = 2 ) in flat uint materialId;
+
+layout ( location = 0 ) out vec4 out_Albedo;
+layout ( location = 1 ) out vec4 out_NormalDepth;
+
+void main() {
+	MetallicRoughnessDataGPU mat = pc.materials.material[materialId];
+
+	vec4 baseColor = mat.baseColorFactor * (mat.baseColorTexture > 0 ? textureBindless2D(mat.baseColorTexture, 0, uv) : vec4(1.0));
+
+	// plain alpha test, the frames are small enough that the dithering of main.frag would only add noise
+	if (baseColor.a < mat.emissiveFactorAlphaCutoff.w)
+		discard;
+
+	// leaves are seen from both sides
+	const vec3 n = normalize(normal) * (gl_FrontFacing ? 1.0 : -1.0);
+
+	out_Albedo      = vec4(baseColor.rgb, 1.0);
+	out_NormalDepth = vec4(n * 0.5 + 0.5, gl_FragCoord.z);
+}
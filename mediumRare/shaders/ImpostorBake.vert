@@ -0,0 +1,16 @@
+#include <../shaders/common.sp>
+#include <../shaders/VertexInput.sp>
+
+layout ( location = 0 ) out vec2 uv;
+layout ( location = 1 ) out vec3 normal;
+layout ( location = 2 ) out flat uint materialId;
+
+// One frame of an impostor atlas, see mr::Impostors::bake(). pc.viewProj is the orthographic projection of the frame
+// in the local space of the mesh, the instance only provides the material
+void main() {
+	gl_Position = pc.viewProj * vec4( getVertexPosition(), 1.0 );
+	vec2 tc     = getVertexUV();
+	uv          = vec2( tc.x, 1.0 - tc.y );
+	normal      = getVertexNormal();
+	materialId  = pc.drawData.dd[gl_InstanceIndex].materialId;
+}
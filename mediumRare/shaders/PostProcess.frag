@@ -0,0 +1,78 @@
+layout (location=0) out vec4 out_FragColor;
+
+#include <../shaders/ToneMapping.sp>
+
+// Fused SSAO combine + exposure + tone mapping + bloom composite: one read of the HDR buffer, one write of the final color straight
+// into the present texture, whose format does the encoding. The operator is baked into the pipeline instead of the runtime branch of
+// ToneMap.frag
+layout (constant_id = 0) const int  kToneMappingMode = ToneMappingMode_None;
+layout (constant_id = 1) const bool kSSAO            = false;
+
+// Written by Luminance.comp
+layout(std430, buffer_reference) readonly buffer LuminanceBuffer {
+  float adaptedLuminance;
+};
+
+layout(push_constant) uniform PushConstants {
+  LuminanceBuffer lum;
+  uint texColor;
+  uint texSSAO;
+  uint texBloom;
+  uint smpl;
+
+  // SSAO combine
+  float ssaoScale;
+  float ssaoBias;
+
+  float exposure;
+  float bloomStrength;
+
+  // Reinhard
+  float maxWhite;
+
+  // Uchimura
+  float P;  // max display brightness
+  float a;  // contrast
+  float m;  // linear section start
+  float l;  // linear section length
+  float c;  // black tightness
+  float b;  // pedestal
+
+  // Khronos PBR
+  float startCompression;  // highlight compression start
+  float desaturation;      // desaturation speed
+} pc;
+
+void main() {
+  // the framebuffer has the size of the HDR buffer, one pixel per texel
+  const ivec2 xy = ivec2(gl_FragCoord.xy);
+  const vec2  uv = gl_FragCoord.xy / vec2(textureSize(nonuniformEXT(kTextures2D[pc.texColor]), 0));
+
+  vec3 color = texelFetch(nonuniformEXT(kTextures2D[pc.texColor]), xy, 0).rgb;
+
+  // same as combine.frag
+  if (kSSAO) {
+    const float ssao = clamp(texelFetch(nonuniformEXT(kTextures2D[pc.texSSAO]), xy, 0).x + pc.ssaoBias, 0.0, 1.0);
+    color = mix(color, color * ssao, pc.ssaoScale);
+  }
+
+  // same as ToneMap.frag
+  if (kToneMappingMode != ToneMappingMode_None) {
+    const float midGray = 0.5;
+    color *= pc.exposure * midGray / (pc.lum.adaptedLuminance + 0.001);
+  }
+
+  if (kToneMappingMode == ToneMappingMode_Reinhard) {
+    color = reinhard2(pc.exposure * color, pc.maxWhite);
+  }
+  if (kToneMappingMode == ToneMappingMode_Uchimura) {
+    color = uchimura(pc.exposure * color, pc.P, pc.a, pc.m, pc.l, pc.c, pc.b);
+  }
+  if (kToneMappingMode == ToneMappingMode_KhronosPBR) {
+    color = PBRNeutralToneMapping(pc.exposure * color, pc.startCompression, pc.desaturation);
+  }
+
+  const vec3 bloom = textureBindless2D(pc.texBloom, pc.smpl, uv).rgb;
+
+  out_FragColor = vec4(color + pc.bloomStrength * bloom, 1.0);
+}
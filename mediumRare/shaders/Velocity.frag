@@ -0,0 +1,15 @@
+#include <../shaders/Velocity.sp>
+
+layout ( location = 0 ) in vec4 clipPos;
+layout ( location = 1 ) in vec4 prevClipPos;
+
+layout (location=0) out vec4 out_Velocity;
+
+void main() {
+	// Both unjittered, in UV units. The viewport is flipped, so UV and NDC have opposite y
+	vec2 ndc     = clipPos.xy / clipPos.w - pc.motion.jitter.xy;
+	vec2 prevNdc = prevClipPos.xy / prevClipPos.w;
+
+	// z marks the texels that have object motion, TAA.comp reprojects the others with the camera
+	out_Velocity = vec4((ndc - prevNdc) * vec2(0.5, -0.5), 1.0, 1.0);
+}
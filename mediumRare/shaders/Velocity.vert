@@ -0,0 +1,20 @@
+#include <../shaders/Velocity.sp>
+#include <../shaders/VertexInput.sp>
+
+layout ( location = 0 ) out vec4 clipPos;
+layout ( location = 1 ) out vec4 prevClipPos;
+
+// Depth has to match the main pass exactly, it is tested with CompareOp_LessEqual against it
+invariant gl_Position;
+
+void main() {
+	uint transformId = pc.drawData.dd[gl_InstanceIndex].transformId;
+	mat4 model       = pc.transforms.model[transformId];
+	mat4 prevModel   = pc.prevTransforms.model[transformId];
+
+	vec3 pos         = getVertexPosition();
+
+	gl_Position = pc.motion.viewProj * model * vec4(pos, 1.0);
+	clipPos     = gl_Position;
+	prevClipPos = pc.motion.prevViewProj * prevModel * vec4(pos, 1.0);
+}
@@ -1,8 +1,5 @@
 #include <../shaders/common.sp>
-
-layout ( location = 0 ) in vec3 in_pos;
-layout ( location = 1 ) in vec2 in_tc;
-layout ( location = 2 ) in vec3 in_normal;
+#include <../shaders/VertexInput.sp>
 
 layout ( location = 0 ) out vec2 uv;
 layout ( location = 1 ) out vec3 normal;
@@ -10,14 +7,19 @@ layout ( location = 2 ) out vec3 worldPos;
 layout ( location = 3 ) out flat uint materialId;
 layout ( location = 4 ) out vec4 shadowCoords;
 
+// Velocity.vert redraws moved nodes against this depth with CompareOp_LessEqual
+invariant gl_Position;
+
 void main() {
-	mat4 model   = pc.transforms.model[pc.drawData.dd[gl_BaseInstance].transformId];
-	gl_Position  = pc.viewProj * model * vec4(in_pos, 1.0);
-	uv           = vec2(in_tc.x, 1.0-in_tc.y);
-	normal       = transpose( inverse(mat3(model)) ) * in_normal;
-	vec4 posClip = model * vec4(in_pos, 1.0);
+	mat4 model   = pc.transforms.model[pc.drawData.dd[gl_InstanceIndex].transformId];
+	vec3 pos     = getVertexPosition();
+	gl_Position  = pc.viewProj * model * vec4(pos, 1.0);
+	vec2 tc      = getVertexUV();
+	uv           = vec2(tc.x, 1.0-tc.y);
+	normal       = transpose( inverse(mat3(model)) ) * getVertexNormal();
+	vec4 posClip = model * vec4(pos, 1.0);
 	worldPos     = posClip.xyz/posClip.w;
-	materialId   = pc.drawData.dd[gl_BaseInstance].materialId;
+	materialId   = pc.drawData.dd[gl_InstanceIndex].materialId;
 
 	shadowCoords = pc.light.viewProjBias * posClip;
 }
@@ -0,0 +1,86 @@
+#include "../include/AllocationCounter.hpp"
+
+#if MR_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+namespace {
+	std::atomic<u64> numAllocations = 0;
+
+	void *allocate( size_t size ) {
+		numAllocations.fetch_add( 1, std::memory_order_relaxed );
+		return malloc( size ? size : 1 );
+	}
+
+	void *allocateAligned( size_t size, std::align_val_t alignment ) {
+		numAllocations.fetch_add( 1, std::memory_order_relaxed );
+		const size_t align = static_cast<size_t>( alignment );
+#if defined(_WIN32)
+		return _aligned_malloc( size ? size : 1, align );
+#else
+		// aligned_alloc() wants the size to be a multiple of the alignment
+		return aligned_alloc( align, ( ( size ? size : 1 ) + align - 1 ) & ~( align - 1 ) );
+#endif
+	}
+
+	void freeAligned( void *ptr ) {
+#if defined(_WIN32)
+		_aligned_free( ptr );
+#else
+		free( ptr );
+#endif
+	}
+}
+
+u64 mr::GetNumAllocations() {
+	return numAllocations.load( std::memory_order_relaxed );
+}
+
+void *operator new( size_t size ) {
+	if ( void *ptr = allocate( size ) )
+		return ptr;
+	throw std::bad_alloc();
+}
+void *operator new[]( size_t size ) {
+	if ( void *ptr = allocate( size ) )
+		return ptr;
+	throw std::bad_alloc();
+}
+void *operator new( size_t size, const std::nothrow_t& ) noexcept   { return allocate( size ); }
+void *operator new[]( size_t size, const std::nothrow_t& ) noexcept { return allocate( size ); }
+
+void *operator new( size_t size, std::align_val_t alignment ) {
+	if ( void *ptr = allocateAligned( size, alignment ) )
+		return ptr;
+	throw std::bad_alloc();
+}
+void *operator new[]( size_t size, std::align_val_t alignment ) {
+	if ( void *ptr = allocateAligned( size, alignment ) )
+		return ptr;
+	throw std::bad_alloc();
+}
+void *operator new( size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept   { return allocateAligned( size, alignment ); }
+void *operator new[]( size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept { return allocateAligned( size, alignment ); }
+
+void operator delete( void *ptr ) noexcept                                               { free( ptr ); }
+void operator delete[]( void *ptr ) noexcept                                             { free( ptr ); }
+void operator delete( void *ptr, size_t ) noexcept                                       { free( ptr ); }
+void operator delete[]( void *ptr, size_t ) noexcept                                     { free( ptr ); }
+void operator delete( void *ptr, const std::nothrow_t& ) noexcept                        { free( ptr ); }
+void operator delete[]( void *ptr, const std::nothrow_t& ) noexcept                      { free( ptr ); }
+void operator delete( void *ptr, std::align_val_t ) noexcept                             { freeAligned( ptr ); }
+void operator delete[]( void *ptr, std::align_val_t ) noexcept                           { freeAligned( ptr ); }
+void operator delete( void *ptr, size_t, std::align_val_t ) noexcept                     { freeAligned( ptr ); }
+void operator delete[]( void *ptr, size_t, std::align_val_t ) noexcept                   { freeAligned( ptr ); }
+void operator delete( void *ptr, std::align_val_t, const std::nothrow_t& ) noexcept      { freeAligned( ptr ); }
+void operator delete[]( void *ptr, std::align_val_t, const std::nothrow_t& ) noexcept    { freeAligned( ptr ); }
+
+#else
+
+u64 mr::GetNumAllocations() {
+	return 0;
+}
+
+#endif // MR_TRACK_ALLOCATIONS
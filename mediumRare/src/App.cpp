@@ -1,5 +1,10 @@
 #include "../include/App.hpp"
 
+#include <lvk/vulkan/VulkanClasses.h>
+
+#include <algorithm>
+#include <chrono>
+
 extern std::unordered_map<u32, std::string> debugGLSLSourceCode;
 static void shaderModuleCallback( lvk::IContext *_, lvk::ShaderModuleHandle handle, s32 line, s32 col, const char *debugName ) {
 	const auto it = debugGLSLSourceCode.find( handle.index() );
@@ -8,85 +13,131 @@ static void shaderModuleCallback( lvk::IContext *_, lvk::ShaderModuleHandle hand
 	}
 }
 
-mr::App::App( std::string skyboxTexFilename, std::string skyboxIrrFilename ) {
+// Same as lvk::createVulkanContextWithSwapchain() but without a surface and a swapchain
+static std::unique_ptr<lvk::IContext> createHeadlessContext( const lvk::ContextConfig &cfg, bool softwareDevice ) {
+	std::unique_ptr<lvk::VulkanContext> ctx = std::make_unique<lvk::VulkanContext>( cfg, nullptr );
+
+	const lvk::HWDeviceType hardwareFirst[] = { lvk::HWDeviceType_Discrete, lvk::HWDeviceType_Integrated, lvk::HWDeviceType_Software };
+	const lvk::HWDeviceType softwareFirst[] = { lvk::HWDeviceType_Software, lvk::HWDeviceType_Discrete, lvk::HWDeviceType_Integrated };
+
+	lvk::HWDeviceDesc device;
+	bool found = false;
+	for ( const lvk::HWDeviceType type : softwareDevice ? softwareFirst : hardwareFirst ) {
+		if ( ctx->queryDevices( type, &device, 1 ) ) {
+			found = true;
+			break;
+		}
+	}
+	if ( !found ) {
+		printf( "[ERROR] No Vulkan device found\n" );
+		return nullptr;
+	}
+	printf( "[INFO] Headless Vulkan device: %s\n", device.name );
+
+	if ( !ctx->initContext( device ).isOk() ) {
+		printf( "[ERROR] Cannot initialize a headless Vulkan context\n" );
+		return nullptr;
+	}
+	return ctx;
+}
+
+mr::App::App( const AppConfig &cfg, std::string skyboxTexFilename, std::string skyboxIrrFilename ) : config( cfg ) {
 	minilog::initialize( nullptr, { .threadNames = false } );
 
 	s32 width = -95, height = -90;
 
-	window = lvk::initWindow( "MediumRare", width, height );
-	ctx    = lvk::createVulkanContextWithSwapchain(
-		window, width, height, 
-		{
-			.enableValidation = true,
-			.shaderModuleErrorCallback = &shaderModuleCallback
+	const lvk::ContextConfig ctxConfig = {
+		.enableValidation = true,
+		.shaderModuleErrorCallback = &shaderModuleCallback
+	};
+	if ( config.headless ) {
+		width  = s32( config.width );
+		height = s32( config.height );
+		ctx    = createHeadlessContext( ctxConfig, config.softwareDevice );
+		if ( !ctx )
+			exit( 0xF1 );
+		presentTexture = ctx->createTexture({
+			.format     = lvk::Format_RGBA_UN8,
+			.dimensions = { u32(width), u32(height) },
+			.usage      = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
+			.debugName  = "Headless: present"
 		});
-	depthTexture = ctx->createTexture({
-		.type       = lvk::TextureType_2D,
-		.format     = lvk::Format_Z_F32,
-		.dimensions = { u32(width), u32(height) },
-		.usage      = lvk::TextureUsageBits_Attachment,
-		.debugName  = "Depth Buffer"
-	});
+	} else {
+		window = lvk::initWindow( "MediumRare", width, height );
+		ctx    = lvk::createVulkanContextWithSwapchain( window, width, height, ctxConfig );
+	}
+	createDepthTexture( u32(width), u32(height) );
 	
-	imgui = std::make_unique<lvk::ImGuiRenderer>( *ctx, "../../data/OpenSans-Light.ttf", 20.0f );
+	imgui     = std::make_unique<lvk::ImGuiRenderer>( *ctx, "../../data/OpenSans-Light.ttf", 20.0f );
+	implotCtx = ImPlot::CreateContext();
 
-	glfwSetWindowUserPointer( window, this );
-	glfwSetMouseButtonCallback( window, []( GLFWwindow *window, s32 button, s32 action, s32 mods ) {
-		App *app = (App*)glfwGetWindowUserPointer( window );
-		if ( button == GLFW_MOUSE_BUTTON_LEFT ) {
-			app->mouseState.pressedLeft = action == GLFW_PRESS;
-		}
+	if ( window ) {
+		glfwSetWindowUserPointer( window, this );
+		glfwSetMouseButtonCallback( window, []( GLFWwindow *window, s32 button, s32 action, s32 mods ) {
+			App *app = (App*)glfwGetWindowUserPointer( window );
+			if ( button == GLFW_MOUSE_BUTTON_LEFT ) {
+				app->mouseState.pressedLeft = action == GLFW_PRESS;
+			}
 
-		f64 xpos, ypos;
-		glfwGetCursorPos( window, &xpos, &ypos );
-		const ImGuiMouseButton_ imguiButton = ( button == GLFW_MOUSE_BUTTON_LEFT )
-			                                ? ImGuiMouseButton_Left
-											: ( button == GLFW_MOUSE_BUTTON_RIGHT )
-											? ImGuiMouseButton_Right
-											: ImGuiMouseButton_Middle;
-		ImGuiIO &io               = ImGui::GetIO();
-		io.MousePos               = ImVec2( f32(xpos), f32(ypos) );
-		io.MouseDown[imguiButton] = action == GLFW_PRESS;
-		for ( auto &callback : app->mouseButtonCallbacks ) {
-			callback( window, button, action, mods );
-		}
-	});
-	glfwSetScrollCallback( window, []( GLFWwindow *window, f64 dx, f64 dy ) {
-		ImGuiIO &io    = ImGui::GetIO();
-		io.MouseWheelH = f32(dx);
-		io.MouseWheel  = f32(dy);
-	});
-	glfwSetCursorPosCallback( window, []( GLFWwindow *window, f64 x, f64 y) {
-		App *app = (App*)glfwGetWindowUserPointer( window );
-		s32 width, height;
-		glfwGetFramebufferSize( window, &width, &height );
-		ImGui::GetIO().MousePos = ImVec2( x, y );
-		app->mouseState.pos.x = static_cast<f32>( x / width );
-		app->mouseState.pos.y = 1.0f - static_cast<f32>( y / height );
-	});
-	glfwSetKeyCallback( window, []( GLFWwindow *window, s32 key, s32 scanCode, s32 action, s32 mods ) {
-		App *app = (App*)glfwGetWindowUserPointer( window );
-		const bool pressed = action != GLFW_RELEASE;
-		if ( key == GLFW_KEY_ESCAPE && pressed ) {
-			glfwSetWindowShouldClose( window, GLFW_TRUE );
-		}
-		if ( key == GLFW_KEY_W ) app->fpsPositioner.movement_.forward_  = pressed;
-		if ( key == GLFW_KEY_S ) app->fpsPositioner.movement_.backward_ = pressed;
-		if ( key == GLFW_KEY_A ) app->fpsPositioner.movement_.left_     = pressed;
-		if ( key == GLFW_KEY_D ) app->fpsPositioner.movement_.right_    = pressed;
-		if ( key == GLFW_KEY_1 ) app->fpsPositioner.movement_.up_       = pressed;
-		if ( key == GLFW_KEY_2 ) app->fpsPositioner.movement_.down_     = pressed;
-
-		app->fpsPositioner.movement_.fastSpeed_ = ( mods & GLFW_MOD_SHIFT ) != 0;
-
-		if ( key == GLFW_KEY_SPACE ) {
-			app->fpsPositioner.lookAt( kInitialCameraPos, kInitialCameraTarget, vec3( 0.0f, 1.0f, 0.0f ) );
-			app->fpsPositioner.setSpeed( vec3(0.0f) );
-		}
-		for ( auto &callback : app->keyCallbacks ) {
-			callback( window, key, scanCode, action, mods );
-		}
-	});
+			f64 xpos, ypos;
+			glfwGetCursorPos( window, &xpos, &ypos );
+			const ImGuiMouseButton_ imguiButton = ( button == GLFW_MOUSE_BUTTON_LEFT )
+				                                ? ImGuiMouseButton_Left
+												: ( button == GLFW_MOUSE_BUTTON_RIGHT )
+												? ImGuiMouseButton_Right
+												: ImGuiMouseButton_Middle;
+			ImGuiIO &io               = ImGui::GetIO();
+			io.MousePos               = ImVec2( f32(xpos), f32(ypos) );
+			io.MouseDown[imguiButton] = action == GLFW_PRESS;
+			app->requestRedraw();
+			for ( auto &callback : app->mouseButtonCallbacks ) {
+				callback( window, button, action, mods );
+			}
+		});
+		glfwSetScrollCallback( window, []( GLFWwindow *window, f64 dx, f64 dy ) {
+			ImGuiIO &io    = ImGui::GetIO();
+			io.MouseWheelH = f32(dx);
+			io.MouseWheel  = f32(dy);
+			( (App*)glfwGetWindowUserPointer( window ) )->requestRedraw();
+		});
+		glfwSetCursorPosCallback( window, []( GLFWwindow *window, f64 x, f64 y) {
+			App *app = (App*)glfwGetWindowUserPointer( window );
+			s32 width, height;
+			glfwGetFramebufferSize( window, &width, &height );
+			ImGui::GetIO().MousePos = ImVec2( x, y );
+			app->mouseState.pos.x = static_cast<f32>( x / width );
+			app->mouseState.pos.y = 1.0f - static_cast<f32>( y / height );
+			app->requestRedraw();
+		});
+		glfwSetKeyCallback( window, []( GLFWwindow *window, s32 key, s32 scanCode, s32 action, s32 mods ) {
+			App *app = (App*)glfwGetWindowUserPointer( window );
+			const bool pressed = action != GLFW_RELEASE;
+			if ( key == GLFW_KEY_ESCAPE && pressed ) {
+				glfwSetWindowShouldClose( window, GLFW_TRUE );
+			}
+			if ( key == GLFW_KEY_W ) app->fpsPositioner.movement_.forward_  = pressed;
+			if ( key == GLFW_KEY_S ) app->fpsPositioner.movement_.backward_ = pressed;
+			if ( key == GLFW_KEY_A ) app->fpsPositioner.movement_.left_     = pressed;
+			if ( key == GLFW_KEY_D ) app->fpsPositioner.movement_.right_    = pressed;
+			if ( key == GLFW_KEY_1 ) app->fpsPositioner.movement_.up_       = pressed;
+			if ( key == GLFW_KEY_2 ) app->fpsPositioner.movement_.down_     = pressed;
+
+			app->fpsPositioner.movement_.fastSpeed_ = ( mods & GLFW_MOD_SHIFT ) != 0;
+
+			if ( key == GLFW_KEY_SPACE ) {
+				app->fpsPositioner.lookAt( kInitialCameraPos, kInitialCameraTarget, vec3( 0.0f, 1.0f, 0.0f ) );
+				app->fpsPositioner.setSpeed( vec3(0.0f) );
+			}
+			for ( auto &callback : app->keyCallbacks ) {
+				callback( window, key, scanCode, action, mods );
+			}
+			app->requestRedraw();
+		});
+		// Exposed, resized or restored
+		glfwSetWindowRefreshCallback( window, []( GLFWwindow *window ) {
+			( (App*)glfwGetWindowUserPointer( window ) )->requestRedraw();
+		});
+	}
 
 	// Default Render Options
 	std::fill( &options[0], &options[RendererOption::MAX], false );
@@ -95,8 +146,12 @@ mr::App::App( std::string skyboxTexFilename, std::string skyboxIrrFilename ) {
 	options[RendererOption::SSAO]	         = true;
 	options[RendererOption::BlurSSAO]        = true;
 	options[RendererOption::Bloom]           = true;
+	options[RendererOption::FusedPostProcess] = true;
 	options[RendererOption::ToneMappingNone] = true;
 	options[RendererOption::CullingCPU]	     = true;
+	options[RendererOption::HLODProxies]     = true;
+	options[RendererOption::TreeImpostors]   = true;
+	options[RendererOption::PVSCulling]      = true;
 
 	// Initialize Grid
 	gridPipeline = new Pipeline( ctx, {}, lvk::Format_RGBA_F16, getDepthFormat(), 1,
@@ -127,35 +182,145 @@ mr::App::~App() {
 	skyboxTexture    = nullptr;
 	skyboxIrradiance = nullptr;
 
-	imgui        = nullptr;
-	depthTexture = nullptr;
-	ctx          = nullptr;
+	ImPlot::DestroyContext( implotCtx );
+	imgui          = nullptr;
+	depthTexture   = nullptr;
+	presentTexture = nullptr;
+	ctx            = nullptr;
 
-	glfwDestroyWindow( window );
-	glfwTerminate();
+	if ( window ) {
+		glfwDestroyWindow( window );
+		glfwTerminate();
+	}
+}
+
+void mr::App::createDepthTexture( u32 width, u32 height ) {
+	depthTexture = ctx->createTexture({
+		.type       = lvk::TextureType_2D,
+		.format     = lvk::Format_Z_F32,
+		.dimensions = { width, height },
+		.usage      = lvk::TextureUsageBits_Attachment,
+		.debugName  = "Depth Buffer"
+	});
+}
+
+f64 mr::App::getTimeSeconds( void ) const {
+	if ( window )
+		return glfwGetTime();
+
+	// GLFW is not initialized in headless mode
+	return std::chrono::duration<f64>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+lvk::SubmitHandle mr::App::submitFrame( lvk::ICommandBuffer &buf ) {
+	const lvk::SubmitHandle handle = ctx->submit( buf, config.headless ? lvk::TextureHandle() : ctx->getCurrentSwapchainTexture() );
+	submittedFrames[numSubmittedFrames++ % kMaxFramesInFlight] = { .handle = handle, .inputTime = inputTime };
+	return handle;
+}
+
+// Blocks until at most maxFramesInFlight - 1 frames are still executing on the GPU, so the input sampled next
+// is not queued behind them. The time the wait returns is the latency measurement: an upper bound of when the GPU
+// finished the frame, exact whenever the wait actually blocked, and it does not include the presentation engine and scanout.
+// Every frame is measured once: the iterations that submit nothing (idle, minimized) would measure the same frame again
+void mr::App::waitForFrameInFlight( void ) {
+	const u32 maxFramesInFlight = lowLatency.enabled ? std::clamp( u32( lowLatency.maxFramesInFlight ), 1u, kMaxFramesInFlight ) : kMaxFramesInFlight;
+	if ( numSubmittedFrames < maxFramesInFlight )
+		return;
+
+	const u64 frameIndex = numSubmittedFrames - maxFramesInFlight;
+	if ( frameIndex < numMeasuredFrames )
+		return;
+	numMeasuredFrames = frameIndex + 1;
+
+	const SubmittedFrame &frame = submittedFrames[frameIndex % kMaxFramesInFlight];
+	if ( frame.handle.empty() ) // waiting on an empty handle waits for the whole device
+		return;
+	ctx->wait( frame.handle );
+
+	const f64 now       = getTimeSeconds();
+	const f32 latencyMs = f32( ( now - frame.inputTime ) * 1000.0 );
+	lowLatency.latencyMs = lowLatency.latencyMs > 0.0f ? glm::mix( lowLatency.latencyMs, latencyMs, 0.1f ) : latencyMs;
+	if ( now - maxLatencyResetTime > 1.0 ) {
+		lowLatency.maxLatencyMs = 0.0f;
+		maxLatencyResetTime     = now;
+	}
+	lowLatency.maxLatencyMs = std::max( lowLatency.maxLatencyMs, latencyMs );
 }
 
 void mr::App::run( std::function<void( u32 width, u32 height, f32 aspectRatio, f32 deltaSeconds )> drawFunc ) {
-	f64 timeStamp    = glfwGetTime();
+	f64 timeStamp    = getTimeSeconds();
 	f32 deltaSeconds = 0.0f;
 
-	s32 width, height;
-	while ( !glfwWindowShouldClose( window ) ) {
-		fpsCounter.tick( deltaSeconds );
-		const f64 newTimeStamp = glfwGetTime();
+	// On-demand rendering: a frame is drawn when there was input, the camera moved or a redraw was requested,
+	// then for onDemand.settleSeconds, and after that only every 1 / onDemand.minRefreshRate seconds
+	f64  lastChangeTime = timeStamp;
+	f64  lastDrawTime   = timeStamp;
+	mat4 lastView       = camera.getViewMatrix();
+	bool consecutive    = false; // the previous iteration drew a frame and nothing was waited for since
+
+	s32 width = s32( config.width ), height = s32( config.height );
+	while ( !exitRequested && ( !window || !glfwWindowShouldClose( window ) ) ) {
+		const bool onDemandEnabled = window && onDemand.enabled;
+		const f64  refreshInterval = 1.0 / std::max( onDemand.minRefreshRate, 0.01f );
+
+		// Throttle before sampling the input, not after recording the frame, so the input is as fresh as possible
+		// when the camera is updated and the view matrix is baked into the push constants
+		waitForFrameInFlight();
+
+		if ( window ) {
+			const f64 now = getTimeSeconds();
+			if ( onDemandEnabled && !redrawRequested && now - lastChangeTime > onDemand.settleSeconds ) {
+				// Sleep until an event arrives or the next refresh is due
+				glfwWaitEventsTimeout( std::max( lastDrawTime + refreshInterval - now, 0.0 ) );
+				consecutive = false;
+			} else {
+				glfwPollEvents();
+			}
+			glfwGetFramebufferSize( window, &width, &height );
+			if ( !width || !height )
+				continue;
+
+			// The render targets of drawFunc follow the size it is called with
+			const lvk::Dimensions size = ctx->getDimensions( depthTexture );
+			if ( u32(width) != size.width || u32(height) != size.height ) {
+				ctx->recreateSwapchain( width, height );
+				createDepthTexture( u32(width), u32(height) );
+				requestRedraw();
+			}
+		}
+
+		const f64 newTimeStamp = getTimeSeconds();
 		deltaSeconds           = static_cast<f32>( newTimeStamp - timeStamp );
 		timeStamp              = newTimeStamp;
-
-		glfwPollEvents();
-		glfwGetFramebufferSize( window, &width, &height );
-		if ( !width || !height )
-			continue;
+		inputTime              = newTimeStamp;
 
 		const f32 ratio = width / f32(height);
+		const f32 dt    = config.fixedDeltaSeconds > 0.0f ? config.fixedDeltaSeconds : deltaSeconds;
+
+		fpsPositioner.update( dt, mouseState.pos, ImGui::GetIO().WantCaptureMouse ? false : mouseState.pressedLeft );
+		moveToPositioner.update( dt, mouseState.pos, mouseState.pressedLeft );
+
+		const mat4 view = camera.getViewMatrix();
+		if ( redrawRequested || view != lastView ) {
+			lastChangeTime  = timeStamp;
+			lastView        = view;
+			redrawRequested = false;
+		}
+		onDemand.idle = onDemandEnabled && timeStamp - lastChangeTime > onDemand.settleSeconds;
+		if ( onDemand.idle && timeStamp - lastDrawTime < refreshInterval ) {
+			consecutive = false;
+			continue;
+		}
 
-		fpsPositioner.update( deltaSeconds, mouseState.pos, ImGui::GetIO().WantCaptureMouse ? false : mouseState.pressedLeft );
-		moveToPositioner.update( deltaSeconds, mouseState.pos, mouseState.pressedLeft );
-		drawFunc( u32(width), u32(height), ratio, deltaSeconds );
+		// Frame times are only meaningful between consecutive frames, not across an idle period
+		if ( consecutive )
+			fpsCounter.tick( deltaSeconds );
+		else
+			fpsCounter.skipFrame();
+		frameArena.reset();
+		drawFunc( u32(width), u32(height), ratio, dt );
+		lastDrawTime = timeStamp;
+		consecutive  = !onDemand.idle;
 	}
 }
 
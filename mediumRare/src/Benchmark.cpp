@@ -0,0 +1,327 @@
+#include "../include/Benchmark.hpp"
+#include "../include/RendererOptions.hpp"
+#include "../include/AllocationCounter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+	struct CameraKeyframe {
+		vec3 pos;
+		vec3 target;
+	};
+
+	// Closed loop through the Bistro exterior: street level, the terrace and a higher view over the square
+	const CameraKeyframe kCameraPath[] = {
+		{ vec3(   0.0f, 1.0f,  -1.5f ), vec3( 0.0f, 0.5f,  0.0f ) },
+		{ vec3(  -6.0f, 2.0f,  -6.0f ), vec3( 0.0f, 1.0f,  0.0f ) },
+		{ vec3( -10.0f, 1.7f,   4.0f ), vec3( 0.0f, 1.0f,  2.0f ) },
+		{ vec3(   4.0f, 3.0f,  10.0f ), vec3( 0.0f, 1.0f,  0.0f ) },
+		{ vec3(  12.0f, 1.7f,  -2.0f ), vec3( 0.0f, 1.5f, -2.0f ) },
+	};
+	constexpr u32 kNumCameraKeyframes = sizeof(kCameraPath) / sizeof(kCameraPath[0]);
+
+	constexpr u32 kDefaultNumFrames = 600;
+
+	// Evenly spaced over the duration, back to the first keyframe at the end
+	std::vector<CameraPathKey> makeBuiltInCameraPath( f32 duration ) {
+		std::vector<CameraPathKey> keys;
+		for ( u32 i = 0; i <= kNumCameraKeyframes; ++i ) {
+			const CameraKeyframe &k = kCameraPath[i % kNumCameraKeyframes];
+			keys.push_back({
+				.time        = duration * f32( i ) / f32( kNumCameraKeyframes ),
+				.position    = k.pos,
+				.orientation = glm::quat_cast( glm::lookAt( k.pos, k.target, vec3( 0.0f, 1.0f, 0.0f ) ) )
+			});
+		}
+		return keys;
+	}
+
+	f64 getTimeMs() {
+		return std::chrono::duration<f64, std::milli>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	struct Percentiles {
+		f64 mean = 0.0;
+		f64 p50  = 0.0;
+		f64 p95  = 0.0;
+		f64 p99  = 0.0;
+		f64 max  = 0.0;
+	};
+
+	template <typename T>
+	Percentiles computePercentiles( const std::vector<T> &samples ) {
+		Percentiles p;
+		if ( samples.empty() )
+			return p;
+
+		std::vector<T> sorted = samples;
+		std::sort( sorted.begin(), sorted.end() );
+
+		f64 sum = 0.0;
+		for ( const T v : sorted )
+			sum += f64( v );
+
+		// nearest-rank percentiles
+		const auto rank = [&sorted]( f64 q ) -> f64 {
+			const size_t i = size_t( q * f64( sorted.size() ) + 0.5 );
+			return f64( sorted[std::min( i > 0 ? i - 1 : 0, sorted.size() - 1 )] );
+		};
+
+		p.mean = sum / f64( sorted.size() );
+		p.p50  = rank( 0.50 );
+		p.p95  = rank( 0.95 );
+		p.p99  = rank( 0.99 );
+		p.max  = f64( sorted.back() );
+		return p;
+	}
+
+	void writePercentiles( FILE *f, const char *name, const Percentiles &p, const char *suffix ) {
+		fprintf( f, "\"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s",
+			name, p.mean, p.p50, p.p95, p.p99, p.max, suffix );
+	}
+
+	// The compute pre-pass and the draws of the triangle culling in the main and in the shadow pass, see TriangleCuller. The shadow map
+	// is rendered without back-face culling and at a fixed size, so the pre-pass removes fewer of its triangles
+	struct CulledPass {
+		const char *name;
+		const char *cullScope;
+		const char *drawScope;
+	};
+	const CulledPass kTriangleCullingPasses[] = {
+		{ "main",   "Triangle Culling",        "Mesh" },
+		{ "shadow", "Shadow Triangle Culling", "Shadow Pass" },
+	};
+
+	void printUsage( const char *exe ) {
+		printf( "Usage: %s [--benchmark [--benchmark-output <file.json>] [--benchmark-frames <n>] [--benchmark-size <width>x<height>] [--camera-path <file>] [--software]]\n", exe );
+		printf( "       %s --sweep <all|factor,factor,...> [--sweep-viewpoints <n>] [--sweep-frames <n>] [--sweep-pass <scope,scope,...>] [benchmark options]\n", exe );
+		printf( "       [--quantized-vertices] [--vertex-pulling] [--batch-cell-size <size>] [--batch-alpha-cell-size <size>] [--shadow-every-frame] with any of the above or alone\n" );
+		printf( "       %s --occlusion-benchmark [--quantized-vertices], CPU only\n", exe );
+		printf( "       %s --bake-pvs, CPU only\n", exe );
+	}
+}
+
+bool mr::ParseBenchmarkArgs( int argc, char *argv[], BenchmarkConfig &cfg ) {
+	for ( s32 i = 1; i < argc; ++i ) {
+		const char *arg     = argv[i];
+		const bool  hasNext = i + 1 < argc;
+
+		if ( !strcmp( arg, "--benchmark" ) ) {
+			cfg.enabled = true;
+		} else if ( !strcmp( arg, "--software" ) ) {
+			cfg.softwareDevice = true;
+		} else if ( !strcmp( arg, "--quantized-vertices" ) ) {
+			cfg.quantizedVertices = true;
+		} else if ( !strcmp( arg, "--vertex-pulling" ) ) {
+			cfg.vertexPulling = true;
+		} else if ( !strcmp( arg, "--occlusion-benchmark" ) ) {
+			cfg.occlusionBenchmark = true;
+		} else if ( !strcmp( arg, "--bake-pvs" ) ) {
+			cfg.bakePVS = true;
+		} else if ( !strcmp( arg, "--shadow-every-frame" ) ) {
+			cfg.shadowEveryFrame = true;
+		} else if ( !strcmp( arg, "--batch-cell-size" ) && hasNext ) {
+			cfg.batchCellSize = f32( atof( argv[++i] ) );
+		} else if ( !strcmp( arg, "--batch-alpha-cell-size" ) && hasNext ) {
+			cfg.batchAlphaTestedCellSize = f32( atof( argv[++i] ) );
+		} else if ( !strcmp( arg, "--benchmark-output" ) && hasNext ) {
+			cfg.outputFileName = argv[++i];
+		} else if ( !strcmp( arg, "--benchmark-frames" ) && hasNext ) {
+			const s32 n = atoi( argv[++i] );
+			if ( n <= 0 ) {
+				printUsage( argv[0] );
+				return false;
+			}
+			cfg.numFrames = u32( n );
+		} else if ( !strcmp( arg, "--sweep" ) && hasNext ) {
+			cfg.enabled      = true;
+			cfg.sweepFactors = argv[++i];
+		} else if ( !strcmp( arg, "--sweep-pass" ) && hasNext ) {
+			cfg.sweepPass = argv[++i];
+		} else if ( ( !strcmp( arg, "--sweep-viewpoints" ) || !strcmp( arg, "--sweep-frames" ) ) && hasNext ) {
+			const s32 n = atoi( argv[++i] );
+			if ( n <= 0 ) {
+				printUsage( argv[0] );
+				return false;
+			}
+			( !strcmp( arg, "--sweep-viewpoints" ) ? cfg.sweepViewpoints : cfg.sweepMeasuredFrames ) = u32( n );
+		} else if ( !strcmp( arg, "--camera-path" ) && hasNext ) {
+			cfg.cameraPathFileName = argv[++i];
+			if ( !LoadCameraPath( cfg.cameraPathFileName, cfg.cameraPath, cfg.cameraPathHasOptions ) )
+				return false;
+		} else if ( !strcmp( arg, "--benchmark-size" ) && hasNext ) {
+			u32 w = 0, h = 0;
+			if ( sscanf( argv[++i], "%ux%u", &w, &h ) != 2 || !w || !h ) {
+				printUsage( argv[0] );
+				return false;
+			}
+			cfg.width  = w;
+			cfg.height = h;
+		} else {
+			printf( "[ERROR] Unknown argument '%s'\n", arg );
+			printUsage( argv[0] );
+			return false;
+		}
+	}
+	return true;
+}
+
+mr::Benchmark::Benchmark( const BenchmarkConfig &cfg ) : _cfg( cfg ) {
+	if ( cfg.cameraPath.empty() ) {
+		_numFrames = cfg.numFrames ? cfg.numFrames : kDefaultNumFrames;
+		_path.setKeys( makeBuiltInCameraPath( f32( _numFrames ) * cfg.fixedDeltaSeconds ), true );
+	} else {
+		const u32 pathFrames = std::max( 1u, u32( cfg.cameraPath.back().time / cfg.fixedDeltaSeconds ) );
+		_numFrames = cfg.numFrames ? cfg.numFrames : pathFrames;
+		_path.setKeys( cfg.cameraPath, true );
+	}
+
+	_cpuMs.reserve( _numFrames );
+	_frameMs.reserve( _numFrames );
+	_gpuFrameMs.reserve( _numFrames );
+	_numDraws.reserve( _numFrames );
+	_numTriangles.reserve( _numFrames );
+
+	// nothing may be allocated while measuring
+	_passes.resize( GPUProfiler::kMaxScopes );
+	for ( Series &pass : _passes )
+		pass.samples.reserve( _numFrames );
+}
+
+void mr::Benchmark::beginFrame( bool *options ) {
+	// warm-up frames stay on the first key, the path loops while the last GPU timings are collected
+	const u64 measuredFrame = _frameIndex > _cfg.warmupFrames ? _frameIndex - _cfg.warmupFrames : 0;
+	_path.setTime( f32( f64( measuredFrame ) * _cfg.fixedDeltaSeconds ) );
+
+	if ( _cfg.cameraPathHasOptions )
+		UnpackRendererOptions( _path.getCurrentKey().userFlags, options );
+}
+
+void mr::Benchmark::addFrame( f32 cpuMs, u32 numDraws, u64 numTriangles, u64 numAllocations, const GPUProfiler &profiler ) {
+	const f64 now       = getTimeMs();
+	const bool measured = _frameIndex >= _cfg.warmupFrames;
+
+	if ( measured && _cpuMs.size() < _numFrames ) {
+		_cpuMs.push_back( cpuMs );
+		_frameMs.push_back( _frameIndex > 0 ? f32( now - _lastFrameTimestamp ) : 0.0f );
+		_numDraws.push_back( numDraws );
+		_numTriangles.push_back( numTriangles );
+
+		if ( numAllocations ) {
+			if ( !_numFramesWithAllocations )
+				printf( "[ERROR] Frame %llu allocated %llu times on the heap\n", (unsigned long long)_frameIndex, (unsigned long long)numAllocations );
+			_numFramesWithAllocations++;
+			_numAllocations += numAllocations;
+		}
+	}
+	_lastFrameTimestamp = now;
+	_frameIndex++;
+
+	// at most one frame is resolved per GPUProfiler::beginFrame()
+	if ( profiler.getNumResolvedFrames() == _numResolvedFrames )
+		return;
+	_numResolvedFrames = profiler.getNumResolvedFrames();
+
+	const GPUProfiler::Scope &frame = profiler.getFrameScope();
+	if ( frame.lastFrame < _cfg.warmupFrames || _gpuFrameMs.size() >= _numFrames )
+		return;
+
+	_gpuFrameMs.push_back( frame.stats.last );
+
+	for ( u32 i = 1; i < profiler.getNumScopes(); ++i ) {
+		const GPUProfiler::Scope &scope = profiler.getScope( i );
+		_passes[i].name  = scope.name;
+		_passes[i].depth = scope.depth;
+		// only the passes that were rendered in this frame
+		if ( scope.lastFrame == frame.lastFrame )
+			_passes[i].samples.push_back( scope.stats.last );
+	}
+}
+
+bool mr::Benchmark::writeJSON( const bool *options, u32 numOptions ) const {
+	FILE *f = fopen( _cfg.outputFileName, "w" );
+	if ( !f ) {
+		printf( "[ERROR] Cannot open '%s' for writing\n", _cfg.outputFileName );
+		return false;
+	}
+
+	fprintf( f, "{\n" );
+	fprintf( f, "  \"width\": %u,\n  \"height\": %u,\n", _cfg.width, _cfg.height );
+	fprintf( f, "  \"warmupFrames\": %u,\n  \"frames\": %u,\n", _cfg.warmupFrames, u32( _cpuMs.size() ) );
+	fprintf( f, "  \"fixedDeltaSeconds\": %.6f,\n", _cfg.fixedDeltaSeconds );
+	fprintf( f, "  \"cameraPath\": \"%s\",\n", _cfg.cameraPathFileName ? _cfg.cameraPathFileName : "built-in" );
+	fprintf( f, "  \"vertexData\": { \"layout\": \"%s\", \"bytes\": %llu, \"pulling\": %s },\n", _cfg.quantizedVertices ? "quantized" : "float",
+		(unsigned long long)_cfg.vertexDataSize, _cfg.vertexPulling ? "true" : "false" );
+	if ( kAllocationTrackingEnabled ) {
+		fprintf( f, "  \"allocations\": { \"frames\": %u, \"total\": %llu },\n", _numFramesWithAllocations, (unsigned long long)_numAllocations );
+	}
+
+	fprintf( f, "  \"options\": [" );
+	bool first = true;
+	for ( u32 i = 0; i != numOptions; ++i ) {
+		if ( !options[i] )
+			continue;
+		fprintf( f, "%s\"%s\"", first ? "" : ", ", RenderOptionToString( RendererOption( i ) ) );
+		first = false;
+	}
+	fprintf( f, "],\n" );
+
+	fprintf( f, "  " ); writePercentiles( f, "cpuMs",        computePercentiles( _cpuMs ),        ",\n" );
+	fprintf( f, "  " ); writePercentiles( f, "frameMs",      computePercentiles( _frameMs ),      ",\n" );
+	fprintf( f, "  " ); writePercentiles( f, "gpuMs",        computePercentiles( _gpuFrameMs ),   ",\n" );
+	fprintf( f, "  " ); writePercentiles( f, "draws",        computePercentiles( _numDraws ),     ",\n" );
+	fprintf( f, "  " ); writePercentiles( f, "triangles",    computePercentiles( _numTriangles ), ",\n" );
+
+	fprintf( f, "  \"passes\": [\n" );
+	first = true;
+	for ( const Series &pass : _passes ) {
+		if ( !pass.name )
+			continue;
+		// passes that were skipped in some frames (e.g. the shadow map) are averaged over the frames they ran in
+		fprintf( f, "%s    { \"name\": \"%s\", \"depth\": %u, \"frames\": %u, ", first ? "" : ",\n", pass.name, pass.depth, u32( pass.samples.size() ) );
+		writePercentiles( f, "gpuMs", computePercentiles( pass.samples ), " }" );
+		first = false;
+	}
+	fprintf( f, "\n  ]" );
+
+	// Without the triangle culling the pre-pass is 0, the draws are the baseline. Use --shadow-every-frame to measure the shadow pass
+	const Series *meshPass = findPass( kTriangleCullingPasses[0].drawScope );
+	if ( meshPass ) {
+		fprintf( f, ",\n  \"triangleCulling\": {" );
+		first = true;
+		for ( const CulledPass &p : kTriangleCullingPasses ) {
+			const Series *cull = findPass( p.cullScope );
+			const Series *draw = findPass( p.drawScope );
+			if ( !draw )
+				continue;
+			const f64 cullMs = cull ? computePercentiles( cull->samples ).mean : 0.0;
+			const f64 drawMs = computePercentiles( draw->samples ).mean;
+			fprintf( f, "%s\n    \"%s\": { \"frames\": %u, \"cullMs\": %.4f, \"drawMs\": %.4f, \"totalMs\": %.4f }", first ? "" : ",", p.name,
+				u32( draw->samples.size() ), cullMs, drawMs, cullMs + drawMs );
+			printf( "[TriangleCulling] %-6s pass: pre-pass %.4f ms + draws %.4f ms = %.4f ms GPU, mean of %u frames\n", p.name, cullMs, drawMs,
+				cullMs + drawMs, u32( draw->samples.size() ) );
+			first = false;
+		}
+		fprintf( f, "\n  }" );
+	}
+	fprintf( f, "\n}\n" );
+	fclose( f );
+
+	printf( "[INFO] Benchmark results written to '%s'\n", _cfg.outputFileName );
+	if ( hasFailed() )
+		printf( "[ERROR] %u of %u measured frames allocated on the heap (%llu allocations)\n", _numFramesWithAllocations, u32( _cpuMs.size() ),
+			(unsigned long long)_numAllocations );
+	return true;
+}
+
+const mr::Benchmark::Series *mr::Benchmark::findPass( const char *name ) const {
+	for ( const Series &pass : _passes ) {
+		if ( pass.name && !strcmp( pass.name, name ) && !pass.samples.empty() )
+			return &pass;
+	}
+	return nullptr;
+}
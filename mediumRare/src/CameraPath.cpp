@@ -0,0 +1,131 @@
+#include "../include/CameraPath.hpp"
+
+#include <stdio.h>
+
+namespace {
+	constexpr u32 kCameraPathMagic   = 0x5043524D; // "MRCP"
+	constexpr u32 kCameraPathVersion = 1;
+
+	struct CameraPathHeader {
+		u32 magic;
+		u32 version;
+		u32 numKeys;
+		u32 numOptions; // RendererOption::MAX at the time of recording
+	};
+
+	// glm::quat component order depends on GLM_FORCE_QUAT_DATA_XYZW, store explicit xyzw floats
+	struct CameraPathRecord {
+		f32 time;
+		f32 position[3];
+		f32 orientation[4];
+		u32 options;
+	};
+	static_assert( sizeof(CameraPathRecord) == 36 );
+}
+
+u32 mr::PackRendererOptions( const bool *options ) {
+	u32 mask = 0;
+	for ( u32 i = 0; i != RendererOption::MAX; ++i ) {
+		if ( options[i] )
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+void mr::UnpackRendererOptions( u32 mask, bool *options ) {
+	for ( u32 i = 0; i != RendererOption::MAX; ++i ) {
+		options[i] = ( mask & ( 1u << i ) ) != 0;
+	}
+}
+
+bool mr::SaveCameraPath( const char *fileName, const std::vector<CameraPathKey> &keys ) {
+	FILE *f = fopen( fileName, "wb" );
+	if ( !f ) {
+		printf( "[ERROR] Cannot open '%s' for writing\n", fileName );
+		return false;
+	}
+
+	const CameraPathHeader header = {
+		.magic      = kCameraPathMagic,
+		.version    = kCameraPathVersion,
+		.numKeys    = u32( keys.size() ),
+		.numOptions = RendererOption::MAX
+	};
+	fwrite( &header, sizeof(header), 1, f );
+
+	for ( const CameraPathKey &k : keys ) {
+		const CameraPathRecord r = {
+			.time        = k.time,
+			.position    = { k.position.x, k.position.y, k.position.z },
+			.orientation = { k.orientation.x, k.orientation.y, k.orientation.z, k.orientation.w },
+			.options     = k.userFlags
+		};
+		fwrite( &r, sizeof(r), 1, f );
+	}
+	fclose( f );
+
+	printf( "[INFO] Saved %u camera keys to '%s'\n", u32( keys.size() ), fileName );
+	return true;
+}
+
+bool mr::LoadCameraPath( const char *fileName, std::vector<CameraPathKey> &keys, bool &hasOptions ) {
+	FILE *f = fopen( fileName, "rb" );
+	if ( !f ) {
+		printf( "[ERROR] Cannot open '%s'\n", fileName );
+		return false;
+	}
+
+	CameraPathHeader header = {};
+	if ( fread( &header, sizeof(header), 1, f ) != 1 || header.magic != kCameraPathMagic || header.version != kCameraPathVersion ) {
+		printf( "[ERROR] '%s' is not a camera path\n", fileName );
+		fclose( f );
+		return false;
+	}
+
+	std::vector<CameraPathRecord> records( header.numKeys );
+	const size_t numRead = fread( records.data(), sizeof(CameraPathRecord), records.size(), f );
+	fclose( f );
+
+	if ( numRead != records.size() || records.empty() ) {
+		printf( "[ERROR] Camera path '%s' is truncated or empty\n", fileName );
+		return false;
+	}
+
+	keys.resize( records.size() );
+	for ( size_t i = 0; i != records.size(); ++i ) {
+		const CameraPathRecord &r = records[i];
+		keys[i] = {
+			.time        = r.time,
+			.position    = vec3( r.position[0], r.position[1], r.position[2] ),
+			.orientation = glm::quat( r.orientation[3], r.orientation[0], r.orientation[1], r.orientation[2] ),
+			.userFlags   = r.options
+		};
+	}
+	hasOptions = header.numOptions == RendererOption::MAX;
+	if ( !hasOptions ) {
+		printf( "[WARNING] Camera path '%s' was recorded with different renderer options, they are ignored\n", fileName );
+	}
+	return true;
+}
+
+void mr::CameraPathRecorder::start() {
+	_keys.clear();
+	_time      = 0.0f;
+	_recording = true;
+}
+
+void mr::CameraPathRecorder::addFrame( f32 deltaSeconds, const mat4 &view, const vec3 &position, const bool *options ) {
+	if ( !_recording )
+		return;
+
+	// the first key is at t = 0
+	if ( !_keys.empty() )
+		_time += deltaSeconds;
+
+	_keys.push_back({
+		.time        = _time,
+		.position    = position,
+		.orientation = glm::normalize( glm::quat_cast( glm::mat3( view ) ) ),
+		.userFlags   = PackRendererOptions( options )
+	});
+}
@@ -0,0 +1,48 @@
+#include "../include/DynamicResolution.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+void mr::DynamicResolution::update( const GPUProfiler &profiler ) {
+	if ( profiler.getNumResolvedFrames() == _numResolvedFrames )
+		return;
+	_numResolvedFrames = profiler.getNumResolvedFrames();
+
+	if ( !params.enabled ) {
+		_scale      = params.maxScale;
+		_pixelRatio = params.maxScale * params.maxScale;
+		_error[0]   = _error[1] = 0.0f;
+		return;
+	}
+
+	const f32 gpuMs = profiler.getFrameScope().stats.last;
+	if ( gpuMs <= 0.0f || params.targetMs <= 0.0f )
+		return;
+
+	// positive when there is headroom
+	f32 error = ( params.targetMs - gpuMs ) / params.targetMs;
+	if ( fabsf( error ) < params.deadBand )
+		error = 0.0f;
+
+	// u(k) = u(k-1) + Kp * (e(k) - e(k-1)) + Ki * e(k) + Kd * (e(k) - 2 e(k-1) + e(k-2)),
+	// clamping u is enough to avoid integral windup in this form
+	_pixelRatio += params.kp * ( error - _error[0] ) + params.ki * error + params.kd * ( error - 2.0f * _error[0] + _error[1] );
+	_error[1] = _error[0];
+	_error[0] = error;
+
+	const f32 minScale = std::clamp( params.minScale, 0.25f, 1.0f );
+	const f32 maxScale = std::clamp( params.maxScale, minScale, 1.0f );
+	_pixelRatio        = std::clamp( _pixelRatio, minScale * minScale, maxScale * maxScale );
+	_scale             = sqrtf( _pixelRatio );
+}
+
+lvk::Dimensions mr::DynamicResolution::getRenderSize( const lvk::Dimensions &size ) const {
+	const f32 scale = getScale();
+	if ( scale >= 1.0f )
+		return size;
+
+	const auto scaled = [scale]( u32 v ) {
+		return std::clamp( ( u32( f32(v) * scale ) + 4 ) & ~7u, 8u, v );
+	};
+	return { .width = scaled( size.width ), .height = scaled( size.height ), .depth = 1 };
+}
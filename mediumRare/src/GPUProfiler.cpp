@@ -0,0 +1,174 @@
+#include "../include/GPUProfiler.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+mr::GPUProfiler::GPUProfiler( lvk::IContext &ctx ) : _ctx( ctx ) {
+	_queryPool     = ctx.createQueryPool( kQueriesPerFrame * kFramesInFlight, "Query Pool: GPU profiler" );
+	_timestampToMs = ctx.getTimestampPeriodToMs();
+
+	findOrAddScope( "Frame", 0 );
+}
+
+mr::GPUProfiler::~GPUProfiler() {
+	stopCSV();
+	_queryPool = nullptr;
+}
+
+u32 mr::GPUProfiler::findOrAddScope( const char *name, u32 depth ) {
+	for ( u32 i = 0; i != _numScopes; ++i ) {
+		if ( _scopes[i].name == name || !strcmp( _scopes[i].name, name ) )
+			return i;
+	}
+	if ( _numScopes == kMaxScopes )
+		return ~0u;
+
+	_scopes[_numScopes].name  = name;
+	_scopes[_numScopes].depth = depth;
+	return _numScopes++;
+}
+
+void mr::GPUProfiler::beginFrame( lvk::ICommandBuffer &buf ) {
+	FrameSlot &slot = _slots[_frameIndex % kFramesInFlight];
+
+	if ( slot.pending ) {
+		// submitted kFramesInFlight frames ago, this does not block in practice
+		_ctx.wait( slot.handle );
+		resolve( slot );
+	}
+
+	slot.frameIndex = _frameIndex;
+	slot.numQueries = 0;
+	slot.numEntries = 0;
+	slot.pending    = false;
+	_stackSize      = 0;
+
+	buf.cmdResetQueryPool( _queryPool, ( _frameIndex % kFramesInFlight ) * kQueriesPerFrame, kQueriesPerFrame );
+
+	beginTimestamp( buf, _scopes[0].name );
+}
+
+void mr::GPUProfiler::endFrame( lvk::ICommandBuffer &buf ) {
+	while ( _stackSize > 0 )
+		endTimestamp( buf );
+}
+
+void mr::GPUProfiler::frameSubmitted( lvk::SubmitHandle handle ) {
+	FrameSlot &slot = _slots[_frameIndex % kFramesInFlight];
+
+	slot.handle  = handle;
+	slot.pending = true;
+	_frameIndex++;
+}
+
+void mr::GPUProfiler::pushScope( lvk::ICommandBuffer &buf, const char *name, u32 colorRGBA ) {
+	buf.cmdPushDebugGroupLabel( name, colorRGBA );
+	beginTimestamp( buf, name );
+}
+
+void mr::GPUProfiler::popScope( lvk::ICommandBuffer &buf ) {
+	endTimestamp( buf );
+	buf.cmdPopDebugGroupLabel();
+}
+
+void mr::GPUProfiler::beginTimestamp( lvk::ICommandBuffer &buf, const char *name ) {
+	FrameSlot &slot = _slots[_frameIndex % kFramesInFlight];
+
+	LVK_ASSERT( _stackSize < kMaxDepth );
+
+	const u32 scope = findOrAddScope( name, _stackSize );
+	if ( scope == ~0u || slot.numEntries == kMaxScopesPerFrame ) {
+		_stack[_stackSize++] = ~0u;
+		return;
+	}
+
+	const u32 entry = slot.numEntries++;
+	slot.entries[entry] = {
+		.scope      = u16( scope ),
+		.queryBegin = u16( slot.numQueries++ ),
+		.queryEnd   = u16( 0 )
+	};
+	buf.cmdWriteTimestamp( _queryPool, ( _frameIndex % kFramesInFlight ) * kQueriesPerFrame + slot.entries[entry].queryBegin );
+	_stack[_stackSize++] = entry;
+}
+
+void mr::GPUProfiler::endTimestamp( lvk::ICommandBuffer &buf ) {
+	FrameSlot &slot = _slots[_frameIndex % kFramesInFlight];
+
+	LVK_ASSERT( _stackSize > 0 );
+
+	const u32 entry = _stack[--_stackSize];
+	if ( entry == ~0u )
+		return;
+
+	slot.entries[entry].queryEnd = u16( slot.numQueries++ );
+	buf.cmdWriteTimestamp( _queryPool, ( _frameIndex % kFramesInFlight ) * kQueriesPerFrame + slot.entries[entry].queryEnd );
+}
+
+void mr::GPUProfiler::resolve( FrameSlot &slot ) {
+	slot.pending = false;
+
+	if ( !slot.numQueries )
+		return;
+
+	const u32 firstQuery = u32( slot.frameIndex % kFramesInFlight ) * kQueriesPerFrame;
+	if ( !_ctx.getQueryPoolResults( _queryPool, firstQuery, slot.numQueries, slot.numQueries * sizeof(u64), _timestamps.data(), sizeof(u64) ) )
+		return;
+
+	for ( u32 i = 0; i != slot.numEntries; ++i ) {
+		const Entry &e = slot.entries[i];
+		Scope &scope   = _scopes[e.scope];
+		const f32 ms   = f32( f64( _timestamps[e.queryEnd] - _timestamps[e.queryBegin] ) * _timestampToMs );
+
+		scope.history[scope.head] = ms;
+		scope.head                = ( scope.head + 1 ) % kHistorySize;
+		scope.numSamples          = std::min( scope.numSamples + 1, kHistorySize );
+		scope.lastFrame           = slot.frameIndex;
+		scope.stats.last          = ms;
+		updateStats( scope );
+
+		if ( _csv )
+			fprintf( _csv, "%llu,%s,%u,%.4f\n", (unsigned long long)slot.frameIndex, scope.name, scope.depth, ms );
+	}
+
+	_numResolvedFrames++;
+}
+
+void mr::GPUProfiler::updateStats( Scope &scope ) {
+	const u32 n = scope.numSamples;
+
+	f32 minValue = scope.history[0];
+	f64 sum      = 0.0;
+	for ( u32 i = 0; i != n; ++i ) {
+		minValue   = std::min( minValue, scope.history[i] );
+		sum       += scope.history[i];
+		_scratch[i] = scope.history[i];
+	}
+
+	const u32 p99Index = std::min( n - 1, u32( f32(n) * 0.99f ) );
+	std::nth_element( _scratch.begin(), _scratch.begin() + p99Index, _scratch.begin() + n );
+
+	scope.stats.min = minValue;
+	scope.stats.avg = f32( sum / n );
+	scope.stats.p99 = _scratch[p99Index];
+}
+
+bool mr::GPUProfiler::startCSV( const char *fileName ) {
+	stopCSV();
+
+	_csv = fopen( fileName, "w" );
+	if ( !_csv ) {
+		printf( "[ERROR] Cannot open '%s' for writing\n", fileName );
+		return false;
+	}
+	fprintf( _csv, "frame,scope,depth,ms\n" );
+	printf( "[INFO] Writing GPU timings to '%s'\n", fileName );
+	return true;
+}
+
+void mr::GPUProfiler::stopCSV() {
+	if ( _csv ) {
+		fclose( _csv );
+		_csv = nullptr;
+	}
+}
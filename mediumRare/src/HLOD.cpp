@@ -0,0 +1,238 @@
+#include "../include/HLOD.hpp"
+
+#include <shared/Scene/MergeUtil.h>
+#include <meshoptimizer/src/meshoptimizer.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <stdio.h>
+
+namespace {
+	constexpr u32 kHLODMagic   = 0x444F4C48; // "HLOD"
+	constexpr u32 kHLODVersion = 1;
+
+	struct HLODHeader {
+		u32 magic;
+		u32 version;
+		u32 numClusters;
+		u32 numNodes;
+	};
+
+	struct NodeBox {
+		u32         node;
+		BoundingBox box;
+	};
+}
+
+void mr::HLOD::build( Scene &scene, MeshData &meshData, const BuildParams &buildParams ) {
+	_clusters.clear();
+	_nodes.clear();
+
+	std::vector<NodeBox> nodes;
+	nodes.reserve( scene.meshForNode.size() );
+	for ( auto &p : scene.meshForNode ) {
+		nodes.push_back({ p.first, meshData.boxes[p.second].getTransformed( scene.globalTransform[p.first] ) });
+	}
+	if ( nodes.empty() )
+		return;
+	std::sort( nodes.begin(), nodes.end(), []( const NodeBox &a, const NodeBox &b ) { return a.node < b.node; } );
+
+	BoundingBox sceneBox = nodes.front().box;
+	for ( const NodeBox &n : nodes ) {
+		sceneBox.combinePoint( n.box.min_ );
+		sceneBox.combinePoint( n.box.max_ );
+	}
+
+	// Octree over the centers of the node boxes, the leaves are the clusters
+	std::vector<std::vector<NodeBox>> leaves;
+	const std::function<void( std::vector<NodeBox>&, const BoundingBox&, u32 )> split = [&]( std::vector<NodeBox> &cellNodes, const BoundingBox &cell, u32 depth ) {
+		if ( cellNodes.size() <= buildParams.maxNodesPerCluster || depth == buildParams.maxDepth ) {
+			leaves.push_back( std::move( cellNodes ) );
+			return;
+		}
+		const vec3 center = cell.getCenter();
+		std::vector<NodeBox> children[8];
+		for ( const NodeBox &n : cellNodes ) {
+			const vec3 c = n.box.getCenter();
+			children[( c.x > center.x ? 1 : 0 ) | ( c.y > center.y ? 2 : 0 ) | ( c.z > center.z ? 4 : 0 )].push_back( n );
+		}
+		for ( u32 i = 0; i != 8; i++ ) {
+			if ( children[i].empty() )
+				continue;
+			const vec3 childMin( i & 1 ? center.x : cell.min_.x, i & 2 ? center.y : cell.min_.y, i & 4 ? center.z : cell.min_.z );
+			const vec3 childMax( i & 1 ? cell.max_.x : center.x, i & 2 ? cell.max_.y : center.y, i & 4 ? cell.max_.z : center.z );
+			split( children[i], BoundingBox( childMin, childMax ), depth + 1 );
+		}
+	};
+	split( nodes, sceneBox, 0 );
+
+	// The proxies are merged in the space of the root node, like the static batches, and hang below it
+	const mat4 rootInverse = glm::inverse( scene.globalTransform[0] );
+	const f32  rootScale   = glm::length( vec3( scene.globalTransform[0][0] ) );
+	const u32  stride      = meshData.streams.getVertexSize();
+
+	u64 numTriangles      = 0;
+	u64 numProxyTriangles = 0;
+
+	for ( const std::vector<NodeBox> &leaf : leaves ) {
+		if ( leaf.size() < 2 )
+			continue;
+
+		Cluster cluster = {
+			.box       = leaf.front().box,
+			.error     = 0.0f,
+			.firstNode = u32( _nodes.size() ),
+			.numNodes  = u32( leaf.size() )
+		};
+		// materialID -> nodes, ordered so the proxies do not depend on the order of meshForNode
+		std::map<u32, std::vector<u32>> nodesForMaterial;
+		for ( const NodeBox &n : leaf ) {
+			cluster.box.combinePoint( n.box.min_ );
+			cluster.box.combinePoint( n.box.max_ );
+			_nodes.push_back( n.node );
+			nodesForMaterial[meshData.meshes[scene.meshForNode.at( n.node )].materialID].push_back( n.node );
+		}
+
+		std::vector<u32> proxyNodes;
+		for ( auto &m : nodesForMaterial ) {
+			std::vector<u8>  vertices;
+			std::vector<u32> indices;
+			u32 numVertices = 0;
+			for ( u32 node : m.second ) {
+				numVertices += appendTransformedMesh( meshData, scene.meshForNode.at( node ), rootInverse * scene.globalTransform[node], numVertices, vertices, indices );
+			}
+			if ( indices.empty() )
+				continue;
+			numTriangles += indices.size() / 3;
+
+			const f32   *positions   = reinterpret_cast<const f32*>( vertices.data() );
+			const f32    scale       = meshopt_simplifyScale( positions, numVertices, stride ) * rootScale;
+			const size_t targetCount = size_t( f32( indices.size() / 3 ) * buildParams.targetRatio ) * 3;
+
+			std::vector<u32> simplified( indices.size() );
+			f32 resultError = 0.0f;
+			size_t numIndices = meshopt_simplify( simplified.data(), indices.data(), indices.size(), positions, numVertices, stride,
+				targetCount, buildParams.targetError, 0, &resultError );
+			// The merged meshes share no vertices, so the topology-preserving simplification stops at their borders
+			if ( numIndices > targetCount * 2 ) {
+				numIndices = meshopt_simplifySloppy( simplified.data(), indices.data(), indices.size(), positions, numVertices, stride,
+					targetCount, buildParams.targetError, &resultError );
+			}
+			simplified.resize( numIndices );
+			// A proxy without triangles loses the whole geometry of the material
+			cluster.error = std::max( cluster.error, ( numIndices ? resultError : 1.0f ) * scale );
+			if ( simplified.empty() )
+				continue;
+
+			meshopt_optimizeVertexCache( simplified.data(), simplified.data(), simplified.size(), numVertices );
+			std::vector<u8> proxyVertices( vertices.size() );
+			const size_t numProxyVertices = meshopt_optimizeVertexFetch( proxyVertices.data(), simplified.data(), simplified.size(),
+				vertices.data(), numVertices, stride );
+			proxyVertices.resize( numProxyVertices * stride );
+			numProxyTriangles += simplified.size() / 3;
+
+			Mesh proxy         = {};
+			proxy.lodCount     = 1;
+			proxy.indexOffset  = u32( meshData.indexData.size() );
+			proxy.vertexOffset = u32( meshData.vertexData.size() / stride );
+			proxy.vertexCount  = u32( numProxyVertices );
+			proxy.lodOffset[1] = u32( simplified.size() );
+			proxy.materialID   = m.first;
+			mergeVectors( meshData.indexData, simplified );
+			mergeVectors( meshData.vertexData, proxyVertices );
+
+			const u32 firstNode = m.second.front();
+			const int node      = addNode( scene, 0, 1 );
+			scene.meshForNode[node] = u32( meshData.meshes.size() );
+			scene.materialForNode[node] = scene.materialForNode.contains( firstNode ) ? scene.materialForNode.at( firstNode ) : m.first;
+			meshData.meshes.push_back( proxy );
+			proxyNodes.push_back( u32( node ) );
+		}
+
+		cluster.firstProxy = u32( _nodes.size() );
+		cluster.numProxies = u32( proxyNodes.size() );
+		_nodes.insert( _nodes.end(), proxyNodes.begin(), proxyNodes.end() );
+		_clusters.push_back( cluster );
+	}
+
+	markAsChanged( scene, 0 );
+	recalculateGlobalTransforms( scene );
+
+	printf( "[HLOD] %u clusters, %u proxies, %llu -> %llu triangles\n", u32( _clusters.size() ), u32( _nodes.size() - nodes.size() ),
+		(unsigned long long)numTriangles, (unsigned long long)numProxyTriangles );
+}
+
+bool mr::HLOD::load( const char *fileName ) {
+	_clusters.clear();
+	_nodes.clear();
+
+	// a missing file means the cache has to be built
+	FILE *f = fopen( fileName, "rb" );
+	if ( !f )
+		return false;
+
+	HLODHeader header = {};
+	bool ok = fread( &header, sizeof(header), 1, f ) == 1 && header.magic == kHLODMagic && header.version == kHLODVersion;
+	if ( ok ) {
+		_clusters.resize( header.numClusters );
+		_nodes.resize( header.numNodes );
+		ok = fread( _clusters.data(), sizeof(Cluster), _clusters.size(), f ) == _clusters.size() &&
+			fread( _nodes.data(), sizeof(u32), _nodes.size(), f ) == _nodes.size();
+	}
+	fclose( f );
+
+	if ( !ok ) {
+		printf( "[WARNING] '%s' is not a valid HLOD file\n", fileName );
+		_clusters.clear();
+		_nodes.clear();
+	}
+	return ok;
+}
+
+bool mr::HLOD::save( const char *fileName ) const {
+	FILE *f = fopen( fileName, "wb" );
+	if ( !f ) {
+		printf( "[ERROR] Cannot open '%s' for writing\n", fileName );
+		return false;
+	}
+
+	const HLODHeader header = {
+		.magic       = kHLODMagic,
+		.version     = kHLODVersion,
+		.numClusters = u32( _clusters.size() ),
+		.numNodes    = u32( _nodes.size() )
+	};
+	fwrite( &header, sizeof(header), 1, f );
+	fwrite( _clusters.data(), sizeof(Cluster), _clusters.size(), f );
+	fwrite( _nodes.data(), sizeof(u32), _nodes.size(), f );
+	fclose( f );
+	return true;
+}
+
+u32 mr::HLOD::select( bool useProxies, const glm::vec3 &cameraPos, f32 projScale, const std::vector<u32> &instanceForNode, u32 *visible ) const {
+	u32 numProxyClusters = 0;
+	for ( const Cluster &c : _clusters ) {
+		// 0 inside of the box, the original nodes are always drawn there
+		const f32  distance = glm::length( glm::max( glm::max( c.box.min_ - cameraPos, cameraPos - c.box.max_ ), vec3( 0.0f ) ) );
+		const bool proxy    = useProxies && distance > 0.0f && c.error * projScale <= params.pixelError * distance;
+		numProxyClusters   += proxy ? 1 : 0;
+
+		const u32 first = proxy ? c.firstNode : c.firstProxy;
+		const u32 count = proxy ? c.numNodes : c.numProxies;
+		for ( u32 i = first; i != first + count; i++ ) {
+			const u32 instance = instanceForNode[_nodes[i]];
+			if ( instance != ~0u )
+				visible[instance] = 0;
+		}
+	}
+	return numProxyClusters;
+}
+
+std::vector<u32> mr::HLOD::getProxyNodes() const {
+	std::vector<u32> nodes;
+	for ( const Cluster &c : _clusters ) {
+		nodes.insert( nodes.end(), _nodes.begin() + c.firstProxy, _nodes.begin() + c.firstProxy + c.numProxies );
+	}
+	return nodes;
+}
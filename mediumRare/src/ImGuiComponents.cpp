@@ -9,10 +9,61 @@ f32 mr::__computeMaxItemWidth( const char **items, size_t itemsLength ) {
 	return maxWidth;
 }
 
-ImVec2 mr::ImGuiFPSComponent( const float fps, const ImVec2 pos ) {
+ImVec2 mr::ImGuiFPSComponent( const FramesPerSecondCounter &fpsCounter, u64 numFrameAllocations, OnDemandRendering &onDemand, LowLatencyMode &lowLatency,
+	const ImVec2 pos ) {
+	// one tick per octave of the histogram buckets
+	static const char  *tickLabels[]    = { "0.25", "0.5", "1", "2", "4", "8", "16", "32", "64", "128", "256", "512" };
+	static const double tickPositions[] = { 0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44 };
+	static_assert( IM_ARRAYSIZE( tickLabels ) * FramesPerSecondCounter::kBucketsPerOctave == FramesPerSecondCounter::kNumBuckets );
+
+	const f32 fps = fpsCounter.getFPS();
+	const FramesPerSecondCounter::Stats &stats = fpsCounter.getStats();
+
 	ImGui::SetNextWindowPos( pos );
 	ImGui::Begin( "Stats:", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
 		ImGui::Text("FPS: %i, Frametime: %.2f ms", int(fps), 1000.0f / fps );
+		ImGui::Text( "p50 %.2f  p90 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", stats.p50, stats.p90, stats.p95, stats.p99, stats.max );
+		ImGui::Text( "Hitches: %llu", fpsCounter.getTotalHitches() );
+		if ( kAllocationTrackingEnabled ) {
+			ImGui::Text( "Heap allocations: %llu / frame", (unsigned long long)numFrameAllocations );
+		}
+		ImGui::Checkbox( "Render on demand", &onDemand.enabled );
+		if ( onDemand.enabled ) {
+			ImGui::SameLine();
+			if ( onDemand.idle ) {
+				ImGui::TextColored( ImVec4( 0.4f, 0.8f, 1.0f, 1.0f ), "idle, %.1f Hz", onDemand.minRefreshRate );
+			} else {
+				ImGui::TextColored( ImVec4( 1.0f, 0.8f, 0.2f, 1.0f ), "active" );
+			}
+			ImGui::SetNextItemWidth( 200.0f );
+			ImGui::SliderFloat( "Min refresh rate (Hz)", &onDemand.minRefreshRate, 0.1f, 30.0f, "%.1f", ImGuiSliderFlags_Logarithmic );
+		}
+		ImGui::Checkbox( "Low latency", &lowLatency.enabled );
+		if ( lowLatency.enabled ) {
+			ImGui::SetNextItemWidth( 200.0f );
+			ImGui::SliderInt( "Max frames in flight", &lowLatency.maxFramesInFlight, 1, 3 );
+		}
+		ImGui::Text( "Input to GPU done: %.2f ms (max %.2f ms)", lowLatency.latencyMs, lowLatency.maxLatencyMs );
+		if ( ImGui::TreeNode( "Frame times" ) ) {
+			if ( ImPlot::BeginPlot( "##frameTimes", ImVec2( 400, 120 ), ImPlotFlags_NoMenus | ImPlotFlags_NoBoxSelect | ImPlotFlags_NoLegend ) ) {
+				ImPlot::SetupAxes( nullptr, "ms", ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_AutoFit );
+				ImPlot::SetupAxisLimits( ImAxis_X1, 0, FramesPerSecondCounter::kHistorySize, ImPlotCond_Always );
+				ImPlot::PlotLine( "Frame", fpsCounter.getHistory(), fpsCounter.getHistoryCount(), 1.0, 0.0, ImPlotLineFlags_None, fpsCounter.getHistoryOffset() );
+				ImPlot::EndPlot();
+			}
+			if ( ImPlot::BeginPlot( "##histogram", ImVec2( 400, 120 ), ImPlotFlags_NoMenus | ImPlotFlags_NoBoxSelect | ImPlotFlags_NoLegend ) ) {
+				ImPlot::SetupAxes( "ms", "frames", ImPlotAxisFlags_None, ImPlotAxisFlags_AutoFit );
+				ImPlot::SetupAxisLimits( ImAxis_X1, -1, FramesPerSecondCounter::kNumBuckets, ImPlotCond_Always );
+				ImPlot::SetupAxisTicks( ImAxis_X1, tickPositions, IM_ARRAYSIZE( tickPositions ), tickLabels );
+				ImPlot::PlotBars( "Frames", fpsCounter.getHistogram(), FramesPerSecondCounter::kNumBuckets, 0.8 );
+				ImPlot::EndPlot();
+			}
+			for ( u32 i = 0; i != fpsCounter.getNumHitches(); ++i ) {
+				const FramesPerSecondCounter::Hitch &hitch = fpsCounter.getHitch( i );
+				ImGui::Text( "frame %llu: %.2f ms (%s)", hitch.frame, hitch.ms, hitch.phase );
+			}
+			ImGui::TreePop();
+		}
 		const ImVec2 componentSize = ImGui::GetItemRectMax();
 	ImGui::End();
 	return componentSize;
@@ -58,6 +109,111 @@ ImVec2 mr::ImGuiCameraControlsComponent( glm::vec3 &cameraPos, glm::vec3 &camera
 	return componentSize;
 }
 
+ImVec2 mr::ImGuiCameraPathComponent( CameraPathRecorder &recorder, CameraPositioner_Path &player, CameraPathPlayback &playback, const ImVec2 pos ) {
+	ImGui::SetNextWindowPos( pos );
+	ImGui::SetNextWindowCollapsed( true, ImGuiCond_Once );
+	ImGui::Begin( "Camera Path:", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
+		ImGui::InputText( "File", playback.fileName, sizeof(playback.fileName) );
+
+		ImGui::BeginDisabled( playback.playing );
+		if ( recorder.isRecording() ) {
+			if ( ImGui::Button( "Stop recording" ) ) {
+				recorder.stop();
+				player.setKeys( recorder.getKeys() );
+				playback.hasOptions = true;
+			}
+			ImGui::SameLine();
+			ImGui::Text( "%u keys", u32( recorder.getKeys().size() ) );
+		} else {
+			if ( ImGui::Button( "Record" ) )
+				recorder.start();
+			ImGui::SameLine();
+			if ( ImGui::Button( "Save" ) && !recorder.getKeys().empty() )
+				SaveCameraPath( playback.fileName, recorder.getKeys() );
+			ImGui::SameLine();
+			if ( ImGui::Button( "Load" ) ) {
+				std::vector<CameraPathKey> keys;
+				if ( LoadCameraPath( playback.fileName, keys, playback.hasOptions ) )
+					player.setKeys( keys );
+			}
+		}
+		ImGui::EndDisabled();
+
+		ImGui::Separator();
+		ImGui::BeginDisabled( player.empty() || recorder.isRecording() );
+		if ( ImGui::Button( playback.playing ? "Stop" : "Play" ) ) {
+			playback.playing = !playback.playing;
+			player.setTime( 0.0f );
+		}
+		ImGui::SameLine();
+		ImGui::Text( "%.2f / %.2f s", player.getTime(), player.getDuration() );
+		ImGui::Checkbox( "Fixed rate (one time step per frame)", &playback.fixedRate );
+		ImGui::BeginDisabled( !playback.hasOptions );
+		ImGui::Checkbox( "Restore recorded render options", &playback.applyOptions );
+		ImGui::EndDisabled();
+		ImGui::EndDisabled();
+
+		const ImVec2 componentSize = ImGui::GetItemRectMax();
+	ImGui::End();
+	return componentSize;
+}
+
+ImVec2 mr::ImGuiGPUProfilerComponent( GPUProfiler &profiler, const ImVec2 pos ) {
+	ImGui::SetNextWindowPos( pos, ImGuiCond_Once );
+	ImGui::SetNextWindowCollapsed( true, ImGuiCond_Once );
+	ImGui::Begin( "GPU Profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
+
+		const GPUProfiler::Scope &frame = profiler.getFrameScope();
+		ImGui::Text( "GPU frame: %.3f ms (avg %.3f ms, p99 %.3f ms)", frame.stats.last, frame.stats.avg, frame.stats.p99 );
+
+		if ( ImGui::BeginTable( "##gpuScopes", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg ) ) {
+			ImGui::TableSetupColumn( "Pass" );
+			ImGui::TableSetupColumn( "Last, ms" );
+			ImGui::TableSetupColumn( "Min, ms" );
+			ImGui::TableSetupColumn( "Avg, ms" );
+			ImGui::TableSetupColumn( "P99, ms" );
+			ImGui::TableHeadersRow();
+			for ( u32 i = 1; i != profiler.getNumScopes(); ++i ) {
+				const GPUProfiler::Scope &scope = profiler.getScope( i );
+				// passes that are currently disabled keep their stale statistics, hide them
+				if ( scope.lastFrame + GPUProfiler::kFramesInFlight + 1 < frame.lastFrame )
+					continue;
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text( "%*s%s", s32( 2 * ( scope.depth - 1 ) ), "", scope.name );
+				ImGui::TableNextColumn(); ImGui::Text( "%.3f", scope.stats.last );
+				ImGui::TableNextColumn(); ImGui::Text( "%.3f", scope.stats.min );
+				ImGui::TableNextColumn(); ImGui::Text( "%.3f", scope.stats.avg );
+				ImGui::TableNextColumn(); ImGui::Text( "%.3f", scope.stats.p99 );
+			}
+			ImGui::EndTable();
+		}
+
+		if ( ImPlot::BeginPlot( "##gpuGraphs", ImVec2( 500, 250 ), ImPlotFlags_NoMenus | ImPlotFlags_NoBoxSelect ) ) {
+			ImPlot::SetupAxes( nullptr, "ms", ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_AutoFit );
+			ImPlot::SetupAxisLimits( ImAxis_X1, 0, GPUProfiler::kHistorySize, ImPlotCond_Always );
+			for ( u32 i = 0; i != profiler.getNumScopes(); ++i ) {
+				const GPUProfiler::Scope &scope = profiler.getScope( i );
+				if ( scope.depth > 1 || scope.lastFrame + GPUProfiler::kFramesInFlight + 1 < frame.lastFrame )
+					continue;
+				// oldest sample first: the ring buffer starts at head once it is full
+				const s32 offset = scope.numSamples == GPUProfiler::kHistorySize ? scope.head : 0;
+				ImPlot::PlotLine( scope.name, scope.history.data(), scope.numSamples, 1.0, 0.0, ImPlotLineFlags_None, offset );
+			}
+			ImPlot::EndPlot();
+		}
+
+		if ( profiler.isWritingCSV() ) {
+			if ( ImGui::Button( "Stop CSV capture" ) )
+				profiler.stopCSV();
+		} else if ( ImGui::Button( "Start CSV capture (gpu_timings.csv)" ) ) {
+			profiler.startCSV( "gpu_timings.csv" );
+		}
+
+		const ImVec2 componentSize = ImGui::GetItemRectMax();
+	ImGui::End();
+	return componentSize;
+}
+
 ImVec2 mr::ImGuiRenderOptionsComponent( std::span<bool> options, const ImVec2 pos ) {
 	ImGui::SetNextWindowPos( pos );
 	ImGui::Begin( "Render Options:", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
@@ -68,14 +224,14 @@ ImVec2 mr::ImGuiRenderOptionsComponent( std::span<bool> options, const ImVec2 po
 		ImGui::Checkbox( "Draw Bounding Boxes", &options[RendererOption::BoundingBox] );
 		ImGui::Checkbox( "Draw Light Frustum",  &options[RendererOption::LightFrustum] );
 		
-		const char* aaOptions[] = { "No AA", "MSAAx2", "MSAAx4", "MSAAx8", "MSAAx16" };
+		const char* aaOptions[] = { "No AA", "MSAAx2", "MSAAx4", "MSAAx8", "MSAAx16", "TAA" };
 		static s32 currentAA = 0;
 
 		static f32 dropDownWidth = __computeMaxItemWidth( aaOptions, IM_ARRAYSIZE(aaOptions) ) + ImGui::GetStyle().FramePadding.x * 2
 			+ ImGui::GetStyle().ItemInnerSpacing.x + ImGui::GetFrameHeight();
 		ImGui::SetNextItemWidth( dropDownWidth );
 		if ( ImGui::Combo( "Anti-Aliasing", &currentAA, aaOptions, IM_ARRAYSIZE(aaOptions) ) ) {
-			for ( s32 i = RendererOption::NoAA; i <= RendererOption::MSAAx16; ++i )
+			for ( s32 i = RendererOption::NoAA; i <= RendererOption::TAA; ++i )
 				options[i] = false;
 			options[currentAA + RendererOption::NoAA] = true;
 		}
@@ -86,6 +242,7 @@ ImVec2 mr::ImGuiRenderOptionsComponent( std::span<bool> options, const ImVec2 po
 			options[RendererOption::BlurSSAO] = false;
 
 		ImGui::Checkbox( "Enable Bloom", &options[RendererOption::Bloom] );
+		ImGui::Checkbox( "Fused Post-Processing", &options[RendererOption::FusedPostProcess] );
 		
 		const char *toneMapOptions[] = { "None", "Reinhard", "Ochimura", "Khronos PBR" };
 		static s32 currentToneMapping = 0;
@@ -111,14 +268,34 @@ ImVec2 mr::ImGuiRenderOptionsComponent( std::span<bool> options, const ImVec2 po
 			options[currentCulling + RendererOption::CullingNone] = true; 
 		}
 
+		// Simulates the next frame while the current one is recorded, adds one frame of latency
+		ImGui::Checkbox( "Pipelined Simulation", &options[RendererOption::PipelinedSimulation] );
+		// Draws distant clusters of nodes as their simplified proxies, see mr::HLOD
+		ImGui::Checkbox( "HLOD", &options[RendererOption::HLODProxies] );
+		// Draws distant trees as octahedral impostors, see mr::Impostors
+		ImGui::Checkbox( "Impostors", &options[RendererOption::TreeImpostors] );
+		// Hides the instances behind the biggest meshes on top of the CPU frustum culling, see mr::OcclusionCuller
+		ImGui::Checkbox( "Occlusion Culling (CPU)", &options[RendererOption::OcclusionCulling] );
+		// Skips the nodes that cannot be seen from the cell of the camera, see mr::PVS
+		ImGui::Checkbox( "PVS", &options[RendererOption::PVSCulling] );
+		// Culls the triangles of the biggest meshes in a compute pass before drawing them, see mr::TriangleCuller
+		ImGui::Checkbox( "Triangle Culling (GPU)", &options[RendererOption::TriangleCulling] );
+
 		const ImVec2 componentSize = ImGui::GetItemRectMax();
 	ImGui::End();
 	return componentSize;
 }
 
-s32 mr::__renderSceneTreeUI( const Scene &scene, s32 node, s32 selectedNode ) {
-	const std::string name  = getNodeName( scene, node );
-	const std::string label = name.empty() ? std::string("Node") + std::to_string(node) : name;
+const char *mr::__nodeLabel( const Scene &scene, s32 node, FrameArena &arena ) {
+	// getNodeName() returns a copy of the name
+	const auto it = scene.nameForNode.find( node );
+	if ( it != scene.nameForNode.end() && !scene.nodeNames[it->second].empty() )
+		return scene.nodeNames[it->second].c_str();
+	return arena.format( "Node%d", node );
+}
+
+s32 mr::__renderSceneTreeUI( const Scene &scene, s32 node, s32 selectedNode, FrameArena &arena ) {
+	const char *label = __nodeLabel( scene, node, arena );
 
 	const bool isLeaf = scene.hierarchy[node].firstChild < 0;
 	ImGuiTreeNodeFlags flags = isLeaf ? ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_Bullet : 0;
@@ -127,13 +304,13 @@ s32 mr::__renderSceneTreeUI( const Scene &scene, s32 node, s32 selectedNode ) {
 
 	ImVec4 color = isLeaf ? ImVec4( 0, 1, 0, 1 ) : ImVec4( 1, 1, 1, 1 );
 
-	if ( name == "NewRoot" ) {
+	if ( !strcmp( label, "NewRoot" ) ) {
 		flags |= ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_Bullet;
 		color = ImVec4( 0.9f, 0.6f, 0.6f, 1 );
 	}
 
 	ImGui::PushStyleColor( ImGuiCol_Text, color );
-	const bool isOpened = ImGui::TreeNodeEx( &scene.hierarchy[node], flags, "%s", label.c_str() );
+	const bool isOpened = ImGui::TreeNodeEx( &scene.hierarchy[node], flags, "%s", label );
 	ImGui::PopStyleColor();
 
 	ImGui::PushID( node ); {
@@ -143,7 +320,7 @@ s32 mr::__renderSceneTreeUI( const Scene &scene, s32 node, s32 selectedNode ) {
 
 		if ( isOpened ) {
 			for ( s32 ch = scene.hierarchy[node].firstChild; ch != -1; ch = scene.hierarchy[ch].nextSibling ) {
-				if ( s32 subNode = __renderSceneTreeUI( scene, ch, selectedNode ); subNode > - 1 )
+				if ( s32 subNode = __renderSceneTreeUI( scene, ch, selectedNode, arena ); subNode > - 1 )
 					selectedNode = subNode;
 			}
 			ImGui::TreePop();
@@ -153,11 +330,11 @@ s32 mr::__renderSceneTreeUI( const Scene &scene, s32 node, s32 selectedNode ) {
 	return selectedNode;
 }
 
-ImVec2 mr::ImGuiSceneGraphComponent( const Scene &scene, s32 &selectedNode, const ImVec2 pos ) {
+ImVec2 mr::ImGuiSceneGraphComponent( const Scene &scene, s32 &selectedNode, FrameArena &arena, const ImVec2 pos ) {
 	ImGui::SetNextWindowPos( pos );
 	ImGui::SetNextWindowCollapsed( true, ImGuiCond_Once );
 	ImGui::Begin( "Scene Graph:", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
-		const s32 node = mr::__renderSceneTreeUI( scene, 0, selectedNode );
+		const s32 node = mr::__renderSceneTreeUI( scene, 0, selectedNode, arena );
 		if ( node > -1 ) {
 			selectedNode = node;
 		}
@@ -247,35 +424,33 @@ bool mr::__editMaterialUI( Scene &scene, MeshData &meshData, s32 node, s32 &outU
 	return updated;
 }
 
-ImVec2 mr::ImGuiEditNodeComponent( Scene &scene, MeshData &meshData, const mat4 &view, const mat4 &proj, s32 node, s32 &outUpdateMaterialIndex, const TextureCache &textureCache ) {
+ImVec2 mr::ImGuiEditNodeComponent( Scene &scene, MeshData &meshData, const mat4 &view, const mat4 &proj, s32 node, const mat4 &globalTransform, bool &outTransformEdited, mat4 &outLocalTransform, s32 &outUpdateMaterialIndex, const TextureCache &textureCache, FrameArena &arena ) {
 	ImGuizmo::SetOrthographic( false );
 	ImGuizmo::BeginFrame();
 
-	std::string name  = getNodeName( scene, node );
-	std::string label = name.empty() ? std::string("Node") + std::to_string(node) : name;
-	label             = "Node: " + label;
+	const bool  hasName = scene.nameForNode.contains( node );
+	const char *label   = arena.format( "Node: %s", __nodeLabel( scene, node, arena ) );
 
 	if ( const ImGuiViewport *v = ImGui::GetMainViewport() ) {
 		ImGui::SetNextWindowPos( ImVec2( v->WorkSize.x * 0.83f, 0.0f ) );
 		ImGui::SetNextWindowSize( ImVec2( v->WorkSize.x / 6, v->WorkSize.y ) );
 	}
 	ImGui::Begin( "Editor", nullptr, ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize );
-	if ( !name.empty() ) {
-		ImGui::Text( "%s", label.c_str() );
+	if ( hasName ) {
+		ImGui::Text( "%s", label );
 	}
 
 	if ( node >= 0 ) {
 		ImGui::Separator();
 		ImGuizmo::PushID( 1 );
 
-		mat4 globalTransform = scene.globalTransform[node];
-		mat4 srcTransform    = globalTransform;
+		mat4 editedTransform = globalTransform;
 		mat4 localTransform  = scene.localTransform[node];
 
-		if ( mr::__editTransformUI( view, proj, globalTransform ) ) {
-			mat4 deltaTransform        = glm::inverse( srcTransform ) * globalTransform;
-			scene.localTransform[node] = localTransform * deltaTransform;
-			markAsChanged( scene, node );
+		if ( mr::__editTransformUI( view, proj, editedTransform ) ) {
+			mat4 deltaTransform = glm::inverse( globalTransform ) * editedTransform;
+			outLocalTransform   = localTransform * deltaTransform;
+			outTransformEdited  = true;
 		}
 
 		ImGui::Separator();
@@ -314,7 +489,27 @@ ImVec2 mr::ImGuiLightControlsComponent( LightParams &lightParams, u32 shadowMapI
 	return componentSize;
 }
 
-ImVec2 mr::ImGuiSSAOControlsComponent( SSAOpc &pc, CombinePC &comb, s32 &blurPasses, f32 &depthThreshold, u32 ssaoTextureIndex, const ImVec2 pos ) {
+bool mr::__blurKernelComboUI( const char *label, BlurKernel &kernel ) {
+	static const char *kernelNames[BlurKernel_Count] = {
+		BlurKernelToString( BlurKernel_Reference ),
+		BlurKernelToString( BlurKernel_LinearSampling ),
+		BlurKernelToString( BlurKernel_SharedMemory ),
+		BlurKernelToString( BlurKernel_SharedMemoryFused ),
+	};
+
+	static f32 dropDownWidth = __computeMaxItemWidth( kernelNames, IM_ARRAYSIZE(kernelNames) ) + ImGui::GetStyle().FramePadding.x * 2
+		+ ImGui::GetStyle().ItemInnerSpacing.x + ImGui::GetFrameHeight();
+
+	s32 current = kernel;
+	ImGui::SetNextItemWidth( dropDownWidth );
+	if ( ImGui::Combo( label, &current, kernelNames, IM_ARRAYSIZE(kernelNames) ) ) {
+		kernel = BlurKernel( current );
+		return true;
+	}
+	return false;
+}
+
+ImVec2 mr::ImGuiSSAOControlsComponent( SSAOpc &pc, CombinePC &comb, s32 &blurPasses, BlurKernel &blurKernel, f32 &depthThreshold, u32 ssaoTextureIndex, const ImVec2 pos ) {
 	ImGui::SetNextWindowPos( pos );
 	ImGui::SetNextWindowCollapsed( true, ImGuiCond_Once );
 	ImGui::Begin( "SSAO Controls", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
@@ -322,6 +517,7 @@ ImVec2 mr::ImGuiSSAOControlsComponent( SSAOpc &pc, CombinePC &comb, s32 &blurPas
 		ImGui::Text( "SSAO Blur Controls" );
 			ImGui::SliderFloat( "Blur Depth Threshold", &depthThreshold, 0.0f, 50.0f );
 			ImGui::SliderInt( "Blur Num Passes", &blurPasses, 1, 5 );
+			__blurKernelComboUI( "Blur Kernel", blurKernel );
 		ImGui::Separator();
 		ImGui::Text( "SSAO Controls" );
 			ImGui::SliderFloat( "SSAO radius",            &pc.radius,   0.01f, 0.1f );
@@ -341,13 +537,24 @@ ImVec2 mr::ImGuiSSAOControlsComponent( SSAOpc &pc, CombinePC &comb, s32 &blurPas
 	return componentSize;
 }
 
-ImVec2 mr::ImGuiBloomToneMapControlsComponent( ToneMapPC &pcHDR, BrightPassPC &brightPassPC, s32 &blurPasses, const ImVec2 pos ) {
+ImVec2 mr::ImGuiBloomToneMapControlsComponent( ToneMapPC &pcHDR, BrightPassPC &brightPassPC, LuminancePC &luminancePC, BloomParams &bloom, s32 &blurPasses, BlurKernel &blurKernel, const ImVec2 pos ) {
 	ImGui::SetNextWindowPos( pos );
 	ImGui::SetNextWindowCollapsed( true, ImGuiCond_Once );
 	ImGui::Begin( "Bloom & ToneMapping Controls", nullptr, ImGuiWindowFlags_AlwaysAutoResize  );
 
 		ImGui::SliderFloat( "Bloom strength",      &pcHDR.bloomStrength, 0.0f, 1.0f );
-		ImGui::SliderInt( "Bloom Blur Num Passes", &blurPasses,            1,    5 );
+		ImGui::Checkbox( "Mip-chain Bloom", &bloom.mipChain );
+		if ( bloom.mipChain ) {
+			ImGui::SliderInt( "Bloom Mip Count",       &bloom.numMips, 2, bloom.maxMips );
+			ImGui::SliderFloat( "Bloom Filter Radius", &bloom.radius,  0.5f, 3.0f );
+		} else {
+			ImGui::SliderInt( "Bloom Blur Num Passes", &blurPasses,            1,    5 );
+			__blurKernelComboUI( "Bloom Blur Kernel", blurKernel );
+		}
+
+		ImGui::Separator();
+		ImGui::Text( "Eye Adaptation" );
+		ImGui::SliderFloat( "Adaptation Speed", &luminancePC.adaptationSpeed, 0.1f, 10.0f );
 
 		ImGui::Separator();
 		ImGui::Text( "Reinhard" );
@@ -377,3 +584,29 @@ ImVec2 mr::ImGuiBloomToneMapControlsComponent( ToneMapPC &pcHDR, BrightPassPC &b
 	ImGui::End();
 	return componentSize;
 }
+
+ImVec2 mr::ImGuiDynamicResolutionComponent( DynamicResolution &dynamicResolution, const lvk::Dimensions &renderSize, const lvk::Dimensions &fbSize, const ImVec2 pos ) {
+	DynamicResolution::Params &params = dynamicResolution.params;
+
+	ImGui::SetNextWindowPos( pos );
+	ImGui::SetNextWindowCollapsed( true, ImGuiCond_Once );
+	ImGui::Begin( "Dynamic Resolution", nullptr, ImGuiWindowFlags_AlwaysAutoResize );
+
+		ImGui::Checkbox( "Enable", &params.enabled );
+		ImGui::Text( "Scale %.2f, %ux%u of %ux%u", dynamicResolution.getScale(), renderSize.width, renderSize.height, fbSize.width, fbSize.height );
+		ImGui::SliderFloat( "Target GPU time (ms)", &params.targetMs, 2.0f, 50.0f );
+		ImGui::SliderFloat( "Min scale", &params.minScale, 0.25f, 1.0f );
+		ImGui::SliderFloat( "Max scale", &params.maxScale, params.minScale, 1.0f );
+		ImGui::SliderFloat( "Sharpness (stops)", &params.sharpness, 0.0f, 2.0f );
+
+		ImGui::Separator();
+		ImGui::Text( "Controller" );
+		ImGui::SliderFloat( "Kp",        &params.kp,       0.0f, 0.5f );
+		ImGui::SliderFloat( "Ki",        &params.ki,       0.0f, 0.2f );
+		ImGui::SliderFloat( "Kd",        &params.kd,       0.0f, 0.2f );
+		ImGui::SliderFloat( "Dead band", &params.deadBand, 0.0f, 0.1f );
+
+		const ImVec2 componentSize = ImGui::GetItemRectMax();
+	ImGui::End();
+	return componentSize;
+}
@@ -0,0 +1,377 @@
+#include "../include/Impostors.hpp"
+
+#include <shared/Utils.h>
+#include <shared/UtilsMath.h>
+
+#include <ktx.h>
+#include <ktx-software/lib/gl_format.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+	constexpr u32 kImpostorsMagic   = 0x504D494D; // "MIMP"
+	constexpr u32 kImpostorsVersion = 1;
+
+	const char *kAlbedoFileName      = ".cache/out_textures/impostors__albedo.ktx";
+	const char *kNormalDepthFileName = ".cache/out_textures/impostors__normal_depth.ktx";
+
+	struct ImpostorsHeader {
+		u32 magic;
+		u32 version;
+		u32 framesPerSide;
+		u32 frameSize;
+		u32 numMeshes;
+	};
+
+	// Same mapping as octDecode() in Impostor.sp
+	vec3 octDecode( const vec2 &e ) {
+		vec3 n        = vec3( e.x, 1.0f - fabsf( e.x ) - fabsf( e.y ), e.y );
+		const f32 t   = std::max( -n.y, 0.0f );
+		n.x          += n.x >= 0.0f ? -t : t;
+		n.z          += n.z >= 0.0f ? -t : t;
+		return glm::normalize( n );
+	}
+
+	bool writeKTX( const std::unique_ptr<lvk::IContext> &ctx, lvk::TextureHandle texture, u32 glInternalFormat, u32 bytesPerTexel, const char *fileName ) {
+		const lvk::Dimensions size = ctx->getDimensions( texture );
+
+		ktxTextureCreateInfo createInfo = {
+			.glInternalformat = glInternalFormat,
+			.baseWidth        = size.width,
+			.baseHeight       = size.height,
+			.baseDepth        = 1u,
+			.numDimensions    = 2u,
+			.numLevels        = 1u,
+			.numLayers        = 1u,
+			.numFaces         = 1u,
+			.generateMipmaps  = KTX_FALSE,
+		};
+		ktxTexture1 *textureKTX = nullptr;
+		if ( ktxTexture1_Create( &createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &textureKTX ) != KTX_SUCCESS ) {
+			printf( "[ERROR] Cannot create '%s'\n", fileName );
+			return false;
+		}
+		LVK_ASSERT( ktxTexture_GetImageSize( ktxTexture(textureKTX), 0 ) == size.width * size.height * bytesPerTexel );
+
+		ctx->download( texture, { .dimensions = { size.width, size.height, 1 } }, ktxTexture_GetData( ktxTexture(textureKTX) ) );
+		const bool ok = ktxTexture_WriteToNamedFile( ktxTexture(textureKTX), fileName ) == KTX_SUCCESS;
+		ktxTexture_Destroy( ktxTexture(textureKTX) );
+
+		if ( !ok )
+			printf( "[ERROR] Cannot write '%s'\n", fileName );
+		return ok;
+	}
+}
+
+mr::Impostors::Impostors( const std::unique_ptr<lvk::IContext> &ctx, const MeshData &meshData, const std::vector<DrawNode> &drawNodes )
+	: _ctx( ctx ) {
+
+	std::vector<u32> numInstances( meshData.meshes.size(), 0 );
+	for ( const DrawNode &d : drawNodes ) {
+		numInstances[d.mesh]++;
+	}
+
+	// The alpha-tested meshes with the most triangles over all of their instances
+	std::vector<u32> meshes;
+	for ( u32 m = 0; m != meshData.meshes.size(); m++ ) {
+		const Mesh &mesh = meshData.meshes[m];
+		if ( numInstances[m] && mesh.getLODIndicesCount( 0 ) / 3 >= kMinTriangles && meshData.materials[mesh.materialID].alphaTest > 0.0f )
+			meshes.push_back( m );
+	}
+	const auto getCost = [&]( u32 m ) { return u64( meshData.meshes[m].getLODIndicesCount( 0 ) / 3 ) * numInstances[m]; };
+	std::stable_sort( meshes.begin(), meshes.end(), [&]( u32 a, u32 b ) { return getCost( a ) > getCost( b ); } );
+	meshes.resize( std::min<size_t>( meshes.size(), kMaxImpostors ) );
+	std::sort( meshes.begin(), meshes.end() );
+
+	if ( meshes.empty() )
+		return;
+
+	const u32 tilesPerSide = u32( ceilf( sqrtf( f32( meshes.size() ) ) ) );
+	_atlasSize = tilesPerSide * kTileSize;
+	_meshes    = meshes;
+
+	std::vector<u32> impostorForMesh( meshData.meshes.size(), ~0u );
+	for ( u32 i = 0; i != _meshes.size(); i++ ) {
+		const u32 m          = _meshes[i];
+		const BoundingBox &b = meshData.boxes[m];
+		impostorForMesh[m]   = i;
+		_impostors.push_back({
+			.centerRadius = vec4( b.getCenter(), 0.5f * glm::length( b.getSize() ) ),
+			.tile         = vec4( vec2( i % tilesPerSide, i / tilesPerSide ) / f32( tilesPerSide ), 1.0f / f32( tilesPerSide * kFramesPerSide ), 0.0f )
+		});
+		_numTriangles += getCost( m );
+	}
+	for ( u32 i = 0; i != drawNodes.size(); i++ ) {
+		if ( impostorForMesh[drawNodes[i].mesh] != ~0u )
+			_candidates.push_back({ .instance = i, .node = drawNodes[i].node, .impostor = impostorForMesh[drawNodes[i].mesh] });
+	}
+
+	_bufferImpostors = ctx->createBuffer({
+		.usage     = lvk::BufferUsageBits_Storage,
+		.storage   = lvk::StorageType_Device,
+		.size      = _impostors.size() * sizeof(ImpostorGPU),
+		.data      = _impostors.data(),
+		.debugName = "Buffer: impostors"
+	});
+	// rewritten by upload() every frame
+	_bufferInstances = ctx->createBuffer({
+		.usage     = lvk::BufferUsageBits_Storage,
+		.storage   = lvk::StorageType_Device,
+		.size      = _candidates.size() * sizeof(Instance),
+		.debugName = "Buffer: impostor instances"
+	});
+	_sampler = ctx->createSampler({
+		.wrapU = lvk::SamplerWrap_Clamp,
+		.wrapV = lvk::SamplerWrap_Clamp,
+		.debugName = "Sampler: impostors"
+	});
+}
+
+bool mr::Impostors::load( const char *fileName ) {
+	if ( empty() )
+		return true;
+
+	// a missing file means the atlases have to be baked
+	FILE *f = fopen( fileName, "rb" );
+	if ( !f )
+		return false;
+
+	ImpostorsHeader header = {};
+	std::vector<u32> meshes;
+	bool ok = fread( &header, sizeof(header), 1, f ) == 1 && header.magic == kImpostorsMagic && header.version == kImpostorsVersion &&
+		header.framesPerSide == kFramesPerSide && header.frameSize == kFrameSize && header.numMeshes == _meshes.size();
+	if ( ok ) {
+		meshes.resize( header.numMeshes );
+		ok = fread( meshes.data(), sizeof(u32), meshes.size(), f ) == meshes.size() && meshes == _meshes;
+	}
+	fclose( f );
+
+	if ( !ok || !std::filesystem::exists( kAlbedoFileName ) || !std::filesystem::exists( kNormalDepthFileName ) ) {
+		printf( "[INFO] The impostor atlases do not match the scene, baking them again...\n" );
+		return false;
+	}
+
+	_textureAlbedo      = loadTexture( _ctx, kAlbedoFileName );
+	_textureNormalDepth = loadTexture( _ctx, kNormalDepthFileName );
+	return !_textureAlbedo.empty() && !_textureNormalDepth.empty();
+}
+
+void mr::Impostors::bake( const BakeInputs &inputs ) {
+	if ( empty() )
+		return;
+
+	const lvk::Dimensions atlasSize = { .width = _atlasSize, .height = _atlasSize };
+	_textureAlbedo = _ctx->createTexture({
+		.format     = lvk::Format_RGBA_UN8,
+		.dimensions = atlasSize,
+		.usage      = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Sampled,
+		.debugName  = "Impostors: albedo"
+	});
+	_textureNormalDepth = _ctx->createTexture({
+		.format     = lvk::Format_RGBA_F16,
+		.dimensions = atlasSize,
+		.usage      = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Sampled,
+		.debugName  = "Impostors: normal and depth"
+	});
+	lvk::Holder<lvk::TextureHandle> depth = _ctx->createTexture({
+		.format     = lvk::Format_Z_F32,
+		.dimensions = atlasSize,
+		.usage      = lvk::TextureUsageBits_Attachment,
+		.debugName  = "Impostors: bake depth"
+	});
+
+	lvk::Holder<lvk::ShaderModuleHandle> vert = loadShaderModule( _ctx, "../shaders/ImpostorBake.vert", inputs.vertexDefines );
+	lvk::Holder<lvk::ShaderModuleHandle> frag = loadShaderModule( _ctx, "../shaders/ImpostorBake.frag" );
+	lvk::Holder<lvk::RenderPipelineHandle> pipeline = _ctx->createRenderPipeline({
+		.vertexInput = inputs.streams,
+		.smVert      = vert,
+		.smFrag      = frag,
+		.color       = { { .format = lvk::Format_RGBA_UN8 }, { .format = lvk::Format_RGBA_F16 } },
+		.depthFormat = lvk::Format_Z_F32,
+		.cullMode    = lvk::CullMode_None
+	});
+	LVK_ASSERT( pipeline.valid() );
+
+	// Same layout as PerFrameData in common.sp, the transforms and the light are not read
+	struct {
+		mat4 viewProj;
+		u64  bufferTransforms;
+		u64  bufferDrawData;
+		u64  bufferMaterials;
+		u64  bufferLight;
+		u32  skyboxIrradiance;
+		u64  bufferVertexBounds;
+	} pc = {
+		.bufferTransforms   = 0,
+		.bufferDrawData     = inputs.bufferDrawData,
+		.bufferMaterials    = inputs.bufferMaterials,
+		.bufferLight        = 0,
+		.skyboxIrradiance   = 0,
+		.bufferVertexBounds = inputs.bufferVertexBounds
+	};
+	static_assert( sizeof(pc) <= 128 );
+
+	lvk::ICommandBuffer &buf = _ctx->acquireCommandBuffer();
+	buf.cmdBeginRendering(
+		lvk::RenderPass {
+			.color = { { .loadOp = lvk::LoadOp_Clear, .clearColor = { 0.0f, 0.0f, 0.0f, 0.0f } },
+			           { .loadOp = lvk::LoadOp_Clear, .clearColor = { 0.5f, 0.5f, 0.5f, 1.0f } } },
+			.depth = { .loadOp = lvk::LoadOp_Clear, .clearDepth = 1.0f }
+		},
+		lvk::Framebuffer {
+			.color        = { { .texture = _textureAlbedo }, { .texture = _textureNormalDepth } },
+			.depthStencil = { .texture = depth }
+		}
+	);
+	buf.cmdBindRenderPipeline( pipeline );
+	buf.cmdBindDepthState( { .compareOp = lvk::CompareOp_Less, .isDepthWriteEnabled = true } );
+	for ( u32 i = 0; i != _meshes.size(); i++ ) {
+		const vec3 center = vec3( _impostors[i].centerRadius );
+		const f32  radius = _impostors[i].centerRadius.w;
+		const u32  tileX  = u32( _impostors[i].tile.x * f32( _atlasSize ) + 0.5f );
+		const u32  tileY  = u32( _impostors[i].tile.y * f32( _atlasSize ) + 0.5f );
+
+		// An orthographic view of the bounding sphere per frame, in the local space of the mesh. The near plane touches the sphere,
+		// so gl_FragCoord.z is the depth from it over the diameter
+		const mat4 proj = glm::orthoRH_ZO( -radius, radius, -radius, radius, 0.0f, 2.0f * radius );
+		for ( u32 y = 0; y != kFramesPerSide; y++ ) {
+			for ( u32 x = 0; x != kFramesPerSide; x++ ) {
+				const vec3 dir     = octDecode( vec2( x, y ) / f32( kFramesPerSide - 1 ) * 2.0f - 1.0f );
+				const vec3 worldUp = fabsf( dir.y ) > 0.999f ? vec3( 0, 0, 1 ) : vec3( 0, 1, 0 );
+				pc.viewProj        = proj * glm::lookAt( center + dir * radius, center, worldUp );
+
+				const u32 fx = tileX + x * kFrameSize;
+				const u32 fy = tileY + y * kFrameSize;
+				buf.cmdBindViewport( { .x = f32( fx ), .y = f32( fy ), .width = f32( kFrameSize ), .height = f32( kFrameSize ) } );
+				buf.cmdBindScissorRect( { .x = fx, .y = fy, .width = kFrameSize, .height = kFrameSize } );
+				buf.cmdPushConstants( pc );
+				inputs.drawMesh( buf, _meshes[i] );
+			}
+		}
+	}
+	buf.cmdEndRendering();
+	_ctx->wait( _ctx->submit( buf ) );
+
+	printf( "[Impostors] Baked %u impostors into a %ux%u atlas, %u frames of %ux%u each\n", u32( _meshes.size() ), _atlasSize, _atlasSize,
+		kFramesPerSide * kFramesPerSide, kFrameSize, kFrameSize );
+}
+
+bool mr::Impostors::save( const char *fileName ) const {
+	if ( empty() )
+		return true;
+
+	if ( !std::filesystem::exists( ".cache/out_textures" ) )
+		std::filesystem::create_directories( ".cache/out_textures" );
+	if ( !writeKTX( _ctx, _textureAlbedo, GL_RGBA8, 4, kAlbedoFileName ) || !writeKTX( _ctx, _textureNormalDepth, GL_RGBA16F, 8, kNormalDepthFileName ) )
+		return false;
+
+	FILE *f = fopen( fileName, "wb" );
+	if ( !f ) {
+		printf( "[ERROR] Cannot open '%s' for writing\n", fileName );
+		return false;
+	}
+
+	const ImpostorsHeader header = {
+		.magic         = kImpostorsMagic,
+		.version       = kImpostorsVersion,
+		.framesPerSide = kFramesPerSide,
+		.frameSize     = kFrameSize,
+		.numMeshes     = u32( _meshes.size() )
+	};
+	fwrite( &header, sizeof(header), 1, f );
+	fwrite( _meshes.data(), sizeof(u32), _meshes.size(), f );
+	fclose( f );
+	return true;
+}
+
+void mr::Impostors::createPipelines( lvk::Format colorFormat, lvk::Format depthFormat, u32 numSamples, lvk::Format shadowFormat ) {
+	if ( empty() )
+		return;
+
+	_pipeline = std::make_unique<Pipeline>( _ctx, lvk::VertexInput {}, colorFormat, depthFormat, numSamples,
+		loadShaderModule( _ctx, "../shaders/Impostor.vert" ),
+		loadShaderModule( _ctx, "../shaders/Impostor.frag" ), lvk::CullMode_None );
+	_pipelineShadow = std::make_unique<Pipeline>( _ctx, lvk::VertexInput {}, lvk::Format_Invalid, shadowFormat, 1,
+		loadShaderModule( _ctx, "../shaders/Impostor.vert" ),
+		loadShaderModule( _ctx, "../shaders/Impostor.frag", "#define SHADOW_PASS 1\n" ), lvk::CullMode_None );
+}
+
+u32 mr::Impostors::select( bool enabled, const glm::vec3 &cameraPos, const std::vector<glm::mat4> &globalTransforms, u32 *visible,
+	std::vector<Instance> &instances ) const {
+
+	instances.clear();
+	if ( !enabled )
+		return 0;
+
+	const f32 fadeStart = std::max( params.distance - params.fadeRange, 0.0f );
+	for ( const Candidate &c : _candidates ) {
+		if ( !visible[c.instance] )
+			continue;
+		const f32 distance = glm::length( cameraPos - vec3( globalTransforms[c.node] * vec4( vec3( _impostors[c.impostor].centerRadius ), 1.0f ) ) );
+		if ( distance <= fadeStart )
+			continue;
+		// the mesh stays until the impostor has faded in completely
+		const f32 fade = params.fadeRange > 0.0f ? std::min( ( distance - fadeStart ) / params.fadeRange, 1.0f ) : 1.0f;
+		if ( fade >= 1.0f )
+			visible[c.instance] = 0;
+		instances.push_back({ .transformId = c.node, .impostor = c.impostor, .fade = fade });
+	}
+	return u32( instances.size() );
+}
+
+u64 mr::Impostors::getSelectionHash( const std::vector<Instance> &instances ) {
+	u64 hash = 14695981039346656037ull; // FNV-1a
+	for ( const Instance &i : instances ) {
+		// Impostor.frag keeps the pixels whose 4x4 Bayer threshold k/17 is at most fade, only the number of them changes the shadow
+		const u32 fadeLevel = std::min( u32( i.fade * 17.0f ), 16u );
+		for ( const u32 v : { i.transformId, i.impostor, fadeLevel } )
+			hash = ( hash ^ v ) * 1099511628211ull;
+	}
+	return hash;
+}
+
+void mr::Impostors::upload( lvk::ICommandBuffer &buf, const std::vector<Instance> &instances ) {
+	_numInstances = u32( instances.size() );
+	cmdUpdateBufferChunked( buf, _bufferInstances, 0, instances.size() * sizeof(Instance), instances.data() );
+}
+
+void mr::Impostors::draw( lvk::ICommandBuffer &buf, bool shadowPass, const glm::mat4 &viewProj, const glm::vec4 &eye, u64 bufferTransforms,
+	u64 bufferLight, u32 skyboxIrradiance ) const {
+
+	if ( !_numInstances )
+		return;
+
+	// Same layout as PushConstants in Impostor.sp
+	const struct {
+		mat4 viewProj;
+		vec4 eye;
+		u64  bufferTransforms;
+		u64  bufferImpostors;
+		u64  bufferInstances;
+		u64  bufferLight;
+		u32  texAlbedo;
+		u32  texNormalDepth;
+		u32  sampler;
+		u32  skyboxIrradiance;
+	} pc = {
+		.viewProj         = viewProj,
+		.eye              = eye,
+		.bufferTransforms = bufferTransforms,
+		.bufferImpostors  = _ctx->gpuAddress( _bufferImpostors ),
+		.bufferInstances  = _ctx->gpuAddress( _bufferInstances ),
+		.bufferLight      = bufferLight,
+		.texAlbedo        = _textureAlbedo.index(),
+		.texNormalDepth   = _textureNormalDepth.index(),
+		.sampler          = _sampler.index(),
+		.skyboxIrradiance = skyboxIrradiance
+	};
+	static_assert( sizeof(pc) <= 128 );
+
+	buf.cmdBindRenderPipeline( shadowPass ? _pipelineShadow->_pipeline : _pipeline->_pipeline );
+	buf.cmdBindDepthState( { .compareOp = lvk::CompareOp_Less, .isDepthWriteEnabled = true } );
+	buf.cmdPushConstants( pc );
+	buf.cmdDraw( 6, _numInstances );
+}
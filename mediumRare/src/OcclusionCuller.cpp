@@ -0,0 +1,482 @@
+#include "../include/OcclusionCuller.hpp"
+#include "../include/SimulationThread.hpp"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <thread>
+
+// MR_OCCLUSION_NO_SIMD builds the scalar fallback on any CPU
+#if !defined( MR_OCCLUSION_NO_SIMD ) && ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#	include <emmintrin.h>
+#	define MR_OCCLUSION_SSE2 1
+#elif !defined( MR_OCCLUSION_NO_SIMD ) && ( ( defined( __ARM_NEON ) && defined( __aarch64__ ) ) || defined( _M_ARM64 ) )
+#	include <arm_neon.h>
+#	define MR_OCCLUSION_NEON 1
+#endif
+
+namespace {
+	// 4 tiles of a row per op: f32x4 holds one depth per tile, mask4 the result of a comparison per tile, bit l of the masks
+	// returned by bits4() is tile l
+#if MR_OCCLUSION_SSE2
+	using f32x4 = __m128;
+	using mask4 = __m128;
+
+	f32x4 load4( const f32 *p )              { return _mm_loadu_ps( p ); }
+	void  store4( f32 *p, f32x4 v )          { _mm_storeu_ps( p, v ); }
+	f32x4 splat4( f32 v )                    { return _mm_set1_ps( v ); }
+	f32x4 set4( f32 a, f32 b, f32 c, f32 d ) { return _mm_setr_ps( a, b, c, d ); }
+	f32x4 add4( f32x4 a, f32x4 b )           { return _mm_add_ps( a, b ); }
+	f32x4 sub4( f32x4 a, f32x4 b )           { return _mm_sub_ps( a, b ); }
+	f32x4 mul4( f32x4 a, f32x4 b )           { return _mm_mul_ps( a, b ); }
+	f32x4 min4( f32x4 a, f32x4 b )           { return _mm_min_ps( a, b ); }
+	f32x4 max4( f32x4 a, f32x4 b )           { return _mm_max_ps( a, b ); }
+	mask4 less4( f32x4 a, f32x4 b )          { return _mm_cmplt_ps( a, b ); }
+	mask4 lessEqual4( f32x4 a, f32x4 b )     { return _mm_cmple_ps( a, b ); }
+	mask4 and4( mask4 a, mask4 b )           { return _mm_and_ps( a, b ); }
+	f32x4 select4( mask4 m, f32x4 a, f32x4 b ) { return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) ); }
+	u32   bits4( mask4 m )                   { return u32( _mm_movemask_ps( m ) ); }
+	mask4 lanes4( u32 bits ) {
+		const __m128i lane = _mm_setr_epi32( 1, 2, 4, 8 );
+		return _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( _mm_set1_epi32( s32( bits ) ), lane ), lane ) );
+	}
+#elif MR_OCCLUSION_NEON
+	using f32x4 = float32x4_t;
+	using mask4 = uint32x4_t;
+
+	f32x4 load4( const f32 *p )              { return vld1q_f32( p ); }
+	void  store4( f32 *p, f32x4 v )          { vst1q_f32( p, v ); }
+	f32x4 splat4( f32 v )                    { return vdupq_n_f32( v ); }
+	f32x4 set4( f32 a, f32 b, f32 c, f32 d ) { const f32 v[4] = { a, b, c, d }; return vld1q_f32( v ); }
+	f32x4 add4( f32x4 a, f32x4 b )           { return vaddq_f32( a, b ); }
+	f32x4 sub4( f32x4 a, f32x4 b )           { return vsubq_f32( a, b ); }
+	f32x4 mul4( f32x4 a, f32x4 b )           { return vmulq_f32( a, b ); }
+	f32x4 min4( f32x4 a, f32x4 b )           { return vminq_f32( a, b ); }
+	f32x4 max4( f32x4 a, f32x4 b )           { return vmaxq_f32( a, b ); }
+	mask4 less4( f32x4 a, f32x4 b )          { return vcltq_f32( a, b ); }
+	mask4 lessEqual4( f32x4 a, f32x4 b )     { return vcleq_f32( a, b ); }
+	mask4 and4( mask4 a, mask4 b )           { return vandq_u32( a, b ); }
+	f32x4 select4( mask4 m, f32x4 a, f32x4 b ) { return vbslq_f32( m, a, b ); }
+	u32   bits4( mask4 m ) {
+		const u32 lane[4] = { 1, 2, 4, 8 };
+		return vaddvq_u32( vandq_u32( m, vld1q_u32( lane ) ) );
+	}
+	mask4 lanes4( u32 bits ) {
+		const u32 lane[4] = { 1, 2, 4, 8 };
+		return vtstq_u32( vdupq_n_u32( bits ), vld1q_u32( lane ) );
+	}
+#else
+	struct f32x4 { f32 v[4]; };
+	struct mask4 { u32 bits; };
+
+	template <typename F> f32x4 map4( f32x4 a, f32x4 b, F f ) {
+		return { f( a.v[0], b.v[0] ), f( a.v[1], b.v[1] ), f( a.v[2], b.v[2] ), f( a.v[3], b.v[3] ) };
+	}
+	template <typename F> mask4 compare4( f32x4 a, f32x4 b, F f ) {
+		return { ( f( a.v[0], b.v[0] ) ? 1u : 0u ) | ( f( a.v[1], b.v[1] ) ? 2u : 0u ) | ( f( a.v[2], b.v[2] ) ? 4u : 0u ) | ( f( a.v[3], b.v[3] ) ? 8u : 0u ) };
+	}
+
+	f32x4 load4( const f32 *p )              { return { p[0], p[1], p[2], p[3] }; }
+	void  store4( f32 *p, f32x4 v )          { std::copy( v.v, v.v + 4, p ); }
+	f32x4 splat4( f32 v )                    { return { v, v, v, v }; }
+	f32x4 set4( f32 a, f32 b, f32 c, f32 d ) { return { a, b, c, d }; }
+	f32x4 add4( f32x4 a, f32x4 b )           { return map4( a, b, []( f32 x, f32 y ) { return x + y; } ); }
+	f32x4 sub4( f32x4 a, f32x4 b )           { return map4( a, b, []( f32 x, f32 y ) { return x - y; } ); }
+	f32x4 mul4( f32x4 a, f32x4 b )           { return map4( a, b, []( f32 x, f32 y ) { return x * y; } ); }
+	f32x4 min4( f32x4 a, f32x4 b )           { return map4( a, b, []( f32 x, f32 y ) { return x < y ? x : y; } ); }
+	f32x4 max4( f32x4 a, f32x4 b )           { return map4( a, b, []( f32 x, f32 y ) { return x > y ? x : y; } ); }
+	mask4 less4( f32x4 a, f32x4 b )          { return compare4( a, b, []( f32 x, f32 y ) { return x < y; } ); }
+	mask4 lessEqual4( f32x4 a, f32x4 b )     { return compare4( a, b, []( f32 x, f32 y ) { return x <= y; } ); }
+	mask4 and4( mask4 a, mask4 b )           { return { a.bits & b.bits }; }
+	f32x4 select4( mask4 m, f32x4 a, f32x4 b ) {
+		return { m.bits & 1 ? a.v[0] : b.v[0], m.bits & 2 ? a.v[1] : b.v[1], m.bits & 4 ? a.v[2] : b.v[2], m.bits & 8 ? a.v[3] : b.v[3] };
+	}
+	u32   bits4( mask4 m )                   { return m.bits; }
+	mask4 lanes4( u32 bits )                 { return { bits & 15u }; }
+#endif
+
+	// Bits of the tiles [first, last] among the 4 tiles from base
+	u32 laneRange( s32 base, s32 first, s32 last ) {
+		u32 bits = 0;
+		for ( s32 l = 0; l != 4; l++ )
+			bits |= base + l >= first && base + l <= last ? 1u << l : 0u;
+		return bits;
+	}
+
+	// In front of the camera, the depth buffer ends at the near plane of the clipped occluders
+	constexpr f32 kNearW            = 1e-5f;
+	constexpr u32 kMinBoxesPerThread = 256; // smaller batches are not worth waking up a worker
+	constexpr u32 kMaxClippedVertices = 3 + 5; // one more per clip plane
+
+	// Clip space planes of the rasterized region: w >= kNearW and the four sides of the viewport, positive inside
+	f32 clipDistance( const vec4 &v, u32 plane ) {
+		switch ( plane ) {
+		case 0:  return v.w - kNearW;
+		case 1:  return v.w - v.x;
+		case 2:  return v.w + v.x;
+		case 3:  return v.w - v.y;
+		default: return v.w + v.y;
+		}
+	}
+
+	u32 outCode( const vec4 &v ) {
+		u32 code = 0;
+		for ( u32 p = 0; p != 5; p++ )
+			code |= clipDistance( v, p ) < 0.0f ? 1u << p : 0u;
+		return code;
+	}
+
+	// Pixel centers are at +0.5, y goes down like the rows of the depth buffer
+	vec3 toScreen( const vec4 &v ) {
+		const f32 invW = 1.0f / v.w;
+		return vec3( ( 0.5f + 0.5f * v.x * invW ) * f32( mr::OcclusionCuller::kWidth ),
+		             ( 0.5f - 0.5f * v.y * invW ) * f32( mr::OcclusionCuller::kHeight ),
+		             v.z * invW );
+	}
+
+	// Bits [first, last] of a row of a tile, empty when first > last
+	u32 rowMask( s32 first, s32 last ) {
+		return first > last ? 0u : ( ~0u >> ( 31 - ( last - first ) ) ) << first;
+	}
+}
+
+mr::OcclusionCuller::OcclusionCuller( const MeshData &meshData, const std::vector<DrawNode> &drawNodes,
+	const std::vector<glm::mat4> &globalTransforms, const Params &params, u32 numThreads ) {
+
+	_tiles.resize( kTileStride * kTilesY );
+	_zMax0.resize( kTileStride * kTilesY, FLT_MAX );
+	_zMax1.resize( kTileStride * kTilesY, -FLT_MAX );
+
+	// Opaque instances whose boxes are big on at least two axes, walls rather than poles, ranked by the area of these two axes
+	struct Candidate {
+		u32 instance;
+		f32 area;
+	};
+	std::vector<Candidate> candidates;
+	for ( u32 i = 0; i != drawNodes.size(); i++ ) {
+		const Mesh     &mesh     = meshData.meshes[drawNodes[i].mesh];
+		const Material &material = meshData.materials[mesh.materialID];
+		if ( material.alphaTest > 0.0f || ( material.flags & sMaterialFlags_Transparent ) )
+			continue;
+
+		vec3 size = meshData.boxes[drawNodes[i].mesh].getTransformed( globalTransforms[drawNodes[i].node] ).getSize();
+		std::sort( &size.x, &size.x + 3 );
+		if ( size.y >= params.minOccluderSize )
+			candidates.push_back({ .instance = i, .area = size.y * size.z });
+	}
+	std::stable_sort( candidates.begin(), candidates.end(), []( const Candidate &a, const Candidate &b ) { return a.area > b.area; } );
+
+	std::vector<u32> occluderMeshForMesh( meshData.meshes.size(), ~0u );
+	u32 maxVertices = 0;
+	for ( const Candidate &c : candidates ) {
+		if ( _occluders.size() == params.maxOccluders )
+			break;
+		const DrawNode &d        = drawNodes[c.instance];
+		const Mesh     &mesh     = meshData.meshes[d.mesh];
+		const u32      numIndices = mesh.getLODIndicesCount( 0 );
+		if ( _numOccluderTriangles + numIndices / 3 > params.maxOccluderTriangles )
+			continue;
+
+		// The geometry is shared by all occluder instances of a mesh
+		if ( occluderMeshForMesh[d.mesh] == ~0u ) {
+			occluderMeshForMesh[d.mesh] = u32( _meshes.size() );
+			_meshes.push_back({
+				.firstVertex = u32( _positions.size() ),
+				.numVertices = mesh.vertexCount,
+				.firstIndex  = u32( _indices.size() ),
+				.numIndices  = numIndices
+			});
+			for ( u32 v = 0; v != mesh.vertexCount; v++ ) {
+				_positions.push_back( getVertexPosition( meshData, d.mesh, mesh.vertexOffset + v ) );
+			}
+			_indices.insert( _indices.end(), &meshData.indexData[mesh.indexOffset], &meshData.indexData[mesh.indexOffset] + numIndices );
+			maxVertices = std::max( maxVertices, mesh.vertexCount );
+		}
+		_occluders.push_back({ .instance = c.instance, .node = d.node, .mesh = occluderMeshForMesh[d.mesh] });
+		_numOccluderTriangles += numIndices / 3;
+	}
+	_clipPositions.resize( maxVertices );
+
+	if ( !numThreads )
+		numThreads = std::clamp( std::thread::hardware_concurrency() / 2, 1u, 4u );
+	_batchCulled.resize( numThreads, 0 );
+	for ( u32 t = 0; t + 1 < numThreads; t++ ) {
+		_workers.push_back( std::make_unique<SimulationThread>( [this, t] { testRange( t ); } ) );
+	}
+}
+
+mr::OcclusionCuller::~OcclusionCuller() = default;
+
+u32 mr::OcclusionCuller::renderOccluders( const glm::mat4 &viewProj, const std::vector<glm::mat4> &globalTransforms, const u32 *visible ) {
+	_viewProj = viewProj;
+	std::fill( _tiles.begin(), _tiles.end(), Tile{} );
+	std::fill( _zMax0.begin(), _zMax0.end(), FLT_MAX );
+	std::fill( _zMax1.begin(), _zMax1.end(), -FLT_MAX );
+
+	u32 numTriangles = 0;
+	for ( const Occluder &o : _occluders ) {
+		if ( !visible[o.instance] )
+			continue;
+
+		const OccluderMesh &mesh = _meshes[o.mesh];
+		const mat4 mvp           = viewProj * globalTransforms[o.node];
+		for ( u32 v = 0; v != mesh.numVertices; v++ ) {
+			_clipPositions[v] = mvp * vec4( _positions[mesh.firstVertex + v], 1.0f );
+		}
+		const u32 *indices = &_indices[mesh.firstIndex];
+		for ( u32 i = 0; i + 2 < mesh.numIndices; i += 3 ) {
+			rasterizeTriangle( _clipPositions[indices[i]], _clipPositions[indices[i + 1]], _clipPositions[indices[i + 2]] );
+		}
+		numTriangles += mesh.numIndices / 3;
+	}
+	return numTriangles;
+}
+
+void mr::OcclusionCuller::rasterizeTriangle( const glm::vec4 &v0, const glm::vec4 &v1, const glm::vec4 &v2 ) {
+	const u32 code0 = outCode( v0 ), code1 = outCode( v1 ), code2 = outCode( v2 );
+	if ( code0 & code1 & code2 )
+		return;
+	if ( !( code0 | code1 | code2 ) ) {
+		rasterizeScreenTriangle( toScreen( v0 ), toScreen( v1 ), toScreen( v2 ) );
+		return;
+	}
+
+	// Sutherland-Hodgman against the planes the triangle crosses, then a fan
+	vec4 polygon[2][kMaxClippedVertices] = { { v0, v1, v2 } };
+	u32  numVertices = 3, src = 0;
+	for ( u32 p = 0; p != 5 && numVertices; p++ ) {
+		if ( !( ( code0 | code1 | code2 ) & ( 1u << p ) ) )
+			continue;
+		const vec4 *in  = polygon[src];
+		vec4       *out = polygon[src ^ 1];
+		u32 numOut = 0;
+		for ( u32 i = 0; i != numVertices; i++ ) {
+			const vec4 &a  = in[i];
+			const vec4 &b  = in[( i + 1 ) % numVertices];
+			const f32   da = clipDistance( a, p );
+			const f32   db = clipDistance( b, p );
+			if ( da >= 0.0f )
+				out[numOut++] = a;
+			if ( ( da >= 0.0f ) != ( db >= 0.0f ) )
+				out[numOut++] = a + ( b - a ) * ( da / ( da - db ) );
+		}
+		numVertices = numOut;
+		src        ^= 1;
+	}
+	if ( numVertices < 3 )
+		return;
+
+	const vec3 s0 = toScreen( polygon[src][0] );
+	vec3       s1 = toScreen( polygon[src][1] );
+	for ( u32 i = 2; i != numVertices; i++ ) {
+		const vec3 s2 = toScreen( polygon[src][i] );
+		rasterizeScreenTriangle( s0, s1, s2 );
+		s1 = s2;
+	}
+}
+
+void mr::OcclusionCuller::rasterizeScreenTriangle( const glm::vec3 &s0, const glm::vec3 &s1, const glm::vec3 &s2 ) {
+	const f32 area = ( s1.x - s0.x ) * ( s2.y - s0.y ) - ( s2.x - s0.x ) * ( s1.y - s0.y );
+	if ( fabsf( area ) < 1e-8f )
+		return;
+
+	// Pixels whose centers are inside the bounds
+	const s32 px0 = s32( std::max( ceilf( std::min( { s0.x, s1.x, s2.x } ) - 0.5f ), 0.0f ) );
+	const s32 px1 = s32( std::min( floorf( std::max( { s0.x, s1.x, s2.x } ) - 0.5f ), f32( kWidth - 1 ) ) );
+	const s32 py0 = s32( std::max( ceilf( std::min( { s0.y, s1.y, s2.y } ) - 0.5f ), 0.0f ) );
+	const s32 py1 = s32( std::min( floorf( std::max( { s0.y, s1.y, s2.y } ) - 0.5f ), f32( kHeight - 1 ) ) );
+	if ( px0 > px1 || py0 > py1 )
+		return;
+
+	// Edge functions a * x + b * y + c, positive inside for both windings: the occluders are closed shells, drawn two-sided
+	const f32  sign     = area > 0.0f ? 1.0f : -1.0f;
+	const vec3 s[3]     = { s0, s1, s2 };
+	vec3       edges[3];
+	for ( u32 i = 0; i != 3; i++ ) {
+		const vec3 &a = s[i];
+		const vec3 &b = s[( i + 1 ) % 3];
+		edges[i] = sign * vec3( a.y - b.y, b.x - a.x, ( b.y - a.y ) * a.x - ( b.x - a.x ) * a.y );
+	}
+
+	// z / w is linear in screen space, the farthest depth of the triangle in a tile is at one of the corners of the tile
+	const f32 zA   = ( ( s1.z - s0.z ) * ( s2.y - s0.y ) - ( s1.y - s0.y ) * ( s2.z - s0.z ) ) / area;
+	const f32 zB   = ( ( s1.x - s0.x ) * ( s2.z - s0.z ) - ( s1.z - s0.z ) * ( s2.x - s0.x ) ) / area;
+	const f32 zC   = s0.z - zA * s0.x - zB * s0.y;
+	const f32 zMax = std::max( { s0.z, s1.z, s2.z } );
+	const s32 tx0  = px0 / s32( kTileWidth ), tx1 = px1 / s32( kTileWidth );
+
+	for ( s32 ty = py0 / s32( kTileHeight ); ty <= py1 / s32( kTileHeight ); ty++ ) {
+		// Span of every row, the intersection of the three half planes at the pixel centers
+		s32 first[kTileHeight], last[kTileHeight];
+		for ( u32 r = 0; r != kTileHeight; r++ ) {
+			const s32 py = ty * s32( kTileHeight ) + s32( r );
+			const f32 y  = f32( py ) + 0.5f;
+			f32  xl     = -FLT_MAX, xr = FLT_MAX;
+			bool inside = py >= py0 && py <= py1;
+			for ( const vec3 &e : edges ) {
+				const f32 c = e.y * y + e.z;
+				if ( e.x > 0.0f )
+					xl = std::max( xl, -c / e.x );
+				else if ( e.x < 0.0f )
+					xr = std::min( xr, -c / e.x );
+				else
+					inside = inside && c >= 0.0f;
+			}
+			// clamped before the conversion, the spans of rows far outside of the triangle are huge
+			first[r] = inside ? s32( std::clamp( ceilf( xl - 0.5f ), f32( px0 ), f32( px1 + 1 ) ) ) : 1;
+			last[r]  = inside ? s32( std::clamp( floorf( xr - 0.5f ), f32( px0 - 1 ), f32( px1 ) ) ) : 0;
+		}
+
+		// The spans are clamped to [px0, px1], the masks of the tiles outside of it and of the padding are empty
+		for ( s32 tb = tx0 & ~3; tb <= tx1; tb += 4 ) {
+			u32 masks[4][kTileHeight];
+			for ( s32 l = 0; l != 4; l++ ) {
+				const s32 x0 = ( tb + l ) * s32( kTileWidth );
+				for ( u32 r = 0; r != kTileHeight; r++ ) {
+					masks[l][r] = rowMask( std::max( first[r], x0 ) - x0, std::min( last[r], x0 + s32( kTileWidth ) - 1 ) - x0 );
+				}
+			}
+			updateTiles( u32( ty ), u32( tb ), masks, zA, zB, zC, zMax );
+		}
+	}
+}
+
+void mr::OcclusionCuller::updateTiles( u32 ty, u32 tx, const u32 ( *masks )[kTileHeight], f32 zA, f32 zB, f32 zC, f32 zMax ) {
+	u32 any = 0;
+	for ( u32 l = 0; l != 4; l++ ) {
+		u32 m = 0;
+		for ( u32 r = 0; r != kTileHeight; r++ )
+			m |= masks[l][r];
+		any |= m ? 1u << l : 0u;
+	}
+	if ( !any )
+		return;
+
+	const f32   x  = f32( zA > 0.0f ? ( tx + 1 ) * kTileWidth : tx * kTileWidth );
+	const f32   y  = f32( zB > 0.0f ? ( ty + 1 ) * kTileHeight : ty * kTileHeight );
+	const f32x4 xs = add4( splat4( x ), set4( 0.0f, f32( kTileWidth ), f32( 2 * kTileWidth ), f32( 3 * kTileWidth ) ) );
+	const f32x4 z  = min4( add4( mul4( splat4( zA ), xs ), splat4( zB * y + zC ) ), splat4( zMax ) );
+
+	f32 *zMax0 = &_zMax0[ty * kTileStride + tx];
+	f32 *zMax1 = &_zMax1[ty * kTileStride + tx];
+	const f32x4 z0 = load4( zMax0 );
+	const f32x4 z1 = load4( zMax1 );
+
+	// Behind everything the tile already hides
+	const mask4 active = and4( lanes4( any ), less4( z, z0 ) );
+	const u32 activeBits = bits4( active );
+	if ( !activeBits )
+		return;
+
+	// A triangle much closer than the working layer starts a new one, the old one would only keep zMax1 far away
+	const mask4 restart = and4( active, less4( sub4( z0, z1 ), sub4( z1, z ) ) );
+	const u32 restartBits = bits4( restart );
+	store4( zMax1, select4( active, max4( select4( restart, splat4( -FLT_MAX ), z1 ), z ), z1 ) );
+
+	for ( u32 l = 0; l != 4; l++ ) {
+		if ( !( activeBits & ( 1u << l ) ) )
+			continue;
+		Tile &tile = _tiles[ty * kTileStride + tx + l];
+		u32 covered = ~0u;
+		for ( u32 r = 0; r != kTileHeight; r++ ) {
+			tile.mask[r] = ( restartBits & ( 1u << l ) ? 0u : tile.mask[r] ) | masks[l][r];
+			covered     &= tile.mask[r];
+		}
+
+		// The working layer covers the tile: it becomes the reference layer
+		if ( covered == ~0u ) {
+			zMax0[l] = zMax1[l];
+			zMax1[l] = -FLT_MAX;
+			std::fill( tile.mask, tile.mask + kTileHeight, 0u );
+		}
+	}
+}
+
+bool mr::OcclusionCuller::isBoxVisible( const BoundingBox &box ) const {
+	f32 minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+	for ( u32 i = 0; i != 8; i++ ) {
+		const vec3 corner = vec3( i & 1 ? box.max_.x : box.min_.x, i & 2 ? box.max_.y : box.min_.y, i & 4 ? box.max_.z : box.min_.z );
+		const vec4 clip   = _viewProj * vec4( corner, 1.0f );
+		if ( clip.w <= kNearW )
+			return true;
+
+		const vec3 s = toScreen( clip );
+		minX = std::min( minX, s.x );
+		maxX = std::max( maxX, s.x );
+		minY = std::min( minY, s.y );
+		maxY = std::max( maxY, s.y );
+		minZ = std::min( minZ, s.z );
+	}
+
+	// Every pixel the box touches, not only the ones whose centers it covers
+	const f32 x0 = std::max( minX, 0.0f ), x1 = std::min( maxX, f32( kWidth - 1 ) );
+	const f32 y0 = std::max( minY, 0.0f ), y1 = std::min( maxY, f32( kHeight - 1 ) );
+	if ( x0 > x1 || y0 > y1 )
+		return false;
+
+	const s32   px0 = s32( x0 ), px1 = s32( x1 ), py0 = s32( y0 ), py1 = s32( y1 );
+	const s32   tx0 = px0 / s32( kTileWidth ), tx1 = px1 / s32( kTileWidth );
+	const f32x4 z   = splat4( minZ - kDepthTolerance );
+	for ( s32 ty = py0 / s32( kTileHeight ); ty <= py1 / s32( kTileHeight ); ty++ ) {
+		for ( s32 tb = tx0 & ~3; tb <= tx1; tb += 4 ) {
+			const u32 first = u32( ty ) * kTileStride + u32( tb );
+			// Not behind the reference layer
+			const mask4 front = and4( lanes4( laneRange( tb, tx0, tx1 ) ), lessEqual4( z, load4( &_zMax0[first] ) ) );
+			// and in front of the working layer as well
+			if ( bits4( and4( front, lessEqual4( z, load4( &_zMax1[first] ) ) ) ) )
+				return true;
+
+			// In front of the reference layer, but the pixels of the working layer may still hide it
+			const u32 frontBits = bits4( front );
+			for ( s32 l = 0; l != 4; l++ ) {
+				if ( !( frontBits & ( 1u << l ) ) )
+					continue;
+				const Tile &tile   = _tiles[first + l];
+				const s32   x0Tile = ( tb + l ) * s32( kTileWidth );
+				const u32   row    = rowMask( std::max( px0, x0Tile ) - x0Tile, std::min( px1, x0Tile + s32( kTileWidth ) - 1 ) - x0Tile );
+				for ( s32 r = 0; r != s32( kTileHeight ); r++ ) {
+					const s32 py = ty * s32( kTileHeight ) + r;
+					if ( py >= py0 && py <= py1 && ( row & ~tile.mask[r] ) )
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+u32 mr::OcclusionCuller::cullInstances( const BoundingBox *boxes, u32 *visible, u32 count ) {
+	if ( _occluders.empty() || !count )
+		return 0;
+
+	_batchBoxes   = boxes;
+	_batchVisible = visible;
+	_batchCount   = count;
+	_batchThreads = std::clamp( count / kMinBoxesPerThread, 1u, getNumThreads() );
+
+	for ( u32 t = 0; t + 1 < _batchThreads; t++ ) {
+		_workers[t]->kick();
+	}
+	testRange( _batchThreads - 1 );
+
+	u32 numCulled = _batchCulled[_batchThreads - 1];
+	for ( u32 t = 0; t + 1 < _batchThreads; t++ ) {
+		_workers[t]->wait();
+		numCulled += _batchCulled[t];
+	}
+	return numCulled;
+}
+
+void mr::OcclusionCuller::testRange( u32 thread ) {
+	const u32 first = u32( u64( _batchCount ) * thread / _batchThreads );
+	const u32 last  = u32( u64( _batchCount ) * ( thread + 1 ) / _batchThreads );
+
+	u32 numCulled = 0;
+	for ( u32 i = first; i != last; i++ ) {
+		if ( _batchVisible[i] && !isBoxVisible( _batchBoxes[i] ) ) {
+			_batchVisible[i] = 0;
+			numCulled++;
+		}
+	}
+	_batchCulled[thread] = numCulled;
+}
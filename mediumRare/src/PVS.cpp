@@ -0,0 +1,540 @@
+#include "../include/PVS.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <float.h>
+#include <map>
+#include <numeric>
+#include <stdio.h>
+#include <thread>
+
+namespace {
+	constexpr u32 kPVSMagic   = 0x5356504D; // "MPVS"
+	constexpr u32 kPVSVersion = 2;
+
+	struct PVSHeader {
+		u32 magic;
+		u32 version;
+		f32 gridMin[3];
+		f32 cellSize;
+		u32 dims[3];
+		u32 numNodes;
+		u32 dataSize;
+		u32 numSceneNodes;
+		u32 numMeshes;
+		u32 numIndices;
+		u64 contentHash; // see hashSceneContent()
+	};
+
+	constexpr u32 kLeafSize        = 4;
+	constexpr u32 kMaxStackDepth   = 64;
+	constexpr u32 kMaxSeeThrough   = 32;  // hits of a ray behind which it goes on, more are marked visible right away
+	constexpr f32 kMinHitDistance  = 1e-4f;
+
+	// 10 bits to every third bit of a 30-bit Morton code
+	u32 expandBits( u32 v ) {
+		v = ( v * 0x00010001u ) & 0xFF0000FFu;
+		v = ( v * 0x00000101u ) & 0x0F00F00Fu;
+		v = ( v * 0x00000011u ) & 0xC30C30C3u;
+		v = ( v * 0x00000005u ) & 0x49249249u;
+		return v;
+	}
+
+	f32 radicalInverse( u32 i, u32 base ) {
+		f32 result = 0.0f;
+		f32 f      = 1.0f / f32( base );
+		for ( ; i; i /= base, f /= f32( base ) ) {
+			result += f32( i % base ) * f;
+		}
+		return result;
+	}
+
+	void writeVarint( std::vector<u8> &out, u32 v ) {
+		for ( ; v >= 0x80; v >>= 7 ) {
+			out.push_back( u8( v | 0x80 ) );
+		}
+		out.push_back( u8( v ) );
+	}
+
+	// Fails on truncated data and on more than the 5 bytes of a 32-bit value
+	bool readVarint( const u8 *&p, const u8 *end, u32 &v ) {
+		v = 0;
+		for ( u32 shift = 0; shift < 35 && p != end; shift += 7 ) {
+			const u8 b = *p++;
+			v |= u32( b & 0x7F ) << shift;
+			if ( !( b & 0x80 ) )
+				return true;
+		}
+		return false;
+	}
+
+	// The runs of a set cover all nodes and stay inside data
+	bool isValidSet( const std::vector<u8> &data, u32 offset, u32 numNodes ) {
+		const u8 *p   = data.data() + offset;
+		const u8 *end = data.data() + data.size();
+		for ( u64 i = 0; i < numNodes; ) {
+			u32 run = 0;
+			if ( !readVarint( p, end, run ) )
+				return false;
+			i += run;
+		}
+		return true;
+	}
+
+	// FNV-1a of what the sets were baked from besides the counts: the global transforms of the nodes and the bounds of the meshes
+	u64 hashSceneContent( const Scene &scene, const MeshData &meshData ) {
+		u64 hash = 14695981039346656037ull;
+		const auto addBytes = [&hash]( const void *data, size_t size ) {
+			for ( size_t i = 0; i != size; i++ )
+				hash = ( hash ^ static_cast<const u8*>( data )[i] ) * 1099511628211ull;
+		};
+		addBytes( scene.globalTransform.data(), scene.globalTransform.size() * sizeof(glm::mat4) );
+		addBytes( meshData.boxes.data(), meshData.boxes.size() * sizeof(BoundingBox) );
+		return hash;
+	}
+
+	void setBit( u64 *bits, u32 i ) {
+		bits[i / 64] |= 1ull << ( i % 64 );
+	}
+
+	struct Triangle {
+		u32 v[3];
+		u32 object;
+	};
+
+	struct BVHNode {
+		vec3 boundsMin;
+		u32  leftFirst; // first child of an inner node, first triangle of a leaf
+		vec3 boundsMax;
+		u32  count;     // triangles of a leaf, 0 for inner nodes
+	};
+
+	// World space triangles of the bake and a bounding volume hierarchy over them, median splits along the largest axis
+	struct RayScene {
+		std::vector<vec3>     positions;
+		std::vector<Triangle> triangles;
+		std::vector<u8>       opaque; // per object
+		std::vector<BVHNode>  nodes;
+
+		void buildBVH() {
+			std::vector<vec3> centroids( triangles.size() );
+			for ( size_t i = 0; i != triangles.size(); i++ ) {
+				const Triangle &t = triangles[i];
+				centroids[i] = ( positions[t.v[0]] + positions[t.v[1]] + positions[t.v[2]] ) / 3.0f;
+			}
+			std::vector<u32> order( triangles.size() );
+			std::iota( order.begin(), order.end(), 0u );
+
+			nodes.clear();
+			nodes.push_back({ .leftFirst = 0, .count = u32( triangles.size() ) });
+			std::vector<u32> stack = { 0 };
+			while ( !stack.empty() ) {
+				const u32 node = stack.back();
+				stack.pop_back();
+				const u32 first = nodes[node].leftFirst;
+				const u32 count = nodes[node].count;
+
+				vec3 boundsMin( FLT_MAX ), boundsMax( -FLT_MAX ), centroidMin( FLT_MAX ), centroidMax( -FLT_MAX );
+				for ( u32 i = first; i != first + count; i++ ) {
+					const Triangle &t = triangles[order[i]];
+					for ( u32 v : t.v ) {
+						boundsMin = glm::min( boundsMin, positions[v] );
+						boundsMax = glm::max( boundsMax, positions[v] );
+					}
+					centroidMin = glm::min( centroidMin, centroids[order[i]] );
+					centroidMax = glm::max( centroidMax, centroids[order[i]] );
+				}
+				nodes[node].boundsMin = boundsMin;
+				nodes[node].boundsMax = boundsMax;
+
+				const vec3 extent = centroidMax - centroidMin;
+				const u32  axis   = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+				if ( count <= kLeafSize || extent[axis] <= 0.0f )
+					continue;
+
+				// ties broken by the index, the hierarchy is the same on every run
+				const u32 mid = first + count / 2;
+				std::nth_element( order.begin() + first, order.begin() + mid, order.begin() + first + count, [&]( u32 a, u32 b ) {
+					return centroids[a][axis] < centroids[b][axis] || ( centroids[a][axis] == centroids[b][axis] && a < b );
+				});
+
+				const u32 left = u32( nodes.size() );
+				nodes.push_back({ .leftFirst = first, .count = mid - first });
+				nodes.push_back({ .leftFirst = mid, .count = first + count - mid });
+				nodes[node].leftFirst = left;
+				nodes[node].count     = 0;
+				stack.push_back( left );
+				stack.push_back( left + 1 );
+			}
+
+			std::vector<Triangle> sorted( triangles.size() );
+			for ( size_t i = 0; i != order.size(); i++ ) {
+				sorted[i] = triangles[order[i]];
+			}
+			triangles.swap( sorted );
+		}
+
+		// Distance to the box along the ray, FLT_MAX when it is missed or farther than tMax
+		static f32 intersectBox( const BVHNode &node, const vec3 &origin, const vec3 &invDir, f32 tMax ) {
+			const vec3 t0   = ( node.boundsMin - origin ) * invDir;
+			const vec3 t1   = ( node.boundsMax - origin ) * invDir;
+			const vec3 tLo  = glm::min( t0, t1 );
+			const vec3 tHi  = glm::max( t0, t1 );
+			const f32  tIn  = std::max( { tLo.x, tLo.y, tLo.z, 0.0f } );
+			const f32  tOut = std::min( { tHi.x, tHi.y, tHi.z, tMax } );
+			return tIn <= tOut ? tIn : FLT_MAX;
+		}
+
+		// Moeller-Trumbore, both sides
+		f32 intersectTriangle( const Triangle &t, const vec3 &origin, const vec3 &dir ) const {
+			const vec3 &p0  = positions[t.v[0]];
+			const vec3  e1  = positions[t.v[1]] - p0;
+			const vec3  e2  = positions[t.v[2]] - p0;
+			const vec3  p   = glm::cross( dir, e2 );
+			const f32   det = glm::dot( e1, p );
+			if ( det == 0.0f )
+				return FLT_MAX;
+			const f32  invDet = 1.0f / det;
+			const vec3 s      = origin - p0;
+			const f32  u      = glm::dot( s, p ) * invDet;
+			if ( u < 0.0f || u > 1.0f )
+				return FLT_MAX;
+			const vec3 q = glm::cross( s, e1 );
+			const f32  v = glm::dot( dir, q ) * invDet;
+			if ( v < 0.0f || u + v > 1.0f )
+				return FLT_MAX;
+			const f32 dist = glm::dot( e2, q ) * invDet;
+			return dist > kMinHitDistance ? dist : FLT_MAX;
+		}
+
+		// Sets the bits of the objects the ray sees: the first opaque one and everything in front of it
+		void castRay( const vec3 &origin, const vec3 &dir, u64 *bits ) const {
+			const vec3 invDir = 1.0f / glm::max( glm::abs( dir ), vec3( 1e-20f ) ) * glm::sign( glm::sign( dir ) + 0.5f );
+
+			struct Hit {
+				u32 object;
+				f32 dist;
+			} seeThrough[kMaxSeeThrough];
+			u32 numSeeThrough = 0;
+			f32 tMax          = FLT_MAX;
+			u32 hitObject     = ~0u;
+
+			u32 stack[kMaxStackDepth];
+			u32 stackSize = 0;
+			stack[stackSize++] = 0;
+			while ( stackSize ) {
+				const BVHNode &node = nodes[stack[--stackSize]];
+				if ( intersectBox( node, origin, invDir, tMax ) == FLT_MAX )
+					continue;
+
+				if ( node.count ) {
+					for ( u32 i = node.leftFirst; i != node.leftFirst + node.count; i++ ) {
+						const Triangle &t    = triangles[i];
+						const f32       dist = intersectTriangle( t, origin, dir );
+						if ( dist >= tMax )
+							continue;
+						if ( opaque[t.object] ) {
+							tMax      = dist;
+							hitObject = t.object;
+						} else if ( numSeeThrough != kMaxSeeThrough ) {
+							seeThrough[numSeeThrough++] = { t.object, dist };
+						} else {
+							setBit( bits, t.object );
+						}
+					}
+					continue;
+				}
+
+				// the nearer child is popped first
+				const f32 distLeft  = intersectBox( nodes[node.leftFirst], origin, invDir, tMax );
+				const f32 distRight = intersectBox( nodes[node.leftFirst + 1], origin, invDir, tMax );
+				const bool leftFirst = distLeft <= distRight;
+				if ( ( leftFirst ? distRight : distLeft ) != FLT_MAX )
+					stack[stackSize++] = node.leftFirst + ( leftFirst ? 1 : 0 );
+				if ( ( leftFirst ? distLeft : distRight ) != FLT_MAX )
+					stack[stackSize++] = node.leftFirst + ( leftFirst ? 0 : 1 );
+			}
+
+			if ( hitObject != ~0u )
+				setBit( bits, hitObject );
+			for ( u32 i = 0; i != numSeeThrough; i++ ) {
+				if ( seeThrough[i].dist < tMax )
+					setBit( bits, seeThrough[i].object );
+			}
+		}
+	};
+
+	struct Object {
+		u32         node;
+		u32         mesh;
+		BoundingBox box;
+		u32         morton;
+	};
+}
+
+void mr::PVS::bake( const Scene &scene, const MeshData &meshData, const std::vector<u32> &alwaysVisibleNodes, const BakeParams &params ) {
+	const auto bakeStart = std::chrono::steady_clock::now();
+
+	_nodes.clear();
+	_cellOffsets.clear();
+	_data.clear();
+	_numSceneNodes = u32( scene.globalTransform.size() );
+	_numMeshes     = u32( meshData.meshes.size() );
+	_numIndices    = u32( meshData.indexData.size() );
+	_contentHash   = hashSceneContent( scene, meshData );
+
+	std::vector<u8> alwaysVisible( scene.globalTransform.size(), 0 );
+	for ( u32 node : alwaysVisibleNodes ) {
+		alwaysVisible[node] = 1;
+	}
+	std::vector<Object> objects;
+	for ( auto &p : scene.meshForNode ) {
+		if ( !alwaysVisible[p.first] )
+			objects.push_back({ .node = p.first, .mesh = p.second, .box = meshData.boxes[p.second].getTransformed( scene.globalTransform[p.first] ) });
+	}
+	if ( objects.empty() )
+		return;
+
+	BoundingBox sceneBox = objects.front().box;
+	for ( const Object &o : objects ) {
+		sceneBox.combinePoint( o.box.min_ );
+		sceneBox.combinePoint( o.box.max_ );
+	}
+	const vec3 sceneSize = glm::max( sceneBox.getSize(), vec3( 1e-6f ) );
+
+	// Nodes close to each other are seen together, Morton order keeps the runs of the sets long
+	for ( Object &o : objects ) {
+		const glm::uvec3 q = glm::uvec3( glm::clamp( ( o.box.getCenter() - sceneBox.min_ ) / sceneSize, 0.0f, 1.0f ) * 1023.0f );
+		o.morton = ( expandBits( q.x ) << 2 ) | ( expandBits( q.y ) << 1 ) | expandBits( q.z );
+	}
+	std::sort( objects.begin(), objects.end(), []( const Object &a, const Object &b ) {
+		return a.morton < b.morton || ( a.morton == b.morton && a.node < b.node );
+	});
+
+	RayScene rayScene;
+	rayScene.opaque.resize( objects.size() );
+	for ( u32 i = 0; i != objects.size(); i++ ) {
+		const Object   &o        = objects[i];
+		const Mesh     &mesh     = meshData.meshes[o.mesh];
+		const Material &material = meshData.materials[mesh.materialID];
+		rayScene.opaque[i] = material.alphaTest == 0.0f && !( material.flags & sMaterialFlags_Transparent );
+
+		const u32 firstVertex = u32( rayScene.positions.size() );
+		for ( u32 v = 0; v != mesh.vertexCount; v++ ) {
+			rayScene.positions.push_back( vec3( scene.globalTransform[o.node] * vec4( getVertexPosition( meshData, o.mesh, mesh.vertexOffset + v ), 1.0f ) ) );
+		}
+		const u32 *indices = &meshData.indexData[mesh.indexOffset];
+		for ( u32 t = 0; t + 2 < mesh.getLODIndicesCount( 0 ); t += 3 ) {
+			rayScene.triangles.push_back({ .v = { firstVertex + indices[t], firstVertex + indices[t + 1], firstVertex + indices[t + 2] }, .object = i });
+		}
+	}
+	rayScene.buildBVH();
+
+	// The cells cover the boxes of all nodes
+	_cellSize = params.cellSize;
+	for ( ;; ) {
+		_dims = glm::max( glm::uvec3( glm::ceil( sceneSize / _cellSize ) ), glm::uvec3( 1 ) );
+		if ( u64( _dims.x ) * _dims.y * _dims.z <= kMaxCells )
+			break;
+		_cellSize *= 1.25f;
+	}
+	_gridMin = sceneBox.min_;
+
+	const u32 numCells  = getNumCells();
+	const u32 numWords  = u32( ( objects.size() + 63 ) / 64 );
+	const u32 numThreads = params.numThreads ? params.numThreads : std::max( std::thread::hardware_concurrency(), 1u );
+	printf( "[PVS] Baking %ux%ux%u cells of %.1f for %u nodes, %u triangles, on %u threads...\n", _dims.x, _dims.y, _dims.z, _cellSize,
+		u32( objects.size() ), u32( rayScene.triangles.size() ), numThreads );
+
+	// Every cell only depends on its own samples, the threads take the cells in any order and the result stays the same
+	std::vector<u64> sampledBits( u64( numCells ) * numWords, 0 );
+	std::atomic<u32> nextCell = 0;
+	const auto bakeCells = [&]() {
+		for ( u32 c = nextCell++; c < numCells; c = nextCell++ ) {
+			u64 *bits = &sampledBits[u64( c ) * numWords];
+			const glm::uvec3 cell  = glm::uvec3( c % _dims.x, ( c / _dims.x ) % _dims.y, c / ( _dims.x * _dims.y ) );
+			const vec3 cellMin     = _gridMin + vec3( cell ) * _cellSize;
+			const BoundingBox cellBox( cellMin, cellMin + vec3( _cellSize ) );
+
+			for ( u32 i = 0; i != objects.size(); i++ ) {
+				const BoundingBox &b = objects[i].box;
+				if ( glm::all( glm::lessThanEqual( b.min_, cellBox.max_ ) ) && glm::all( glm::greaterThanEqual( b.max_, cellBox.min_ ) ) )
+					setBit( bits, i );
+			}
+
+			// Halton points in the cell, a spherical Fibonacci set of directions rotated differently for each of them
+			for ( u32 s = 0; s != params.samplesPerCell; s++ ) {
+				const vec3 origin   = cellMin + _cellSize * vec3( radicalInverse( s + 1, 2 ), radicalInverse( s + 1, 3 ), radicalInverse( s + 1, 5 ) );
+				const f32  rotation = radicalInverse( s + 1, 7 );
+				for ( u32 r = 0; r != params.raysPerSample; r++ ) {
+					const f32 y   = 1.0f - 2.0f * ( f32( r ) + 0.5f ) / f32( params.raysPerSample );
+					const f32 phi = glm::two_pi<f32>() * glm::fract( f32( r ) * 0.618034f + rotation );
+					const f32 xz  = sqrtf( std::max( 1.0f - y * y, 0.0f ) );
+					rayScene.castRay( origin, vec3( xz * cosf( phi ), y, xz * sinf( phi ) ), bits );
+				}
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for ( u32 t = 1; t < numThreads; t++ ) {
+		threads.emplace_back( bakeCells );
+	}
+	bakeCells();
+	for ( std::thread &t : threads ) {
+		t.join();
+	}
+
+	// Dilation by the 26 neighbours covers what the samples missed near the borders of the cells
+	std::vector<u64> bits( numWords );
+	std::map<std::vector<u8>, u32> uniqueSets;
+	std::vector<u8> encoded;
+	u64 numVisible = 0;
+	_cellOffsets.resize( numCells );
+	for ( u32 c = 0; c != numCells; c++ ) {
+		const glm::ivec3 cell = glm::ivec3( c % _dims.x, ( c / _dims.x ) % _dims.y, c / ( _dims.x * _dims.y ) );
+		std::fill( bits.begin(), bits.end(), 0ull );
+		for ( s32 z = std::max( cell.z - 1, 0 ); z <= std::min( cell.z + 1, s32( _dims.z ) - 1 ); z++ ) {
+			for ( s32 y = std::max( cell.y - 1, 0 ); y <= std::min( cell.y + 1, s32( _dims.y ) - 1 ); y++ ) {
+				for ( s32 x = std::max( cell.x - 1, 0 ); x <= std::min( cell.x + 1, s32( _dims.x ) - 1 ); x++ ) {
+					const u64 *neighbour = &sampledBits[u64( ( z * _dims.y + y ) * _dims.x + x ) * numWords];
+					for ( u32 w = 0; w != numWords; w++ ) {
+						bits[w] |= neighbour[w];
+					}
+				}
+			}
+		}
+
+		// Alternating runs of hidden and visible nodes, starting with a hidden one
+		encoded.clear();
+		u32 runStart = 0;
+		u64 value    = 0;
+		for ( u32 i = 0; i != objects.size(); i++ ) {
+			const u64 bit = ( bits[i / 64] >> ( i % 64 ) ) & 1;
+			numVisible   += bit;
+			if ( bit != value ) {
+				writeVarint( encoded, i - runStart );
+				runStart = i;
+				value    = bit;
+			}
+		}
+		writeVarint( encoded, u32( objects.size() ) - runStart );
+
+		const auto it = uniqueSets.try_emplace( encoded, u32( _data.size() ) );
+		if ( it.second )
+			_data.insert( _data.end(), encoded.begin(), encoded.end() );
+		_cellOffsets[c] = it.first->second;
+	}
+
+	_nodes.reserve( objects.size() );
+	for ( const Object &o : objects ) {
+		_nodes.push_back( o.node );
+	}
+
+	printf( "[PVS] %.1f%% of the nodes visible per cell on average, %u unique sets, %.1f KB (%.1f KB as plain bitsets), %.1f s\n",
+		100.0 * f64( numVisible ) / ( f64( numCells ) * f64( objects.size() ) ), u32( uniqueSets.size() ), f64( _data.size() ) / 1024.0,
+		f64( u64( numCells ) * numWords * sizeof(u64) ) / 1024.0,
+		std::chrono::duration<f64>( std::chrono::steady_clock::now() - bakeStart ).count() );
+}
+
+bool mr::PVS::load( const char *fileName, const Scene &scene, const MeshData &meshData ) {
+	_nodes.clear();
+	_cellOffsets.clear();
+	_data.clear();
+
+	// a missing file means the sets have to be baked
+	FILE *f = fopen( fileName, "rb" );
+	if ( !f )
+		return false;
+
+	PVSHeader header = {};
+	bool ok = fread( &header, sizeof(header), 1, f ) == 1 && header.magic == kPVSMagic && header.version == kPVSVersion;
+	if ( ok ) {
+		_gridMin  = vec3( header.gridMin[0], header.gridMin[1], header.gridMin[2] );
+		_cellSize = header.cellSize;
+		_dims     = glm::uvec3( header.dims[0], header.dims[1], header.dims[2] );
+		_nodes.resize( header.numNodes );
+		_cellOffsets.resize( getNumCells() );
+		_data.resize( header.dataSize );
+		ok = fread( _nodes.data(), sizeof(u32), _nodes.size(), f ) == _nodes.size() &&
+			fread( _cellOffsets.data(), sizeof(u32), _cellOffsets.size(), f ) == _cellOffsets.size() &&
+			fread( _data.data(), 1, _data.size(), f ) == _data.size();
+		ok = ok && std::all_of( _cellOffsets.begin(), _cellOffsets.end(), [&]( u32 offset ) {
+			return offset < _data.size() && isValidSet( _data, offset, header.numNodes );
+		});
+	}
+	fclose( f );
+
+	if ( !ok ) {
+		printf( "[WARNING] '%s' is not a valid PVS file\n", fileName );
+	} else if ( header.numSceneNodes != scene.globalTransform.size() || header.numMeshes != meshData.meshes.size() ||
+		header.numIndices != meshData.indexData.size() || header.contentHash != hashSceneContent( scene, meshData ) ) {
+		printf( "[INFO] '%s' was baked for another scene\n", fileName );
+		ok = false;
+	}
+	if ( !ok ) {
+		_nodes.clear();
+		_cellOffsets.clear();
+		_data.clear();
+		return false;
+	}
+	_numSceneNodes = header.numSceneNodes;
+	_numMeshes     = header.numMeshes;
+	_numIndices    = header.numIndices;
+	_contentHash   = header.contentHash;
+	return true;
+}
+
+bool mr::PVS::save( const char *fileName ) const {
+	FILE *f = fopen( fileName, "wb" );
+	if ( !f ) {
+		printf( "[ERROR] Cannot open '%s' for writing\n", fileName );
+		return false;
+	}
+
+	const PVSHeader header = {
+		.magic         = kPVSMagic,
+		.version       = kPVSVersion,
+		.gridMin       = { _gridMin.x, _gridMin.y, _gridMin.z },
+		.cellSize      = _cellSize,
+		.dims          = { _dims.x, _dims.y, _dims.z },
+		.numNodes      = u32( _nodes.size() ),
+		.dataSize      = u32( _data.size() ),
+		.numSceneNodes = _numSceneNodes,
+		.numMeshes     = _numMeshes,
+		.numIndices    = _numIndices,
+		.contentHash   = _contentHash
+	};
+	fwrite( &header, sizeof(header), 1, f );
+	fwrite( _nodes.data(), sizeof(u32), _nodes.size(), f );
+	fwrite( _cellOffsets.data(), sizeof(u32), _cellOffsets.size(), f );
+	fwrite( _data.data(), 1, _data.size(), f );
+	fclose( f );
+	return true;
+}
+
+u32 mr::PVS::select( const glm::vec3 &cameraPos, const std::vector<u32> &instanceForNode, u32 *visible ) const {
+	if ( _nodes.empty() )
+		return 0;
+
+	const vec3 cell = glm::floor( ( cameraPos - _gridMin ) / _cellSize );
+	if ( glm::any( glm::lessThan( cell, vec3( 0.0f ) ) ) || glm::any( glm::greaterThanEqual( cell, vec3( _dims ) ) ) )
+		return 0;
+
+	const u8 *p    = &_data[_cellOffsets[( u32( cell.z ) * _dims.y + u32( cell.y ) ) * _dims.x + u32( cell.x )]];
+	const u8 *pEnd = _data.data() + _data.size();
+	u32 numCleared = 0;
+	bool hidden    = true;
+	for ( u32 i = 0, run = 0; i < _nodes.size() && readVarint( p, pEnd, run ); hidden = !hidden ) {
+		const u32 end = u32( std::min<u64>( u64( i ) + run, _nodes.size() ) );
+		for ( ; hidden && i != end; i++ ) {
+			const u32 instance = instanceForNode[_nodes[i]];
+			if ( instance != ~0u && visible[instance] ) {
+				visible[instance] = 0;
+				numCleared++;
+			}
+		}
+		i = end;
+	}
+	return numCleared;
+}
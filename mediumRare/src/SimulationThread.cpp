@@ -0,0 +1,43 @@
+#include "../include/SimulationThread.hpp"
+
+mr::SimulationThread::SimulationThread( std::function<void()> job ) : _job( std::move( job ) ) {
+	_thread = std::thread( &SimulationThread::threadProc, this );
+}
+
+mr::SimulationThread::~SimulationThread() {
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		_quit = true;
+	}
+	_cv.notify_all();
+	_thread.join();
+}
+
+void mr::SimulationThread::kick() {
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+		_pending = true;
+	}
+	_cv.notify_all();
+}
+
+void mr::SimulationThread::wait() {
+	std::unique_lock<std::mutex> lock( _mutex );
+	_cv.wait( lock, [this] { return !_pending; } );
+}
+
+void mr::SimulationThread::threadProc() {
+	std::unique_lock<std::mutex> lock( _mutex );
+	for ( ;; ) {
+		_cv.wait( lock, [this] { return _pending || _quit; } );
+		if ( _quit )
+			return;
+
+		lock.unlock();
+		_job();
+		lock.lock();
+
+		_pending = false;
+		_cv.notify_all();
+	}
+}
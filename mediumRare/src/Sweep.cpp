@@ -0,0 +1,320 @@
+#include "../include/Sweep.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+	// two-sided 95% quantiles of Student's t distribution for 1..30 degrees of freedom
+	const f64 kStudentT95[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+	};
+
+	f64 studentT95( u32 degreesOfFreedom ) {
+		if ( degreesOfFreedom == 0 )
+			return 0.0;
+		return degreesOfFreedom <= 30 ? kStudentT95[degreesOfFreedom - 1] : 1.960;
+	}
+
+	bool isNameInList( const char *names, const char *name ) {
+		const size_t len = strlen( name );
+		for ( const char *p = strstr( names, name ); p; p = strstr( p + 1, name ) ) {
+			const bool startsToken = p == names || p[-1] == ',';
+			const bool endsToken   = p[len] == ',' || p[len] == '\0';
+			if ( startsToken && endsToken )
+				return true;
+		}
+		return false;
+	}
+
+	bool isFactorSelected( const char *names, const char *name ) {
+		return !names || !strcmp( names, "all" ) || isNameInList( names, name );
+	}
+}
+
+mr::OptionSweep::OptionSweep( std::vector<SweepFactor> factors, const char *factorNames, const CameraPositioner_Path &path, u32 numViewpoints,
+	u32 settleFrames, u32 measuredFrames, const char *passName )
+	: _path( path ), _numViewpoints( std::max( numViewpoints, 1u ) ), _settleFrames( settleFrames ), _measuredFrames( std::clamp( measuredFrames, 1u, kMaxMeasuredFrames ) ),
+	  _passName( passName ) {
+	for ( SweepFactor &f : factors ) {
+		if ( isFactorSelected( factorNames, f.name ) ) {
+			_factors.push_back( std::move( f ) );
+		} else {
+			// factors that are not swept stay at their baseline for the whole run
+			f.apply( 0 );
+		}
+	}
+	if ( _factors.size() > kMaxFactors ) {
+		printf( "[ERROR] Too many sweep factors (%u), at most %u are supported\n", u32( _factors.size() ), kMaxFactors );
+		_factors.clear();
+		return;
+	}
+	if ( _factors.empty() ) {
+		printf( "[ERROR] No sweep factor matches '%s'\n", factorNames );
+		return;
+	}
+
+	const u32 numFactors = u32( _factors.size() );
+	u64 numFullFactorial = 1;
+	for ( u32 i = 0; i != numFactors && numFullFactorial <= kMaxCombinations; ++i )
+		numFullFactorial *= getNumLevels( i );
+	_oneFactorAtATime = !factorNames || !strcmp( factorNames, "all" ) || numFullFactorial > kMaxCombinations;
+
+	if ( _oneFactorAtATime ) {
+		// the baseline first, then the levels of every factor
+		_numCombinations = 1;
+		for ( u32 i = 0; i != numFactors; ++i )
+			_numCombinations += getNumLevels( i ) - 1;
+		_levels.resize( _numCombinations * numFactors, 0 );
+		u32 c = 1;
+		for ( u32 i = 0; i != numFactors; ++i ) {
+			for ( u32 l = 1; l != getNumLevels( i ); ++l )
+				_levels[c++ * numFactors + i] = u8( l );
+		}
+	} else {
+		// mixed radix: the first factor changes fastest
+		_numCombinations = u32( numFullFactorial );
+		_strides.resize( numFactors );
+		u32 stride = 1;
+		for ( u32 i = 0; i != numFactors; ++i ) {
+			_strides[i] = stride;
+			stride     *= getNumLevels( i );
+		}
+		_levels.resize( _numCombinations * numFactors );
+		for ( u32 c = 0; c != _numCombinations; ++c ) {
+			for ( u32 i = 0; i != numFactors; ++i )
+				_levels[c * numFactors + i] = u8( c / _strides[i] % getNumLevels( i ) );
+		}
+	}
+
+	_cpuMs.resize( getNumCells() * _measuredFrames, -1.0f );
+	_gpuMs.resize( getNumCells() * _measuredFrames, -1.0f );
+	if ( _passName )
+		_passMs.resize( getNumCells() * _measuredFrames, -1.0f );
+
+	printf( "[INFO] Option sweep: %u factors, %u combinations (%s), %u viewpoints, %llu frames\n",
+		numFactors, _numCombinations, _oneFactorAtATime ? "one factor at a time" : "full factorial", _numViewpoints,
+		(unsigned long long)getNumFrames() );
+}
+
+void mr::OptionSweep::getLevelName( u32 factor, u32 level, char *name, size_t size ) const {
+	const SweepFactor &f = _factors[factor];
+	if ( f.levels.empty() )
+		snprintf( name, size, "%s", f.name );
+	else
+		snprintf( name, size, "%s:%s", f.name, f.levels[level] );
+}
+
+s64 mr::OptionSweep::getSampleIndex( u64 frame ) const {
+	const u32 framesPerCell = _settleFrames + _measuredFrames;
+	const u64 cell          = frame / framesPerCell;
+	const u32 i             = u32( frame % framesPerCell );
+
+	if ( cell >= getNumCells() || i < _settleFrames )
+		return -1;
+	return s64( cell * _measuredFrames + ( i - _settleFrames ) );
+}
+
+void mr::OptionSweep::beginFrame() {
+	// the last frames only wait for the GPU timings, keep rendering the last cell
+	const u64 frame = std::min( _frameIndex, getNumFrames() - 1 );
+	const u32 cell  = u32( frame / ( _settleFrames + _measuredFrames ) );
+
+	const s64 combination = cell / _numViewpoints;
+	const u32 viewpoint   = cell % _numViewpoints;
+
+	if ( combination != _currentCombination ) {
+		for ( u32 i = 0; i != _factors.size(); ++i )
+			_factors[i].apply( getLevel( u32( combination ), i ) );
+		_currentCombination = combination;
+	}
+
+	// viewpoints are evenly spaced along the path, the path is expected to loop
+	_path.setTime( _path.getDuration() * f32( viewpoint ) / f32( _numViewpoints ) );
+}
+
+void mr::OptionSweep::addFrame( f32 cpuMs, const GPUProfiler &profiler ) {
+	const s64 cpuSample = getSampleIndex( _frameIndex );
+	if ( cpuSample >= 0 )
+		_cpuMs[cpuSample] = cpuMs;
+	_frameIndex++;
+
+	// at most one frame is resolved per GPUProfiler::beginFrame()
+	if ( profiler.getNumResolvedFrames() == _numResolvedFrames )
+		return;
+	_numResolvedFrames = profiler.getNumResolvedFrames();
+
+	const GPUProfiler::Scope &frame = profiler.getFrameScope();
+	const s64 gpuSample             = getSampleIndex( frame.lastFrame );
+	if ( gpuSample < 0 )
+		return;
+	_gpuMs[gpuSample] = frame.stats.last;
+
+	if ( _passName ) {
+		// a pass that did not run in the frame costs nothing, e.g. the impostors when they are off
+		f32 passMs = 0.0f;
+		for ( u32 i = 0; i != profiler.getNumScopes(); ++i ) {
+			const GPUProfiler::Scope &scope = profiler.getScope( i );
+			if ( scope.name && isNameInList( _passName, scope.name ) && scope.lastFrame == frame.lastFrame ) {
+				passMs       += scope.stats.last;
+				_passWasFound = true;
+			}
+		}
+		_passMs[gpuSample] = passMs;
+	}
+}
+
+f64 mr::OptionSweep::getCellValue( const std::vector<f32> &samples, u32 cell ) const {
+	// median of the measured frames, robust to the occasional hitch
+	f32 values[kMaxMeasuredFrames];
+	u32 n = 0;
+	for ( u32 i = 0; i != _measuredFrames; ++i ) {
+		const f32 v = samples[cell * _measuredFrames + i];
+		if ( v >= 0.0f )
+			values[n++] = v;
+	}
+	if ( !n )
+		return -1.0;
+	std::nth_element( values, values + n / 2, values + n );
+	return values[n / 2];
+}
+
+mr::OptionSweep::Effect mr::OptionSweep::computeEffect( const std::vector<f32> &samples, u32 factor, u32 level ) const {
+	f64 sum = 0.0, sumSq = 0.0;
+	u32 n   = 0;
+	for ( u32 c = 0; c != _numCombinations; ++c ) {
+		if ( getLevel( c, factor ) != 0 )
+			continue;
+
+		// the combination that only differs by the level of factor, one factor at a time only the baseline has one
+		u32 partner = 0;
+		if ( _oneFactorAtATime ) {
+			if ( c != 0 )
+				break;
+			while ( getLevel( partner, factor ) != level )
+				partner++;
+		} else {
+			partner = c + level * _strides[factor];
+		}
+
+		for ( u32 v = 0; v != _numViewpoints; ++v ) {
+			const f64 off = getCellValue( samples, c * _numViewpoints + v );
+			const f64 on  = getCellValue( samples, partner * _numViewpoints + v );
+			if ( off < 0.0 || on < 0.0 )
+				continue;
+			const f64 d = on - off;
+			sum   += d;
+			sumSq += d * d;
+			n++;
+		}
+	}
+
+	Effect e;
+	e.numPairs = n;
+	if ( !n )
+		return e;
+
+	e.mean = sum / n;
+	if ( n > 1 ) {
+		const f64 variance = std::max( 0.0, ( sumSq - n * e.mean * e.mean ) / ( n - 1 ) );
+		e.halfWidth        = studentT95( n - 1 ) * sqrt( variance / n );
+	}
+	return e;
+}
+
+bool mr::OptionSweep::writeReport( const char *fileName ) const {
+	char name[64];
+
+	if ( _passName && !_passWasFound )
+		printf( "[ERROR] No GPU scope of '%s' was measured, its column is 0\n", _passName );
+
+	printf( "\n%-24s %28s %28s %6s", "Factor", "GPU ms (95% CI)", "CPU ms (95% CI)", "pairs" );
+	if ( _passName )
+		printf( "   %s ms (95%% CI)", _passName );
+	printf( "\n" );
+	for ( u32 i = 0; i != _factors.size(); ++i ) {
+		for ( u32 l = 1; l != getNumLevels( i ); ++l ) {
+			const Effect gpu = computeEffect( _gpuMs, i, l );
+			const Effect cpu = computeEffect( _cpuMs, i, l );
+			getLevelName( i, l, name, sizeof(name) );
+			printf( "%-24s %+14.4f +/- %-10.4f %+14.4f +/- %-10.4f %6u", name, gpu.mean, gpu.halfWidth, cpu.mean, cpu.halfWidth, gpu.numPairs );
+			if ( _passName ) {
+				const Effect pass = computeEffect( _passMs, i, l );
+				printf( "   %+14.4f +/- %-10.4f", pass.mean, pass.halfWidth );
+			}
+			printf( "\n" );
+		}
+	}
+	printf( "\n" );
+
+	FILE *f = fopen( fileName, "w" );
+	if ( !f ) {
+		printf( "[ERROR] Cannot open '%s' for writing\n", fileName );
+		return false;
+	}
+
+	fprintf( f, "{\n" );
+	fprintf( f, "  \"design\": \"%s\",\n", _oneFactorAtATime ? "one-factor-at-a-time" : "full-factorial" );
+	fprintf( f, "  \"viewpoints\": %u,\n  \"settleFrames\": %u,\n  \"measuredFrames\": %u,\n", _numViewpoints, _settleFrames, _measuredFrames );
+	if ( _passName )
+		fprintf( f, "  \"pass\": \"%s\",\n", _passName );
+
+	fprintf( f, "  \"effects\": [" );
+	bool firstEffect = true;
+	for ( u32 i = 0; i != _factors.size(); ++i ) {
+		for ( u32 l = 1; l != getNumLevels( i ); ++l ) {
+			const Effect gpu = computeEffect( _gpuMs, i, l );
+			const Effect cpu = computeEffect( _cpuMs, i, l );
+			getLevelName( i, l, name, sizeof(name) );
+			fprintf( f, "%s\n    { \"factor\": \"%s\", \"pairs\": %u, \"gpuMs\": { \"mean\": %.4f, \"ci95\": %.4f }, \"cpuMs\": { \"mean\": %.4f, \"ci95\": %.4f }",
+				firstEffect ? "" : ",", name, gpu.numPairs, gpu.mean, gpu.halfWidth, cpu.mean, cpu.halfWidth );
+			if ( _passName ) {
+				const Effect pass = computeEffect( _passMs, i, l );
+				fprintf( f, ", \"passMs\": { \"mean\": %.4f, \"ci95\": %.4f }", pass.mean, pass.halfWidth );
+			}
+			fprintf( f, " }" );
+			firstEffect = false;
+		}
+	}
+	fprintf( f, "\n  ],\n" );
+
+	// mean over the viewpoints of every combination, for the absolute numbers and, with the full factorial design,
+	// the interactions between factors
+	fprintf( f, "  \"combinations\": [\n" );
+	for ( u32 c = 0; c != _numCombinations; ++c ) {
+		f64 gpuSum = 0.0, cpuSum = 0.0, passSum = 0.0;
+		u32 numGPU = 0, numCPU = 0, numPass = 0;
+		for ( u32 v = 0; v != _numViewpoints; ++v ) {
+			const f64 gpu = getCellValue( _gpuMs, c * _numViewpoints + v );
+			const f64 cpu = getCellValue( _cpuMs, c * _numViewpoints + v );
+			if ( gpu >= 0.0 ) { gpuSum += gpu; numGPU++; }
+			if ( cpu >= 0.0 ) { cpuSum += cpu; numCPU++; }
+			if ( _passName ) {
+				const f64 pass = getCellValue( _passMs, c * _numViewpoints + v );
+				if ( pass >= 0.0 ) { passSum += pass; numPass++; }
+			}
+		}
+		fprintf( f, "    { \"enabled\": [" );
+		bool first = true;
+		for ( u32 i = 0; i != _factors.size(); ++i ) {
+			const u32 level = getLevel( c, i );
+			if ( !level )
+				continue;
+			getLevelName( i, level, name, sizeof(name) );
+			fprintf( f, "%s\"%s\"", first ? "" : ", ", name );
+			first = false;
+		}
+		fprintf( f, "], \"gpuMs\": %.4f, \"cpuMs\": %.4f", numGPU ? gpuSum / numGPU : -1.0, numCPU ? cpuSum / numCPU : -1.0 );
+		if ( _passName )
+			fprintf( f, ", \"passMs\": %.4f", numPass ? passSum / numPass : -1.0 );
+		fprintf( f, " }%s\n", c + 1 == _numCombinations ? "" : "," );
+	}
+	fprintf( f, "  ]\n}\n" );
+	fclose( f );
+
+	printf( "[INFO] Sweep results written to '%s'\n", fileName );
+	return true;
+}
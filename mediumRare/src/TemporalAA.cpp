@@ -0,0 +1,51 @@
+#include "../include/TemporalAA.hpp"
+
+namespace {
+	f32 halton( u32 index, u32 base ) {
+		f32 result = 0.0f;
+		f32 f      = 1.0f;
+		for ( ; index > 0; index /= base ) {
+			f      /= f32( base );
+			result += f * f32( index % base );
+		}
+		return result;
+	}
+}
+
+void mr::TemporalAA::update( bool enabled, const glm::mat4 &viewProj, const lvk::Dimensions &renderSize ) {
+	if ( !enabled || !_enabled || renderSize.width != _renderSize.width || renderSize.height != _renderSize.height )
+		_historyValid = false;
+
+	_enabled    = enabled;
+	_renderSize = renderSize;
+	_viewProj   = viewProj;
+	if ( !_historyValid )
+		_prevViewProj = viewProj;
+
+	if ( !enabled ) {
+		_jitterNDC = glm::vec2( 0.0f );
+		return;
+	}
+
+	// Halton starts at 1, 0 would give a zero offset on both axes
+	_frameIndex = ( _frameIndex + 1 ) % kNumJitterSamples;
+	const glm::vec2 sample( halton( _frameIndex + 1, 2 ), halton( _frameIndex + 1, 3 ) );
+	_jitterNDC = ( sample * 2.0f - 1.0f ) / glm::vec2( renderSize.width, renderSize.height );
+}
+
+void mr::TemporalAA::endFrame() {
+	if ( !_enabled )
+		return;
+
+	_prevViewProj = _viewProj;
+	_historyValid = true;
+	_historyIndex ^= 1;
+}
+
+glm::mat4 mr::TemporalAA::jitter( const glm::mat4 &proj ) const {
+	if ( !_enabled )
+		return proj;
+
+	// Offset in NDC after the projection, so it is the same sub-pixel amount at every depth
+	return glm::translate( glm::mat4( 1.0f ), glm::vec3( _jitterNDC, 0.0f ) ) * proj;
+}
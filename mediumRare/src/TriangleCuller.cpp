@@ -0,0 +1,246 @@
+#include "../include/TriangleCuller.hpp"
+
+#include <shared/Utils.h>
+
+#include <algorithm>
+
+namespace {
+	// Same layouts as DrawData and VertexBounds in Mesh.hpp
+	struct DrawDataGPU {
+		u32 transformId;
+		u32 materialId;
+	};
+
+	struct VertexBoundsGPU {
+		vec4       offset;
+		vec4       scale;
+		glm::uvec4 stream;
+	};
+
+	// Same values as in TriangleCull.comp
+	constexpr u32 kFlag_Backface        = 1;
+	constexpr u32 kFlag_SmallPrimitives = 2;
+}
+
+mr::TriangleCuller::TriangleCuller( const std::unique_ptr<lvk::IContext> &ctx, const MeshData &meshData, const std::vector<DrawNode> &drawNodes,
+	const MeshInputs &inputs, const Params &params )
+	: _ctx( ctx ), _vertices( inputs.vertices ), _vertexSize( inputs.vertexSize ), _bufferTransforms( inputs.bufferTransforms ) {
+
+	LVK_ASSERT( inputs.vertexSize % sizeof(u32) == 0 );
+
+	std::vector<u8> isCandidateMesh( meshData.meshes.size(), 0 );
+	for ( u32 i = 0; i != drawNodes.size(); i++ ) {
+		const u32 numTriangles = inputs.meshDraws[drawNodes[i].mesh].numIndices / 3;
+		if ( numTriangles < params.minTriangles )
+			continue;
+		_candidates.push_back({ .instance = i, .mesh = drawNodes[i].mesh, .numTriangles = numTriangles });
+		_numTriangles += numTriangles;
+		isCandidateMesh[drawNodes[i].mesh] = 1;
+	}
+	if ( _candidates.empty() )
+		return;
+
+	_numMeshes    = u32( std::count( isCandidateMesh.begin(), isCandidateMesh.end(), 1 ) );
+	_maxTriangles = u32( std::min<u64>( params.maxTriangles, _numTriangles ) );
+
+	const u64 indices16 = inputs.indices16.valid() ? ctx->gpuAddress( inputs.indices16 ) : 0;
+	const u64 indices32 = inputs.indices32.valid() ? ctx->gpuAddress( inputs.indices32 ) : 0;
+
+	std::vector<DrawDataGPU>     drawData;
+	std::vector<VertexBoundsGPU> vertexBounds;
+	drawData.reserve( _candidates.size() );
+	vertexBounds.reserve( _candidates.size() );
+	_slotTemplates.reserve( _candidates.size() );
+	for ( const Candidate &c : _candidates ) {
+		const MeshDraw &d = inputs.meshDraws[c.mesh];
+		// offset and scale are not read by the shaders with float positions
+		const glm::uvec4 stream = glm::uvec4( meshData.isQuantized() ? VertexLayout_Quantized : VertexLayout_Float,
+			u32( d.baseVertex ) * _vertexSize, _vertexSize, 0 );
+		const VertexBoundsGPU bounds = meshData.isQuantized() ? VertexBoundsGPU {
+			.offset = vec4( meshData.vertexBounds[c.mesh].min_, 0.0f ),
+			.scale  = vec4( meshData.vertexBounds[c.mesh].getSize(), 0.0f ),
+			.stream = stream
+		} : VertexBoundsGPU { .offset = vec4( 0.0f ), .scale = vec4( 1.0f ), .stream = stream };
+
+		drawData.push_back({ .transformId = drawNodes[c.instance].node, .materialId = meshData.meshes[c.mesh].materialID });
+		vertexBounds.push_back( bounds );
+		_slotTemplates.push_back({
+			.boundsOffset = bounds.offset,
+			.boundsScale  = bounds.scale,
+			.indices      = d.indices16 ? indices16 : indices32,
+			.firstIndex   = d.firstIndex,
+			.numTriangles = c.numTriangles,
+			.baseVertex   = d.baseVertex,
+			.indices16    = d.indices16 ? 1u : 0u,
+			.transformId  = drawNodes[c.instance].node,
+		});
+	}
+	_slots.reserve( _candidates.size() );
+	_commands.reserve( _candidates.size() );
+
+	_bufferDrawData = ctx->createBuffer({
+		.usage     = lvk::BufferUsageBits_Storage,
+		.storage   = lvk::StorageType_Device,
+		.size      = drawData.size() * sizeof(DrawDataGPU),
+		.data      = drawData.data(),
+		.debugName = "Buffer: triangle culling drawData"
+	});
+	_bufferVertexBounds = ctx->createBuffer({
+		.usage     = lvk::BufferUsageBits_Storage,
+		.storage   = lvk::StorageType_Device,
+		.size      = vertexBounds.size() * sizeof(VertexBoundsGPU),
+		.data      = vertexBounds.data(),
+		.debugName = "Buffer: triangle culling vertex bounds"
+	});
+	// updated by upload() every frame
+	_bufferSlots = ctx->createBuffer({
+		.usage     = lvk::BufferUsageBits_Storage,
+		.storage   = lvk::StorageType_Device,
+		.size      = _candidates.size() * sizeof(SlotGPU),
+		.debugName = "Buffer: triangle culling slots"
+	});
+	for ( u32 p = 0; p != Pass_Count; p++ ) {
+		_bufferIndices[p] = ctx->createBuffer({
+			.usage     = lvk::BufferUsageBits_Index | lvk::BufferUsageBits_Storage,
+			.storage   = lvk::StorageType_Device,
+			.size      = 3 * u64( _maxTriangles ) * sizeof(u32),
+			.debugName = p == Pass_Main ? "Buffer: culled indices" : "Buffer: culled indices (shadow)"
+		});
+		_bufferCommands[p] = ctx->createBuffer({
+			.usage     = lvk::BufferUsageBits_Indirect | lvk::BufferUsageBits_Storage,
+			.storage   = lvk::StorageType_Device,
+			.size      = _candidates.size() * sizeof(CommandGPU),
+			.debugName = p == Pass_Main ? "Buffer: culled indirect" : "Buffer: culled indirect (shadow)"
+		});
+	}
+
+	_comp     = loadShaderModule( ctx, "../shaders/TriangleCull.comp", inputs.vertexDefines );
+	_pipeline = ctx->createComputePipeline( { .smComp = _comp } );
+}
+
+u32 mr::TriangleCuller::select( bool enabled, u32 *visible, std::vector<u32> &instances ) const {
+	instances.clear();
+	if ( !enabled )
+		return 0;
+
+	u32 numTriangles = 0;
+	u32 numGroups    = 0;
+	for ( u32 c = 0; c != _candidates.size(); c++ ) {
+		const Candidate &candidate = _candidates[c];
+		if ( !visible[candidate.instance] )
+			continue;
+		// the ones that do not fit stay in the draws of VkMesh
+		const u32 groups = ( candidate.numTriangles + kGroupSize - 1 ) / kGroupSize;
+		if ( numTriangles + candidate.numTriangles > _maxTriangles || numGroups + groups > kMaxGroups )
+			continue;
+		numTriangles += candidate.numTriangles;
+		numGroups    += groups;
+		visible[candidate.instance] = 0;
+		instances.push_back( c );
+	}
+	return u32( instances.size() );
+}
+
+void mr::TriangleCuller::upload( lvk::ICommandBuffer &buf, const std::vector<u32> &instances ) {
+	_numSlots  = u32( instances.size() );
+	_numGroups = 0;
+	_slots.clear();
+	_commands.clear();
+	if ( !_numSlots )
+		return;
+
+	u32 firstOutput = 0;
+	for ( u32 i = 0; i != _numSlots; i++ ) {
+		SlotGPU slot     = _slotTemplates[instances[i]];
+		slot.firstGroup  = _numGroups;
+		slot.firstOutput = firstOutput;
+		_slots.push_back( slot );
+
+		// the draw data and the vertex bounds of the candidate are at gl_InstanceIndex
+		_commands.push_back({ .count = 0, .instanceCount = 1, .firstIndex = firstOutput, .baseVertex = slot.baseVertex, .baseInstance = instances[i] });
+		_numGroups  += ( slot.numTriangles + kGroupSize - 1 ) / kGroupSize;
+		firstOutput += 3 * slot.numTriangles;
+	}
+	cmdUpdateBufferChunked( buf, _bufferSlots, 0, _numSlots * sizeof(SlotGPU), _slots.data() );
+}
+
+void mr::TriangleCuller::cull( lvk::ICommandBuffer &buf, Pass pass, const glm::mat4 &viewProj, const lvk::Dimensions &viewport, bool backface,
+	bool smallPrimitives ) {
+
+	if ( !_numSlots )
+		return;
+
+	// the workgroups add their triangles to the zero counts
+	cmdUpdateBufferChunked( buf, _bufferCommands[pass], 0, _numSlots * sizeof(CommandGPU), _commands.data() );
+
+	// Same layout as PushConstants in TriangleCull.comp
+	const struct {
+		mat4 viewProj;
+		vec2 viewportSize;
+		u32  numSlots;
+		u32  vertexStride;
+		u32  flags;
+		u32  padding;
+		u64  bufferSlots;
+		u64  bufferTransforms;
+		u64  bufferVertices;
+		u64  bufferIndices;
+		u64  bufferCommands;
+	} pc = {
+		.viewProj         = viewProj,
+		.viewportSize     = vec2( f32( viewport.width ), f32( viewport.height ) ),
+		.numSlots         = _numSlots,
+		.vertexStride     = _vertexSize / u32( sizeof(u32) ),
+		.flags            = ( backface ? kFlag_Backface : 0 ) | ( smallPrimitives ? kFlag_SmallPrimitives : 0 ),
+		.padding          = 0,
+		.bufferSlots      = _ctx->gpuAddress( _bufferSlots ),
+		.bufferTransforms = _bufferTransforms,
+		.bufferVertices   = _ctx->gpuAddress( _vertices ),
+		.bufferIndices    = _ctx->gpuAddress( _bufferIndices[pass] ),
+		.bufferCommands   = _ctx->gpuAddress( _bufferCommands[pass] )
+	};
+	static_assert( sizeof(pc) <= 128 );
+
+	buf.cmdBindComputePipeline( _pipeline );
+	buf.cmdPushConstants( pc );
+	buf.cmdDispatchThreadGroups( { .width = _numGroups }, {
+		.buffers = { lvk::BufferHandle( _bufferIndices[pass] ), lvk::BufferHandle( _bufferCommands[pass] ) }
+	});
+}
+
+void mr::TriangleCuller::draw( lvk::ICommandBuffer &buf, Pass pass, const Pipeline &pipeline, const glm::mat4 &viewProj, u64 bufferMaterials,
+	u64 bufferLight, u32 skyboxIrradiance, bool wireframe ) const {
+
+	if ( !_numSlots )
+		return;
+
+	// Same layout as PerFrameData in common.sp
+	const struct {
+		mat4 viewProj;
+		u64  bufferTransforms;
+		u64  bufferDrawData;
+		u64  bufferMaterials;
+		u64  bufferLight;
+		u32  skyboxIrradiance;
+		u64  bufferVertexBounds;
+		u64  bufferVertices;
+	} pc = {
+		.viewProj           = viewProj,
+		.bufferTransforms   = _bufferTransforms,
+		.bufferDrawData     = _ctx->gpuAddress( _bufferDrawData ),
+		.bufferMaterials    = bufferMaterials,
+		.bufferLight        = bufferLight,
+		.skyboxIrradiance   = skyboxIrradiance,
+		.bufferVertexBounds = _ctx->gpuAddress( _bufferVertexBounds ),
+		.bufferVertices     = _ctx->gpuAddress( _vertices )
+	};
+	static_assert( sizeof(pc) <= 128 );
+
+	// a no-op for the pipelines of the vertex pulling, which have no vertex input state
+	buf.cmdBindVertexBuffer( 0, _vertices );
+	buf.cmdBindRenderPipeline( wireframe ? pipeline._pipelineWireframe : pipeline._pipeline );
+	buf.cmdBindDepthState( { .compareOp = lvk::CompareOp_Less, .isDepthWriteEnabled = true } );
+	buf.cmdPushConstants( pc );
+	buf.cmdBindIndexBuffer( _bufferIndices[pass], lvk::IndexFormat_UI32 );
+	buf.cmdDrawIndexedIndirect( _bufferCommands[pass], 0, _numSlots, sizeof(CommandGPU) );
+}
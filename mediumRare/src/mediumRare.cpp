@@ -1,17 +1,91 @@
 #include "../include/ImGuiComponents.hpp"
 #include "../include/App.hpp"
 #include "../include/Mesh.hpp"
+#include "../include/GPUProfiler.hpp"
+#include "../include/Benchmark.hpp"
+#include "../include/Sweep.hpp"
+#include "../include/FrameAllocator.hpp"
+#include "../include/AllocationCounter.hpp"
+#include "../include/FramePipeline.hpp"
+#include "../include/SimulationThread.hpp"
+#include "../include/DynamicResolution.hpp"
+#include "../include/TemporalAA.hpp"
+#include "../include/HLOD.hpp"
+#include "../include/Impostors.hpp"
+#include "../include/OcclusionCuller.hpp"
+#include "../include/PVS.hpp"
+#include "../include/TriangleCuller.hpp"
 #include <shared/Scene/SceneUtils.h>
 #include <shared/Scene/MergeUtil.h>
 #include <shared/LineCanvas.h>
 #include <shared/UtilsMath.h>
 
-const char *cachedMeshesFilename    = ".cache/cache.meshes";
-const char *cachedMaterialsFilename = ".cache/cache.materials";
-const char *cachedHierarchyFilename = ".cache/cache.scene";
+#include <chrono>
+#include <filesystem>
+#include <string.h>
 
-int main( void ) {
-    if ( !isMeshDataValid(cachedMeshesFilename) || !isMeshHierarchyValid(cachedHierarchyFilename) || !isMeshMaterialsValid(cachedMaterialsFilename) ) {
+const char *cachedMeshesFilename          = ".cache/cache.meshes";
+const char *cachedQuantizedMeshesFilename = ".cache/cache_quantized.meshes";
+const char *cachedMaterialsFilename       = ".cache/cache.materials";
+const char *cachedHierarchyFilename       = ".cache/cache.scene";
+const char *cachedHLODFilename            = ".cache/cache.hlod";
+const char *cachedImpostorsFilename       = ".cache/cache.impostors";
+const char *cachedPVSFilename             = ".cache/cache.pvs";
+const char *cachedBatchingFilename        = ".cache/cache.batching";
+
+// The cell sizes the cached meshes were batched with, other sizes on the command line rebuild the mesh cache
+static bool isBatchingValid( const char *fileName, const mr::BenchmarkConfig &cfg ) {
+    FILE *f = fopen( fileName, "rb" );
+    if ( !f )
+        return false;
+    f32 cellSizes[2] = {};
+    const bool ok = fread( cellSizes, sizeof(cellSizes), 1, f ) == 1 &&
+        cellSizes[0] == cfg.batchCellSize && cellSizes[1] == cfg.batchAlphaTestedCellSize;
+    fclose( f );
+    return ok;
+}
+
+static void saveBatching( const char *fileName, const mr::BenchmarkConfig &cfg ) {
+    FILE *f = fopen( fileName, "wb" );
+    if ( !f ) {
+        printf( "[ERROR] Cannot open '%s' for writing\n", fileName );
+        return;
+    }
+    const f32 cellSizes[2] = { cfg.batchCellSize, cfg.batchAlphaTestedCellSize };
+    fwrite( cellSizes, sizeof(cellSizes), 1, f );
+    fclose( f );
+}
+
+// LVK stops reading the dependencies at the first empty handle, so the empty ones of optional passes are skipped here
+static lvk::Dependencies packDependencies( std::initializer_list<lvk::TextureHandle> textures, std::initializer_list<lvk::BufferHandle> buffers = {} ) {
+    lvk::Dependencies deps;
+    u32 numTextures = 0, numBuffers = 0;
+    for ( lvk::TextureHandle texture : textures ) {
+        if ( texture.empty() )
+            continue;
+        LVK_ASSERT( numTextures < LVK_MAX_SUBMIT_DEPENDENCIES );
+        deps.textures[numTextures++] = texture;
+    }
+    for ( lvk::BufferHandle buffer : buffers ) {
+        if ( buffer.empty() )
+            continue;
+        LVK_ASSERT( numBuffers < LVK_MAX_SUBMIT_DEPENDENCIES );
+        deps.buffers[numBuffers++] = buffer;
+    }
+    return deps;
+}
+
+int main( int argc, char *argv[] ) {
+    mr::BenchmarkConfig benchmarkCfg;
+    if ( !mr::ParseBenchmarkArgs( argc, argv, benchmarkCfg ) )
+        return 1;
+
+    // The proxies of the HLOD clusters are part of the cached meshes and scene, so both are rebuilt together
+    mr::HLOD hlod;
+    const bool hlodLoaded = hlod.load( cachedHLODFilename );
+
+    if ( !hlodLoaded || !isMeshDataValid(cachedMeshesFilename) || !isMeshHierarchyValid(cachedHierarchyFilename) || !isMeshMaterialsValid(cachedMaterialsFilename) ||
+         !isBatchingValid(cachedBatchingFilename, benchmarkCfg) ) {
         printf( "[INFO] No cached mesh data found. Precaching...\n" );
 
         MeshData meshData_Exterior, meshData_Interior;
@@ -20,14 +94,6 @@ int main( void ) {
         loadMeshFile( "../../deps/src/bistro/Exterior/exterior.obj", meshData_Exterior, scene_Exterior, false );
         loadMeshFile( "../../deps/src/bistro/Interior/interior.obj", meshData_Interior, scene_Interior, false );
 
-        printf("[Unmerged] scene items: %u\n", (u32)scene_Exterior.hierarchy.size());
-        mergeNodesWithMaterial(scene_Exterior, meshData_Exterior, "Foliage_Linde_Tree_Large_Orange_Leaves");
-        printf("[Merged orange leaves] scene items: %u\n", (u32)scene_Exterior.hierarchy.size());
-        mergeNodesWithMaterial(scene_Exterior, meshData_Exterior, "Foliage_Linde_Tree_Large_Green_Leaves");
-        printf("[Merged green leaves]  scene items: %u\n", (u32)scene_Exterior.hierarchy.size());
-        mergeNodesWithMaterial(scene_Exterior, meshData_Exterior, "Foliage_Linde_Tree_Large_Trunk");
-        printf("[Merged trunk]  scene items: %u\n", (u32)scene_Exterior.hierarchy.size());
-
         MeshData meshData;
         Scene scene;
 
@@ -51,20 +117,232 @@ int main( void ) {
         scene.localTransform[0] = glm::scale( vec3(0.01f) );
         markAsChanged( scene, 0 );
 
+        const u32 numMeshes     = (u32)meshData.meshes.size();
+        const u64 meshDataSize  = meshData.vertexData.size() + meshData.indexData.size() * sizeof(u32);
+        const u32 numDuplicates = deduplicateMeshes( scene, meshData );
+        const u64 dedupDataSize = meshData.vertexData.size() + meshData.indexData.size() * sizeof(u32);
+        printf( "[Deduplicated] meshes: %u -> %u, vertex and index data: %.1f MB -> %.1f MB\n", numMeshes, numMeshes - numDuplicates,
+            f64( meshDataSize ) / ( 1024.0 * 1024.0 ), f64( dedupDataSize ) / ( 1024.0 * 1024.0 ) );
+
+        // Static batching: draw calls against culling efficiency for a few cell sizes. The views are a grid of cameras at eye height
+        // looking in 4 directions, the efficiency is the number of triangles of the visible nodes without batching divided by the
+        // number of triangles submitted with it
+        {
+            struct NodeBox {
+                BoundingBox box;
+                u64         numTriangles;
+            };
+            const auto getNodeBoxes = []( Scene &s, MeshData &md ) {
+                recalculateGlobalTransforms( s );
+                recalculateBoundingBoxes( md );
+                std::vector<NodeBox> boxes;
+                for ( auto &p : s.meshForNode ) {
+                    boxes.push_back({ md.boxes[p.second].getTransformed( s.globalTransform[p.first] ), md.meshes[p.second].getLODIndicesCount( 0 ) / 3 });
+                }
+                return boxes;
+            };
+
+            Scene     unbatchedScene    = scene;
+            MeshData  unbatchedMeshData = meshData;
+            const std::vector<NodeBox> unbatchedBoxes = getNodeBoxes( unbatchedScene, unbatchedMeshData );
+
+            BoundingBox sceneBox = unbatchedBoxes.front().box;
+            for ( const NodeBox &b : unbatchedBoxes ) {
+                sceneBox.combinePoint( b.box.min_ );
+                sceneBox.combinePoint( b.box.max_ );
+            }
+            const vec3 size = sceneBox.getSize();
+            const mat4 proj = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.01f * glm::length( size ), glm::length( size ) );
+
+            std::vector<mat4> viewProjs;
+            for ( u32 i = 0; i != 9; i++ ) {
+                const vec3 eye = sceneBox.min_ + size * vec3( 0.25f + 0.25f * f32( i % 3 ), 0.05f, 0.25f + 0.25f * f32( i / 3 ) );
+                for ( u32 d = 0; d != 4; d++ ) {
+                    const f32 yaw = glm::half_pi<f32>() * f32( d );
+                    viewProjs.push_back( proj * glm::lookAt( eye, eye + vec3( cosf( yaw ), 0.0f, sinf( yaw ) ), vec3( 0, 1, 0 ) ) );
+                }
+            }
+            const auto countVisibleTriangles = [&viewProjs]( const std::vector<NodeBox> &boxes ) {
+                u64 numTriangles = 0;
+                for ( const mat4 &viewProj : viewProjs ) {
+                    vec4 frustumPlanes[6];
+                    getFrustumPlanes( viewProj, frustumPlanes );
+                    vec4 frustumCorners[8];
+                    getFrustumCorners( viewProj, frustumCorners );
+                    for ( const NodeBox &b : boxes ) {
+                        numTriangles += isBoxInFrustum( frustumPlanes, frustumCorners, b.box ) ? b.numTriangles : 0;
+                    }
+                }
+                return numTriangles;
+            };
+            const u64 numVisibleTriangles = countVisibleTriangles( unbatchedBoxes );
+
+            printf( "[Batching] no batching:     %5u draws, culling efficiency 100%%\n", u32( unbatchedMeshData.meshes.size() ) );
+            for ( const f32 cellSize : { 5.0f, 10.0f, 20.0f, 40.0f, 0.0f } ) {
+                Scene    batchedScene    = scene;
+                MeshData batchedMeshData = meshData;
+                const u32 numBatches     = batchStaticNodes( batchedScene, batchedMeshData, cellSize, benchmarkCfg.batchAlphaTestedCellSize );
+                const u64 numSubmitted   = countVisibleTriangles( getNodeBoxes( batchedScene, batchedMeshData ) );
+                printf( "[Batching] cell size %5.1f: %5u draws (%u batches), culling efficiency %3.0f%%\n", cellSize,
+                    u32( batchedMeshData.meshes.size() ), numBatches, numSubmitted ? 100.0 * f64( numVisibleTriangles ) / f64( numSubmitted ) : 100.0 );
+            }
+        }
+        if ( benchmarkCfg.batchCellSize >= 0.0f ) {
+            const u32 numBatches = batchStaticNodes( scene, meshData, benchmarkCfg.batchCellSize, benchmarkCfg.batchAlphaTestedCellSize );
+            printf( "[Batching] cell size %.1f, alpha-tested %.1f: %u batches, %u meshes\n", benchmarkCfg.batchCellSize,
+                benchmarkCfg.batchAlphaTestedCellSize, numBatches, u32( meshData.meshes.size() ) );
+        }
+
+        recalculateGlobalTransforms( scene );
+        recalculateBoundingBoxes( meshData );
+        hlod.build( scene, meshData, {} );
+        hlod.save( cachedHLODFilename );
+
         recalculateBoundingBoxes( meshData );
         saveMeshData( cachedMeshesFilename, meshData );
         saveMeshDataMaterials( cachedMaterialsFilename, meshData );
         saveScene( cachedHierarchyFilename, scene );
+        saveBatching( cachedBatchingFilename, benchmarkCfg );
+
+        // derived from the old meshes, their own checks cannot tell
+        std::error_code ec;
+        std::filesystem::remove( cachedQuantizedMeshesFilename, ec );
+        std::filesystem::remove( cachedImpostorsFilename, ec );
+    }
+
+    // The quantized layout is derived from the float one, LOD generation and the bounding boxes need float positions
+    if ( benchmarkCfg.quantizedVertices && !isMeshDataValid(cachedQuantizedMeshesFilename) ) {
+        printf( "[INFO] No cached quantized mesh data found. Quantizing...\n" );
+
+        MeshData meshData;
+        loadMeshData( cachedMeshesFilename, meshData );
+        quantizeVertices( meshData );
+        saveMeshData( cachedQuantizedMeshesFilename, meshData );
     }
 
     MeshData meshData;
-    const MeshFileHeader header = loadMeshData( cachedMeshesFilename, meshData );
+    const char *meshesFilename  = benchmarkCfg.quantizedVertices ? cachedQuantizedMeshesFilename : cachedMeshesFilename;
+    const MeshFileHeader header = loadMeshData( meshesFilename, meshData );
     loadMeshDataMaterials( cachedMaterialsFilename, meshData );
 
+    // Caches written before the indices became relative to their mesh
+    if ( rebaseMeshIndices( meshData ) ) {
+        printf( "[INFO] Converting the cached mesh indices to per-mesh indices...\n" );
+        saveMeshData( meshesFilename, meshData );
+    }
+
+    {
+        const u32 vertexSize      = meshData.streams.getVertexSize();
+        const u32 floatVertexSize = sizeof(vec3) + sizeof(u32) + sizeof(u32); // see convertAIMesh()
+        const u64 numVertices     = meshData.vertexData.size() / vertexSize;
+        const f64 savedMB         = f64( numVertices * ( floatVertexSize - vertexSize ) ) / ( 1024.0 * 1024.0 );
+        printf( "[INFO] Vertex data: %u vertices, %.1f MB in %u-byte vertices, %.1f MB saved by the quantized layout\n",
+            u32( numVertices ), f64( meshData.vertexData.size() ) / ( 1024.0 * 1024.0 ), vertexSize, savedMB );
+        benchmarkCfg.vertexDataSize = meshData.vertexData.size();
+    }
+    // Selects the vertex inputs of VertexInput.sp
+    const char *vertexDefines = meshData.isQuantized() ? "#define QUANTIZED_VERTICES 1\n" : nullptr;
+    // The pipelines of VkMesh fetch their vertices themselves with --vertex-pulling, and have no vertex input state.
+    // The impostor bake and the triangle culling keep reading the layout of vertexDefines
+    const char            *meshVertexDefines = benchmarkCfg.vertexPulling ? "#define VERTEX_PULLING 1\n" : vertexDefines;
+    const lvk::VertexInput meshStreams       = benchmarkCfg.vertexPulling ? lvk::VertexInput {} : meshData.streams;
+    if ( benchmarkCfg.vertexPulling )
+        printf( "[INFO] Vertex pulling: %s vertices fetched from the vertex buffer in the vertex shaders\n",
+            meshData.isQuantized() ? "quantized" : "float" );
+
     Scene scene;
     loadScene( cachedHierarchyFilename, scene );
 
-    mr::App app = mr::App();
+    // Potentially visible sets of the view cells, baked on the CPU next to the mesh cache. --bake-pvs bakes them again and exits
+    mr::PVS pvs;
+    if ( benchmarkCfg.bakePVS || !pvs.load( cachedPVSFilename, scene, meshData ) ) {
+        pvs.bake( scene, meshData, hlod.getProxyNodes(), {} );
+        pvs.save( cachedPVSFilename );
+    }
+    if ( benchmarkCfg.bakePVS )
+        return 0;
+
+    // The CPU occlusion culling needs neither a device nor a window. Same grid of views as the batching report, every view is culled
+    // against the PVS and the frustum and goes through the HLOD selection first, like in simulate()
+    if ( benchmarkCfg.occlusionBenchmark ) {
+        std::vector<DrawNode> drawNodes;
+        std::vector<u32>      instanceForNode( scene.globalTransform.size(), ~0u );
+        for ( auto &p : scene.meshForNode ) {
+            instanceForNode[p.first] = u32( drawNodes.size() );
+            drawNodes.push_back({ .node = p.first, .mesh = p.second });
+        }
+        mr::OcclusionCuller culler( meshData, drawNodes, scene.globalTransform, {} );
+
+        std::vector<BoundingBox> boxes;
+        for ( const DrawNode &d : drawNodes ) {
+            boxes.push_back( meshData.boxes[d.mesh].getTransformed( scene.globalTransform[d.node] ) );
+        }
+        BoundingBox sceneBox = boxes.front();
+        for ( const BoundingBox &b : boxes ) {
+            sceneBox.combinePoint( b.min_ );
+            sceneBox.combinePoint( b.max_ );
+        }
+        const vec3 size = sceneBox.getSize();
+        const mat4 proj = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.01f * glm::length( size ), glm::length( size ) );
+
+        const u32 kRepetitions = 10;
+        std::vector<u32> inFrustum( drawNodes.size() ), visible( drawNodes.size() );
+        u64 numInFrustum = 0, numOccluded = 0, numTrianglesInFrustum = 0, numTrianglesOccluded = 0;
+        f64 rasterMs = 0.0, testMs = 0.0;
+        u32 numViews = 0;
+        for ( u32 i = 0; i != 9; i++ ) {
+            const vec3 eye = sceneBox.min_ + size * vec3( 0.25f + 0.25f * f32( i % 3 ), 0.05f, 0.25f + 0.25f * f32( i / 3 ) );
+            for ( u32 d = 0; d != 4; d++, numViews++ ) {
+                const f32  yaw      = glm::half_pi<f32>() * f32( d );
+                const mat4 viewProj = proj * glm::lookAt( eye, eye + vec3( cosf( yaw ), 0.0f, sinf( yaw ) ), vec3( 0, 1, 0 ) );
+                vec4 frustumPlanes[6];
+                getFrustumPlanes( viewProj, frustumPlanes );
+                vec4 frustumCorners[8];
+                getFrustumCorners( viewProj, frustumCorners );
+                std::fill( inFrustum.begin(), inFrustum.end(), 1u );
+                pvs.select( eye, instanceForNode, inFrustum.data() );
+                for ( u32 n = 0; n != drawNodes.size(); n++ ) {
+                    inFrustum[n] = inFrustum[n] && isBoxInFrustum( frustumPlanes, frustumCorners, boxes[n] ) ? 1 : 0;
+                }
+                if ( !hlod.empty() ) {
+                    hlod.select( true, eye, proj[1][1] * 0.5f * f32( benchmarkCfg.height ), instanceForNode, inFrustum.data() );
+                }
+
+                for ( u32 r = 0; r != kRepetitions; r++ ) {
+                    visible = inFrustum;
+                    const auto start = std::chrono::steady_clock::now();
+                    culler.renderOccluders( viewProj, scene.globalTransform, visible.data() );
+                    const auto rasterized = std::chrono::steady_clock::now();
+                    culler.cullInstances( boxes.data(), visible.data(), u32( drawNodes.size() ) );
+                    rasterMs += std::chrono::duration<f64, std::milli>( rasterized - start ).count();
+                    testMs   += std::chrono::duration<f64, std::milli>( std::chrono::steady_clock::now() - rasterized ).count();
+                }
+                for ( u32 n = 0; n != drawNodes.size(); n++ ) {
+                    const u64 numTriangles = meshData.meshes[drawNodes[n].mesh].getLODIndicesCount( 0 ) / 3;
+                    numInFrustum          += inFrustum[n];
+                    numTrianglesInFrustum += inFrustum[n] * numTriangles;
+                    numOccluded           += inFrustum[n] - visible[n];
+                    numTrianglesOccluded  += ( inFrustum[n] - visible[n] ) * numTriangles;
+                }
+            }
+        }
+        printf( "[Occlusion] %u occluders with %llu triangles, %ux%u depth buffer, %u threads\n", culler.getNumOccluders(),
+            (unsigned long long)culler.getNumOccluderTriangles(), mr::OcclusionCuller::kWidth, mr::OcclusionCuller::kHeight, culler.getNumThreads() );
+        printf( "[Occlusion] %u views: %.1f%% of the instances and %.1f%% of the triangles in the frustum occluded, "
+                "%.3f ms rasterization and %.3f ms tests per view\n", numViews,
+            numInFrustum ? 100.0 * f64( numOccluded ) / f64( numInFrustum ) : 0.0,
+            numTrianglesInFrustum ? 100.0 * f64( numTrianglesOccluded ) / f64( numTrianglesInFrustum ) : 0.0,
+            rasterMs / f64( numViews * kRepetitions ), testMs / f64( numViews * kRepetitions ) );
+        return 0;
+    }
+
+    mr::App app( mr::AppConfig {
+        .headless          = benchmarkCfg.enabled,
+        .softwareDevice    = benchmarkCfg.softwareDevice,
+        .width             = benchmarkCfg.width,
+        .height            = benchmarkCfg.height,
+        .fixedDeltaSeconds = benchmarkCfg.enabled ? benchmarkCfg.fixedDeltaSeconds : 0.0f
+    });
     app.fpsCounter.avgInterval_ = 0.25f;
     app.fpsCounter.printFPS_    = false;
 
@@ -73,40 +351,37 @@ int main( void ) {
     s32 selectedNode = -1, prevNumSamples = 1, numBlurPassesSSAO = 1, numBlurPassesBloom = 1;
     const lvk::Format kOffscreenFormat = lvk::Format_RGBA_F16;
 
-    const lvk::Dimensions fbSize        = ctx->getDimensions( ctx->getCurrentSwapchainTexture() );
-    const lvk::Dimensions offscreenSize = fbSize;
+    // Size of the swapchain and of all the render targets, they are recreated when the window is resized (see createRenderTargets()).
+    // With dynamic resolution the scene is rendered into the top left renderSize region of the targets and upscaled afterwards
+    lvk::Dimensions fbSize     = ctx->getDimensions( app.getPresentTexture() );
+    lvk::Dimensions renderSize = fbSize;
 
-    lvk::Holder<lvk::TextureHandle> msaaColor = ctx->createTexture({
-        .format     = kOffscreenFormat,
-        .dimensions = fbSize,
-        .numSamples = app._numSamples,
-        .usage      = lvk::TextureUsageBits_Attachment,
-        .storage    = lvk::StorageType_Memoryless,
-        .debugName  = "MSAA: Color"
-    });
-    lvk::Holder<lvk::TextureHandle> msaaDepth = ctx->createTexture({
-        .format     = app.getDepthFormat(),
-        .dimensions = fbSize,
-        .numSamples = app._numSamples,
-        .usage      = lvk::TextureUsageBits_Attachment,
-        .storage    = lvk::StorageType_Memoryless,
-        .debugName  = "MSAA: Depth"
-    });
+    lvk::Holder<lvk::TextureHandle> msaaColor, msaaDepth;
+    lvk::Holder<lvk::TextureHandle> offscreenColor, offscreenDepth;
+    const auto createMSAATargets = [&]() {
+        msaaColor = nullptr;
+        msaaDepth = nullptr;
 
-    lvk::Holder<lvk::TextureHandle> offscreenColor = ctx->createTexture({
-        .format     = kOffscreenFormat,
-        .dimensions = offscreenSize,
-        .usage      = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Storage | lvk::TextureUsageBits_Sampled,
-        .debugName  = "Buffer: offscreen color"
-    });
-    lvk::Holder<lvk::TextureHandle> offscreenDepth = ctx->createTexture({
-        .format     = app.getDepthFormat(),
-        .dimensions = offscreenSize,
-        .usage      = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Sampled,
-        .debugName  = "Buffer: offscreen depth"
-    });
+        msaaColor = ctx->createTexture({
+            .format     = kOffscreenFormat,
+            .dimensions = fbSize,
+            .numSamples = app._numSamples,
+            .usage      = lvk::TextureUsageBits_Attachment,
+            .storage    = lvk::StorageType_Memoryless,
+            .debugName  = "MSAA: Color"
+        });
+        msaaDepth = ctx->createTexture({
+            .format     = app.getDepthFormat(),
+            .dimensions = fbSize,
+            .numSamples = app._numSamples,
+            .usage      = lvk::TextureUsageBits_Attachment,
+            .storage    = lvk::StorageType_Memoryless,
+            .debugName  = "MSAA: Depth"
+        });
+    };
 
     LightParams light, prevLight = { .depthBiasConst = 0 };
+    u64 prevImpostorSelection = 0;
     lvk::Holder<lvk::TextureHandle> shadowMap = ctx->createTexture({
         .type       = lvk::TextureType_2D,
         .format     = lvk::Format_Z_UN16,
@@ -136,32 +411,58 @@ int main( void ) {
         lvk::TextureHandle textureIn;
         lvk::TextureHandle textureOut;
     };
-    std::vector<BlurPass> blurPassesSSAO( 2 * 5 );  // Maximum number of blur passes for SSAO is 5
-    std::vector<BlurPass> blurPassesBloom( 2 * 5 ); // Maximum number of blur passes for Bloom is 5
+    using BlurPasses = mr::FixedVector<BlurPass, 2 * 5>; // Maximum number of blur passes is 5
+    BlurPasses blurPassesSSAO, blurPassesBloom;
     lvk::Holder<lvk::ShaderModuleHandle> compBlur = loadShaderModule( ctx, "../../data/shaders/Blur.comp" );
     const u32 kHorizontal = 1, kVertical = 0;
-    lvk::Holder<lvk::ComputePipelineHandle> pipelineBlurX = ctx->createComputePipeline({
-        .smComp   = compBlur,
-        .specInfo = {
-            .entries = { {
-                .constantId = 0,
-                .size       = sizeof(u32)
-            } },
-            .data     = &kHorizontal,
-            .dataSize = sizeof(u32)
+    // Specialization constants of Blur.comp and Bloom.comp: kIsHorizontal (id 0) and kBlurKernel (id 1).
+    // The fused kernel ignores kIsHorizontal, so both of its pipelines do the same full 2D blur
+    struct BlurSpecInfo {
+        u32 isHorizontal;
+        u32 kernel;
+    };
+    BlurSpecInfo blurSpecInfo[mr::BlurKernel_Count][2];
+    for ( u32 k = 0; k != mr::BlurKernel_Count; ++k ) {
+        blurSpecInfo[k][kVertical]   = { .isHorizontal = kVertical,   .kernel = k };
+        blurSpecInfo[k][kHorizontal] = { .isHorizontal = kHorizontal, .kernel = k };
+    }
+    auto createBlurPipeline = [&ctx, &blurSpecInfo]( lvk::ShaderModuleHandle smComp, u32 kernel, u32 direction ) {
+        return ctx->createComputePipeline({
+            .smComp   = smComp,
+            .specInfo = {
+                .entries = {
+                    { .constantId = 0, .offset = offsetof(BlurSpecInfo, isHorizontal), .size = sizeof(u32) },
+                    { .constantId = 1, .offset = offsetof(BlurSpecInfo, kernel),       .size = sizeof(u32) }
+                },
+                .data     = &blurSpecInfo[kernel][direction],
+                .dataSize = sizeof(BlurSpecInfo)
+            }
+        });
+    };
+    lvk::Holder<lvk::ComputePipelineHandle> pipelineBlur[mr::BlurKernel_Count][2];
+    for ( u32 k = 0; k != mr::BlurKernel_Count; ++k ) {
+        pipelineBlur[k][kVertical]   = createBlurPipeline( compBlur, k, kVertical );
+        pipelineBlur[k][kHorizontal] = createBlurPipeline( compBlur, k, kHorizontal );
+    }
+    mr::BlurKernel blurKernelSSAO = mr::BlurKernel_SharedMemory, blurKernelBloom = mr::BlurKernel_SharedMemory;
+
+    // Separable kernels need a horizontal and a vertical dispatch per blur pass, the fused kernel does both in one.
+    // The passes ping-pong between two temporary textures and the last one writes into the destination texture.
+    // A fused dispatch reads neighbouring tiles, so it can never read and write the same texture
+    auto buildBlurPasses = []( BlurPasses &passes, s32 numBlurPasses, mr::BlurKernel kernel,
+                               lvk::TextureHandle src, lvk::TextureHandle dst, lvk::TextureHandle tmp0, lvk::TextureHandle tmp1 ) {
+        const lvk::TextureHandle tmp[] = { tmp0, tmp1 };
+        const s32 numDispatches = kernel == mr::BlurKernel_SharedMemoryFused
+            ? std::max( numBlurPasses, src == dst ? 2 : 1 )
+            : 2 * numBlurPasses;
+        passes.clear();
+        for ( s32 i = 0; i != numDispatches; ++i ) {
+            passes.push_back({
+                .textureIn  = i == 0                 ? src : tmp[(i - 1) & 1],
+                .textureOut = i == numDispatches - 1 ? dst : tmp[i & 1]
+            });
         }
-    });
-    lvk::Holder<lvk::ComputePipelineHandle> pipelineBlurY = ctx->createComputePipeline({
-        .smComp   = compBlur,
-        .specInfo = {
-            .entries = { {
-                .constantId = 0,
-                .size       = sizeof(u32)
-            } },
-            .data     = &kVertical,
-            .dataSize = sizeof(u32)
-        } 
-    });
+    };
 
     lvk::Holder<lvk::ShaderModuleHandle> vertCombine = loadShaderModule( ctx, "../../data/shaders/QuadFlip.vert" );
     lvk::Holder<lvk::ShaderModuleHandle> fragCombine = loadShaderModule( ctx, "../shaders/combine.frag" );
@@ -171,26 +472,8 @@ int main( void ) {
         .color  = {{ .format = kOffscreenFormat }}
     });
 
-    lvk::Holder<lvk::TextureHandle> textureSSAO = ctx->createTexture({
-        .format     = ctx->getSwapchainFormat(),
-        .dimensions = fbSize,
-        .usage      = lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
-        .debugName  = "Texture SSAO"
-    });
-    lvk::Holder<lvk::TextureHandle> textureBlur[] = {
-        ctx->createTexture({
-            .format     = ctx->getSwapchainFormat(),
-            .dimensions = fbSize,
-            .usage      = lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
-            .debugName  = "Texture Blur 0"
-        }),
-        ctx->createTexture({
-            .format     = ctx->getSwapchainFormat(),
-            .dimensions = fbSize,
-            .usage      = lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
-            .debugName  = "Texture Blur 1"
-        })
-    };
+    lvk::Holder<lvk::TextureHandle> textureSSAO;
+    lvk::Holder<lvk::TextureHandle> textureBlur[2];
 
     lvk::Holder<lvk::TextureHandle> textureRot   = loadTexture( ctx, "../../data/rot_texture.bmp" );
     lvk::Holder<lvk::SamplerHandle> samplerClamp = ctx->createSampler({
@@ -199,10 +482,9 @@ int main( void ) {
         .wrapW = lvk::SamplerWrap_Clamp
     });
 
+    // Texture indices of the render targets are set by createRenderTargets()
     struct SSAOpc ssaoPC {
-        .textureDepth = offscreenDepth.index(),
         .textureRot   = textureRot.index(),
-        .textureOut   = textureSSAO.index(),
         .sampler      = samplerClamp.index(),
         .zNear        = 0.01f,
         .zFar         = 1000.0f,
@@ -212,8 +494,6 @@ int main( void ) {
     };
 
     struct CombinePC combinePC {
-        .textureColor = offscreenColor.index(),
-        .textureSSAO  = textureSSAO.index(),
         .sampler      = samplerClamp.index(),
         .scale        = 1.5f,
         .bias         = 0.16f
@@ -223,30 +503,49 @@ int main( void ) {
     lvk::Holder<lvk::ComputePipelineHandle> pipelineBrightPass = ctx->createComputePipeline( { .smComp = compBrightPass } );
     
     lvk::Holder<lvk::ShaderModuleHandle> compBloomPass = loadShaderModule( ctx, "../shaders/Bloom.comp" );
-    lvk::Holder<lvk::ComputePipelineHandle> pipelineBloomX = ctx->createComputePipeline({
-        .smComp   = compBloomPass,
-        .specInfo = {
-            .entries = {{ .constantId = 0, .size = sizeof(u32) }},
-            .data     = &kHorizontal,
-            .dataSize = sizeof(u32)
-        }
-    });
-    lvk::Holder<lvk::ComputePipelineHandle> pipelineBloomY = ctx->createComputePipeline({
-        .smComp   = compBloomPass,
-        .specInfo = {
-            .entries = {{ .constantId = 0, .size = sizeof(u32) }},
-            .data     = &kVertical,
-            .dataSize = sizeof(u32)
-        }
-    });
+    lvk::Holder<lvk::ComputePipelineHandle> pipelineBloom[mr::BlurKernel_Count][2];
+    for ( u32 k = 0; k != mr::BlurKernel_Count; ++k ) {
+        pipelineBloom[k][kVertical]   = createBlurPipeline( compBloomPass, k, kVertical );
+        pipelineBloom[k][kHorizontal] = createBlurPipeline( compBloomPass, k, kHorizontal );
+    }
 
     lvk::Holder<lvk::ShaderModuleHandle> vertToneMap = loadShaderModule( ctx, "../../data/shaders/QuadFlip.vert" );
     lvk::Holder<lvk::ShaderModuleHandle> fragToneMap = loadShaderModule( ctx, "../shaders/ToneMap.frag" );
     lvk::Holder<lvk::RenderPipelineHandle> pipelineToneMap = ctx->createRenderPipeline({
         .smVert = vertToneMap,
         .smFrag = fragToneMap,
-        .color  = { { .format = ctx->getSwapchainFormat() } },
+        .color  = { { .format = app.getPresentFormat() } },
     });
+
+    // Fused post-processing: one pipeline per tone mapping operator, with and without SSAO. A fullscreen triangle that renders straight
+    // into the present texture, swapchain images cannot be storage images
+    lvk::Holder<lvk::ShaderModuleHandle> fragPostProcess = loadShaderModule( ctx, "../shaders/PostProcess.frag" );
+    const u32 kNumToneMappingModes = mr::RendererOption::ToneMappingKhronosPBR - mr::RendererOption::ToneMappingNone + 1;
+    struct PostProcessSpecInfo {
+        u32 toneMappingMode;
+        u32 ssao;
+    };
+    PostProcessSpecInfo postProcessSpecInfo[kNumToneMappingModes][2];
+    lvk::Holder<lvk::RenderPipelineHandle> pipelinePostProcess[kNumToneMappingModes][2];
+    for ( u32 mode = 0; mode != kNumToneMappingModes; ++mode ) {
+        for ( u32 ssao = 0; ssao != 2; ++ssao ) {
+            postProcessSpecInfo[mode][ssao] = { .toneMappingMode = mode, .ssao = ssao };
+            pipelinePostProcess[mode][ssao] = ctx->createRenderPipeline({
+                .smVert   = vertToneMap,
+                .smFrag   = fragPostProcess,
+                .specInfo = {
+                    .entries = {
+                        { .constantId = 0, .offset = offsetof(PostProcessSpecInfo, toneMappingMode), .size = sizeof(u32) },
+                        { .constantId = 1, .offset = offsetof(PostProcessSpecInfo, ssao),            .size = sizeof(u32) }
+                    },
+                    .data     = &postProcessSpecInfo[mode][ssao],
+                    .dataSize = sizeof(PostProcessSpecInfo)
+                },
+                .color    = { { .format = app.getPresentFormat() } },
+            });
+        }
+    }
+
     const lvk::Dimensions sizeBloom = { 512, 512 };
     lvk::Holder<lvk::TextureHandle> texBrightPass = ctx->createTexture({
         .format     = kOffscreenFormat,
@@ -261,20 +560,19 @@ int main( void ) {
         .debugName  = "Texture: Bloom Pass"
     });
 
-    const lvk::ComponentMapping swizzle = { .r = lvk::Swizzle_R, .g = lvk::Swizzle_R, .b = lvk::Swizzle_R, .a = lvk::Swizzle_1 };
-    lvk::Holder<lvk::TextureHandle> texLumViews[10] = {
-        ctx->createTexture({
-            .format       = lvk::Format_R_F16,
-            .dimensions   = sizeBloom,
-            .usage        = lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
-            .numMipLevels = lvk::calcNumMipLevels( sizeBloom.width, sizeBloom.height ),
-            .swizzle      = swizzle,
-            .debugName    = "Texture: Luminance"
-        })
+    // Log-average luminance and its temporally adapted value, see Luminance.comp for the layout.
+    // Every workgroup covers 64x64 texels of the offscreen buffer and writes one partial sum
+    lvk::Dimensions luminanceGroups;
+    const struct {
+        f32 adaptedLuminance = 1.0f;
+        u32 numGroupsDone    = 0;
+    } luminanceInit;
+    lvk::Holder<lvk::BufferHandle> bufferLuminance;
+    lvk::Holder<lvk::ShaderModuleHandle> compLuminance = loadShaderModule( ctx, "../shaders/Luminance.comp" );
+    lvk::Holder<lvk::ComputePipelineHandle> pipelineLuminance = ctx->createComputePipeline( { .smComp = compLuminance } );
+    LuminancePC pcLuminance = {
+        .sampler = samplerClamp.index()
     };
-    for ( u32 v = 1; v != LVK_ARRAY_NUM_ELEMENTS( texLumViews ); ++v ) {
-        texLumViews[v] = ctx->createTextureView( texLumViews[0], { .mipLevel = v, .swizzle = swizzle } );
-    }
 
     lvk::Holder<lvk::TextureHandle> texBloom[] = {
         ctx->createTexture({
@@ -290,21 +588,325 @@ int main( void ) {
             .debugName  = "Texture: Bloom 1"
         }),
     };
+    // Mip-chain bloom: both chains start at half the offscreen resolution, so the image keeps its aspect ratio
+    // and the cost scales with log(resolution) instead of with the number of blur passes
+    lvk::Dimensions sizeBloomChain;
+    const u32 kMaxBloomMips = 8;
+    BloomParams bloomParams;
+    lvk::Holder<lvk::TextureHandle> texBloomDown[kMaxBloomMips];
+    lvk::Holder<lvk::TextureHandle> texBloomUp[kMaxBloomMips];
+    auto bloomMipSize = [&sizeBloomChain]( u32 mip ) {
+        return lvk::Dimensions {
+            .width  = std::max( sizeBloomChain.width  >> mip, 1u ),
+            .height = std::max( sizeBloomChain.height >> mip, 1u )
+        };
+    };
+
+    lvk::Holder<lvk::ShaderModuleHandle> compBloomDownsample = loadShaderModule( ctx, "../shaders/BloomDownsample.comp" );
+    lvk::Holder<lvk::ShaderModuleHandle> compBloomUpsample   = loadShaderModule( ctx, "../shaders/BloomUpsample.comp" );
+    const u32 kIsFirstPass = 1, kIsNotFirstPass = 0;
+    lvk::Holder<lvk::ComputePipelineHandle> pipelineBloomPrefilter = ctx->createComputePipeline({
+        .smComp   = compBloomDownsample,
+        .specInfo = {
+            .entries = {{ .constantId = 0, .size = sizeof(u32) }},
+            .data     = &kIsFirstPass,
+            .dataSize = sizeof(u32)
+        }
+    });
+    lvk::Holder<lvk::ComputePipelineHandle> pipelineBloomDownsample = ctx->createComputePipeline({
+        .smComp   = compBloomDownsample,
+        .specInfo = {
+            .entries = {{ .constantId = 0, .size = sizeof(u32) }},
+            .data     = &kIsNotFirstPass,
+            .dataSize = sizeof(u32)
+        }
+    });
+    lvk::Holder<lvk::ComputePipelineHandle> pipelineBloomUpsample = ctx->createComputePipeline( { .smComp = compBloomUpsample } );
+
     struct ToneMapPC pcHDR = {
-        .texColor     = offscreenColor.index(),
-        .texLuminance = texLumViews[LVK_ARRAY_NUM_ELEMENTS(texLumViews) - 1].index(),
-        .texBloom     = texBloomPass.index(),
-        .sampler      = samplerClamp.index(),
-        .tonemapMode  = 1
+        .texBloom        = texBloomPass.index(),
+        .sampler         = samplerClamp.index(),
+        .tonemapMode     = 1
+    };
+
+    // Dynamic resolution: edge-adaptive upsample of the rendered region and a sharpening pass, see Upscale.comp
+    mr::DynamicResolution dynamicResolution;
+    lvk::Holder<lvk::TextureHandle> texUpscaled;
+    lvk::Holder<lvk::ShaderModuleHandle> compUpscale = loadShaderModule( ctx, "../shaders/Upscale.comp" );
+    struct UpscaleSpecInfo {
+        u32 pass;
+        u32 ssao;
+    };
+    const u32 kUpscalePass_Upsample = 0, kUpscalePass_Sharpen = 1;
+    const UpscaleSpecInfo upscaleSpecInfo[] = {
+        { .pass = kUpscalePass_Upsample, .ssao = 0 },
+        { .pass = kUpscalePass_Upsample, .ssao = 1 },
+        { .pass = kUpscalePass_Sharpen,  .ssao = 0 }
+    };
+    lvk::Holder<lvk::ComputePipelineHandle> pipelineUpscale[LVK_ARRAY_NUM_ELEMENTS(upscaleSpecInfo)];
+    for ( u32 i = 0; i != LVK_ARRAY_NUM_ELEMENTS(upscaleSpecInfo); ++i ) {
+        pipelineUpscale[i] = ctx->createComputePipeline({
+            .smComp   = compUpscale,
+            .specInfo = {
+                .entries = {
+                    { .constantId = 0, .offset = offsetof(UpscaleSpecInfo, pass), .size = sizeof(u32) },
+                    { .constantId = 1, .offset = offsetof(UpscaleSpecInfo, ssao), .size = sizeof(u32) }
+                },
+                .data     = &upscaleSpecInfo[i],
+                .dataSize = sizeof(UpscaleSpecInfo)
+            }
+        });
+    }
+
+    // Temporal anti-aliasing: jittered projection, motion vectors and a resolve into ping-pong history textures, see TAA.comp.
+    // The motion vectors pass and its draw commands are set up along with the mesh
+    mr::TemporalAA temporalAA;
+    lvk::Holder<lvk::TextureHandle> texVelocity;
+    lvk::Holder<lvk::TextureHandle> texHistory[2];
+    lvk::Holder<lvk::ShaderModuleHandle> compTAA = loadShaderModule( ctx, "../shaders/TAA.comp" );
+    lvk::Holder<lvk::ComputePipelineHandle> pipelineTAA = ctx->createComputePipeline( { .smComp = compTAA } );
+    lvk::Holder<lvk::BufferHandle> bufferMotion = ctx->createBuffer({
+        .usage     = lvk::BufferUsageBits_Storage,
+        .storage   = lvk::StorageType_Device,
+        .size      = sizeof(MotionData),
+        .debugName = "Buffer: motion"
+    });
+
+    // Everything that depends on the framebuffer size, called again when the window is resized.
+    // The texture indices in the push constants are updated along with the textures
+    const auto createRenderTargets = [&]( const lvk::Dimensions &size ) {
+        fbSize = size;
+        createMSAATargets();
+
+        offscreenColor = ctx->createTexture({
+            .format     = kOffscreenFormat,
+            .dimensions = fbSize,
+            .usage      = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Storage | lvk::TextureUsageBits_Sampled,
+            .debugName  = "Buffer: offscreen color"
+        });
+        offscreenDepth = ctx->createTexture({
+            .format     = app.getDepthFormat(),
+            .dimensions = fbSize,
+            .usage      = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Sampled,
+            .debugName  = "Buffer: offscreen depth"
+        });
+        texUpscaled = ctx->createTexture({
+            .format     = kOffscreenFormat,
+            .dimensions = fbSize,
+            .usage      = lvk::TextureUsageBits_Storage | lvk::TextureUsageBits_Sampled,
+            .debugName  = "Buffer: upscaled color"
+        });
+        texVelocity = ctx->createTexture({
+            .format     = kOffscreenFormat,
+            .dimensions = fbSize,
+            .usage      = lvk::TextureUsageBits_Attachment | lvk::TextureUsageBits_Sampled,
+            .debugName  = "Buffer: velocity"
+        });
+        for ( u32 i = 0; i != LVK_ARRAY_NUM_ELEMENTS(texHistory); ++i ) {
+            texHistory[i] = ctx->createTexture({
+                .format     = kOffscreenFormat,
+                .dimensions = fbSize,
+                .usage      = lvk::TextureUsageBits_Storage | lvk::TextureUsageBits_Sampled,
+                .debugName  = i ? "Buffer: TAA history 1" : "Buffer: TAA history 0"
+            });
+        }
+        temporalAA.invalidateHistory();
+
+        textureSSAO = ctx->createTexture({
+            .format     = app.getPresentFormat(),
+            .dimensions = fbSize,
+            .usage      = lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
+            .debugName  = "Texture SSAO"
+        });
+        for ( u32 i = 0; i != LVK_ARRAY_NUM_ELEMENTS(textureBlur); ++i ) {
+            textureBlur[i] = ctx->createTexture({
+                .format     = app.getPresentFormat(),
+                .dimensions = fbSize,
+                .usage      = lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
+                .debugName  = i ? "Texture Blur 1" : "Texture Blur 0"
+            });
+        }
+        luminanceGroups = {
+            .width  = (fbSize.width  + 63) / 64,
+            .height = (fbSize.height + 63) / 64
+        };
+        // the header followed by zeroed partial sums, createBuffer() copies the whole size
+        std::vector<u8> luminanceData( sizeof(luminanceInit) + sizeof(vec2) * luminanceGroups.width * luminanceGroups.height, 0 );
+        memcpy( luminanceData.data(), &luminanceInit, sizeof(luminanceInit) );
+        bufferLuminance = ctx->createBuffer({
+            .usage     = lvk::BufferUsageBits_Storage,
+            .storage   = lvk::StorageType_Device,
+            .size      = luminanceData.size(),
+            .data      = luminanceData.data(),
+            .debugName = "Buffer: luminance"
+        });
+
+        sizeBloomChain      = { .width = std::max( fbSize.width / 2, 1u ), .height = std::max( fbSize.height / 2, 1u ) };
+        bloomParams.maxMips = std::min( lvk::calcNumMipLevels( sizeBloomChain.width, sizeBloomChain.height ), kMaxBloomMips );
+        bloomParams.numMips = std::min( bloomParams.numMips, bloomParams.maxMips );
+        for ( u32 v = kMaxBloomMips; v-- > 0; ) { // views first
+            texBloomDown[v] = nullptr;
+            texBloomUp[v]   = nullptr;
+        }
+        texBloomDown[0] = ctx->createTexture({
+            .format       = kOffscreenFormat,
+            .dimensions   = sizeBloomChain,
+            .usage        = lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
+            .numMipLevels = (u32)bloomParams.maxMips,
+            .debugName    = "Texture: Bloom Downsample Chain"
+        });
+        texBloomUp[0] = ctx->createTexture({
+            .format       = kOffscreenFormat,
+            .dimensions   = sizeBloomChain,
+            .usage        = lvk::TextureUsageBits_Sampled | lvk::TextureUsageBits_Storage,
+            .numMipLevels = (u32)bloomParams.maxMips,
+            .debugName    = "Texture: Bloom Upsample Chain"
+        });
+        for ( u32 v = 1; v != (u32)bloomParams.maxMips; ++v ) {
+            texBloomDown[v] = ctx->createTextureView( texBloomDown[0], { .mipLevel = v } );
+            texBloomUp[v]   = ctx->createTextureView( texBloomUp[0],   { .mipLevel = v } );
+        }
+
+        ssaoPC.textureDepth          = offscreenDepth.index();
+        ssaoPC.textureOut            = textureSSAO.index();
+        combinePC.textureColor       = offscreenColor.index();
+        combinePC.textureSSAO        = textureSSAO.index();
+        pcLuminance.bufferLuminance  = ctx->gpuAddress( bufferLuminance );
+        pcLuminance.texColor         = offscreenColor.index();
+        pcHDR.bufferLuminance        = ctx->gpuAddress( bufferLuminance );
+        pcHDR.texColor               = offscreenColor.index();
     };
+    createRenderTargets( fbSize );
 
-    const VkMesh mesh( ctx, meshData, scene, lvk::StorageType_HostVisible );
-    Pipeline shadowPipeline( ctx, meshData.streams, lvk::Format_Invalid, ctx->getFormat(shadowMap), 1,
-        loadShaderModule( ctx, "../shaders/shadow.vert"),
+    mr::GPUProfiler profiler( *ctx );
+    mr::Benchmark   benchmark( benchmarkCfg );
+
+    // Level 0 of every factor is the baseline
+    const auto selectOption = [&app]( mr::RendererOption first, mr::RendererOption last, mr::RendererOption selected ) {
+        for ( u32 i = first; i <= last; ++i )
+            app.options[i] = i == selected;
+    };
+    const mr::RendererOption kSweepAA[] = { mr::RendererOption::NoAA, mr::RendererOption::MSAAx2, mr::RendererOption::MSAAx4, mr::RendererOption::MSAAx8,
+                                            mr::RendererOption::MSAAx16, mr::RendererOption::TAA };
+    std::unique_ptr<mr::OptionSweep> sweep;
+    if ( benchmarkCfg.sweepFactors ) {
+        sweep = std::make_unique<mr::OptionSweep>( std::vector<mr::SweepFactor> {
+            { "aa",               [&]( u32 level ) { selectOption( mr::RendererOption::NoAA, mr::RendererOption::TAA, kSweepAA[level] ); },
+                                  { "off", "msaa2x", "msaa4x", "msaa8x", "msaa16x", "taa" } },
+            { "ssao",             [&]( u32 on ) { app.options[mr::RendererOption::SSAO] = on; } },
+            { "ssao-blur",        [&]( u32 on ) { app.options[mr::RendererOption::BlurSSAO] = on; } },
+            { "ssao-blur-passes", [&]( u32 on ) { numBlurPassesSSAO = on ? 4 : 1; } },
+            { "blur-kernel",      [&]( u32 level ) { blurKernelSSAO = blurKernelBloom = mr::BlurKernel( level ); },
+                                  { "reference", "linear", "shared", "fused" } },
+            { "bloom",            [&]( u32 on ) { app.options[mr::RendererOption::Bloom] = on; } },
+            { "bloom-mip-chain",  [&]( u32 on ) { bloomParams.mipChain = on; } },
+            { "fused-post",       [&]( u32 on ) { app.options[mr::RendererOption::FusedPostProcess] = on; } },
+            { "tonemap",          [&]( u32 on ) { selectOption( mr::RendererOption::ToneMappingNone, mr::RendererOption::ToneMappingKhronosPBR,
+                                                      on ? mr::RendererOption::ToneMappingKhronosPBR : mr::RendererOption::ToneMappingNone ); } },
+            { "culling-cpu",      [&]( u32 on ) { selectOption( mr::RendererOption::CullingNone, mr::RendererOption::CullingGPU,
+                                                      on ? mr::RendererOption::CullingCPU : mr::RendererOption::CullingNone ); } },
+            { "pipelined-sim",    [&]( u32 on ) { app.options[mr::RendererOption::PipelinedSimulation] = on; } },
+            { "hlod",             [&]( u32 on ) { app.options[mr::RendererOption::HLODProxies] = on; } },
+            { "impostors",        [&]( u32 on ) { app.options[mr::RendererOption::TreeImpostors] = on; } },
+            { "occlusion",        [&]( u32 on ) { app.options[mr::RendererOption::OcclusionCulling] = on; } },
+            { "pvs",              [&]( u32 on ) { app.options[mr::RendererOption::PVSCulling] = on; } },
+            { "triangle-culling", [&]( u32 on ) { app.options[mr::RendererOption::TriangleCulling] = on; } },
+        }, benchmarkCfg.sweepFactors, benchmark.getCameraPositioner(), benchmarkCfg.sweepViewpoints, benchmarkCfg.sweepSettleFrames, benchmarkCfg.sweepMeasuredFrames,
+            benchmarkCfg.sweepPass );
+        if ( !sweep->isValid() ) {
+            app.requestExit();
+        }
+    }
+
+    mr::CameraPathRecorder cameraRecorder;
+    mr::CameraPathPlayback cameraPlayback;
+    CameraPositioner_Path  cameraPathPlayer;
+
+    const VkMesh mesh( ctx, meshData, scene, lvk::StorageType_Device, benchmarkCfg.vertexPulling );
+    Pipeline shadowPipeline( ctx, meshStreams, lvk::Format_Invalid, ctx->getFormat(shadowMap), 1,
+        loadShaderModule( ctx, "../shaders/shadow.vert", meshVertexDefines ),
         loadShaderModule( ctx, "../shaders/shadow.frag"), lvk::CullMode_None); // Experiment with backface culling here, it seems it makes no difference for bistro
-    Pipeline *opaquePipeline = new Pipeline( ctx, meshData.streams, kOffscreenFormat, app.getDepthFormat(), app._numSamples,
-        loadShaderModule( ctx, "../shaders/main.vert" ),
+    Pipeline *opaquePipeline = new Pipeline( ctx, meshStreams, kOffscreenFormat, app.getDepthFormat(), app._numSamples,
+        loadShaderModule( ctx, "../shaders/main.vert", meshVertexDefines ),
         loadShaderModule( ctx, "../shaders/main.frag" ), lvk::CullMode_Back );
+    // invariant gl_Position: the same vertex fetch as main.vert
+    Pipeline velocityPipeline( ctx, meshStreams, kOffscreenFormat, app.getDepthFormat(), 1,
+        loadShaderModule( ctx, "../shaders/Velocity.vert", meshVertexDefines ),
+        loadShaderModule( ctx, "../shaders/Velocity.frag" ), lvk::CullMode_Back );
+
+    {
+        const f64 indexMB   = f64( mesh.indexDataSize16_ + mesh.indexDataSize32_ ) / ( 1024.0 * 1024.0 );
+        const f64 index32MB = f64( meshData.indexData.size() * sizeof(u32) ) / ( 1024.0 * 1024.0 );
+        if ( mesh.vertexPulling_ ) {
+            printf( "[INFO] Index data: %u draws in one cmdDrawIndexedIndirectCount from the 32-bit index buffer, %.1f MB with the 16-bit copy\n",
+                u32( mesh.bufferIndirect_._drawCommands.size() ), indexMB );
+        } else {
+            printf( "[INFO] Index data: %u of %u draws use 16-bit indices, %.1f MB, %.1f MB saved by the 16-bit index buffer\n",
+                mesh.numCommands16_, u32( mesh.bufferIndirect_._drawCommands.size() ), indexMB, index32MB - indexMB );
+        }
+        printf( "[INFO] Draws: %u instanced draw commands for %u nodes, vertex and index data: %.1f MB, mesh cache: %.1f MB\n",
+            u32( mesh.bufferIndirect_._drawCommands.size() ), u32( mesh.drawNodes_.size() ),
+            f64( meshData.vertexData.size() + mesh.indexDataSize16_ + mesh.indexDataSize32_ ) / ( 1024.0 * 1024.0 ),
+            f64( std::filesystem::file_size( meshesFilename ) ) / ( 1024.0 * 1024.0 ) );
+    }
+
+    // Baked before the first frame, cullInstances() reorders the DrawData read by the bake
+    mr::Impostors impostors( ctx, meshData, mesh.drawNodes_ );
+    if ( !impostors.load( cachedImpostorsFilename ) ) {
+        impostors.bake({
+            .streams            = meshData.streams,
+            .vertexDefines      = vertexDefines,
+            .bufferDrawData     = ctx->gpuAddress( mesh.bufferDrawData_ ),
+            .bufferMaterials    = ctx->gpuAddress( mesh.bufferMaterials_ ),
+            .bufferVertexBounds = ctx->gpuAddress( mesh.bufferVertexBounds_ ),
+            .drawMesh           = [&mesh]( lvk::ICommandBuffer &buf, u32 m ) { mesh.drawMesh( buf, m ); }
+        });
+        impostors.save( cachedImpostorsFilename );
+    }
+    impostors.createPipelines( kOffscreenFormat, app.getDepthFormat(), app._numSamples, ctx->getFormat( shadowMap ) );
+    if ( !impostors.empty() ) {
+        printf( "[Impostors] %u meshes with %u instances and %llu triangles, %ux%u atlases\n", impostors.getNumMeshes(),
+            impostors.getNumCandidateInstances(), (unsigned long long)impostors.getNumTriangles(), impostors.getAtlasSize(), impostors.getAtlasSize() );
+    }
+
+    // The triangles of the biggest meshes, the static batches, are culled on the GPU before the shadow and the main pass.
+    // A draw command of VkMesh draws LOD 0 of its mesh
+    mr::TriangleCuller::MeshInputs triangleCullInputs = {
+        .vertices         = mesh.bufferVertices_,
+        .indices16        = mesh.bufferIndices16_,
+        .indices32        = mesh.bufferIndices_,
+        .bufferTransforms = ctx->gpuAddress( mesh.bufferTransforms_ ),
+        .vertexSize       = meshData.streams.getVertexSize(),
+        .vertexDefines    = vertexDefines,
+        .meshDraws        = std::vector<mr::TriangleCuller::MeshDraw>( mesh.numMeshes_ )
+    };
+    for ( u32 i = 0; i != mesh.bufferIndirect_._drawCommands.size(); ++i ) {
+        const DrawIndexedIndirectCommand &c = mesh.bufferIndirect_._drawCommands[i];
+        triangleCullInputs.meshDraws[mesh.drawNodes_[c.baseInstance].mesh] = {
+            .firstIndex = c.firstIndex,
+            .numIndices = c.count,
+            .baseVertex = c.baseVertex,
+            .indices16  = i < mesh.numCommands16_
+        };
+    }
+    mr::TriangleCuller triangleCuller( ctx, meshData, mesh.drawNodes_, triangleCullInputs, {} );
+    if ( !triangleCuller.empty() ) {
+        printf( "[TriangleCulling] %u meshes with %u instances and %llu triangles, up to %u triangles per pass\n", triangleCuller.getNumMeshes(),
+            triangleCuller.getNumCandidateInstances(), (unsigned long long)triangleCuller.getNumTriangles(), triangleCuller.getMaxTriangles() );
+    }
+
+    // Object motion for TAA: the transforms rendered in the previous frame and the draw commands of the nodes that moved since then.
+    // A draw command of VkMesh draws the instances mesh.drawNodes_[baseInstance, baseInstance + instanceCount)
+    std::vector<mat4> prevGlobalTransforms = scene.globalTransform;
+    lvk::Holder<lvk::BufferHandle> bufferPrevTransforms = ctx->createBuffer({
+        .usage     = lvk::BufferUsageBits_Storage,
+        .storage   = lvk::StorageType_Device,
+        .size      = scene.globalTransform.size() * sizeof(mat4),
+        .data      = scene.globalTransform.data(),
+        .debugName = "Buffer: previous transforms"
+    });
+    IndirectBuffer movedIndirect( ctx, mesh.numMeshes_ );
+    mesh.bufferIndirect_.selectTo( movedIndirect, []( const DrawIndexedIndirectCommand& ) { return false; } );
 
     std::vector<BoundingBox> reorderedBoxes;
     reorderedBoxes.resize( scene.globalTransform.size() );
@@ -322,54 +924,266 @@ int main( void ) {
                                  0.0, 0.0, 1.0, 0.0,
                                  0.5, 0.5, 0.0, 1.0 );
 
-    app.run( [&]( uint32_t width, uint32_t height, float aspectRatio, float deltaSeconds ) {
-        const mat4 view = app.camera.getViewMatrix();
-        const mat4 proj = glm::perspective( 45.0f, aspectRatio, ssaoPC.zNear, ssaoPC.zFar );
+    // The PVS, HLOD, impostor and triangle culling selections switch instances of VkMesh on and off like the CPU culling
+    const bool selectsInstances = !pvs.empty() || !hlod.empty() || !impostors.empty() || !triangleCuller.empty();
+    std::vector<u32> instanceForNode( scene.globalTransform.size(), ~0u );
+    for ( u32 i = 0; i != mesh.drawNodes_.size(); ++i ) {
+        instanceForNode[mesh.drawNodes_[i].node] = i;
+    }
+
+    mr::OcclusionCuller occlusionCuller( meshData, mesh.drawNodes_, scene.globalTransform, {} );
+    printf( "[Occlusion] %u occluders with %llu triangles, %ux%u depth buffer, %u threads\n", occlusionCuller.getNumOccluders(),
+        (unsigned long long)occlusionCuller.getNumOccluderTriangles(), mr::OcclusionCuller::kWidth, mr::OcclusionCuller::kHeight,
+        occlusionCuller.getNumThreads() );
+
+    bool wasCullingCPU     = false;
+    u64 numTrianglesTotal = 0;
+    for ( auto &p : scene.meshForNode ) {
+        numTrianglesTotal += meshData.meshes[p.second].getLODIndicesCount( 0 ) / 3;
+    }
 
-        if ( app.options[mr::RendererOption::CullingCPU] ) {
+    // Transforms, culling and light matrices of a frame. Owns the scene transforms while it runs, the edits of the UI are applied after
+    // wait(), and only writes the frame state, so it can run on the simulation thread while the previous frame is recorded
+    u64 numTransformUpdates = 0;
+    const auto simulate = [&]( mr::FrameState &state ) {
+        const auto simulationStart = std::chrono::steady_clock::now();
+
+        if ( recalculateGlobalTransforms( scene ) ) {
+            numTransformUpdates++;
+        }
+        // Same size, no allocation
+        if ( state.transformsVersion != numTransformUpdates ) {
+            state.globalTransforms  = scene.globalTransform;
+            state.transformsVersion = numTransformUpdates;
+        }
+
+        state.numVisibleMeshes    = u32( mesh.drawNodes_.size() );
+        state.numVisibleTriangles = numTrianglesTotal;
+        if ( state.cullingCPU || selectsInstances ) {
             vec4 frustumPlanes[6];
-            getFrustumPlanes( proj * view, frustumPlanes );
+            getFrustumPlanes( state.proj * state.view, frustumPlanes );
             vec4 frustumCorners[8];
-            getFrustumCorners( proj * view, frustumCorners );
-
-            s32 numVisibleMeshes = 0;
-            {
-                DrawIndexedIndirectCommand *cmd = mesh.getDrawIndexedIndirectCommand();
-                for ( auto &p : scene.meshForNode ) {
-                    const BoundingBox box  = meshData.boxes[p.second].getTransformed( scene.globalTransform[p.first] );
-                    const u32 count        = isBoxInFrustum( frustumPlanes, frustumCorners, box ) ? 1 : 0;
-                    (cmd++)->instanceCount = count;
-                    numVisibleMeshes      += count;
-                }
-                // Flush changes to the GPU
-                ctx->flushMappedMemory( mesh.bufferIndirect_._bufferIndirect, 0, mesh.numMeshes_ * sizeof(DrawIndexedIndirectCommand) );
+            getFrustumCorners( state.proj * state.view, frustumCorners );
+
+            const vec3 cameraPos = vec3( glm::inverse( state.view )[3] );
+            // The set of the camera cell before the frustum, which then only tests what is left
+            std::fill( state.instanceCounts.begin(), state.instanceCounts.end(), 1u );
+            if ( state.pvs ) {
+                pvs.select( cameraPos, instanceForNode, state.instanceCounts.data() );
+            }
+            for ( u32 i = 0; i != mesh.drawNodes_.size(); ++i ) {
+                if ( !state.instanceCounts[i] )
+                    continue;
+                const DrawNode &d       = mesh.drawNodes_[i];
+                state.instanceBoxes[i]  = meshData.boxes[d.mesh].getTransformed( scene.globalTransform[d.node] );
+                state.instanceCounts[i] = !state.cullingCPU || isBoxInFrustum( frustumPlanes, frustumCorners, state.instanceBoxes[i] ) ? 1 : 0;
+            }
+            // Either the original nodes or the proxies of a cluster, never both. With HLOD off the proxies are always hidden
+            if ( !hlod.empty() ) {
+                hlod.select( state.hlod, cameraPos, state.projScale, instanceForNode, state.instanceCounts.data() );
             }
+            // After the HLOD selection, so that only the drawn nodes or proxies occlude
+            if ( state.cullingCPU && state.occlusionCulling ) {
+                occlusionCuller.renderOccluders( state.proj * state.view, scene.globalTransform, state.instanceCounts.data() );
+                occlusionCuller.cullInstances( state.instanceBoxes.data(), state.instanceCounts.data(), u32( mesh.drawNodes_.size() ) );
+            }
+            // After the culling, only visible instances become impostors
+            const u32 numImpostors = impostors.select( state.impostors, cameraPos, scene.globalTransform, state.instanceCounts.data(),
+                state.impostorInstances );
+            state.impostorSelection = mr::Impostors::getSelectionHash( state.impostorInstances );
+
+            state.numVisibleMeshes    = numImpostors;
+            state.numVisibleTriangles = 2 * u64( numImpostors );
+            for ( u32 i = 0; i != mesh.drawNodes_.size(); ++i ) {
+                const u32 count            = state.instanceCounts[i];
+                state.numVisibleMeshes    += count;
+                state.numVisibleTriangles += count * ( meshData.meshes[mesh.drawNodes_[i].mesh].getLODIndicesCount( 0 ) / 3 );
+            }
+            // After the statistics, the instances moved to the triangle culling are still drawn
+            triangleCuller.select( state.triangleCulling, state.instanceCounts.data(), state.triangleCullInstances );
         }
 
-        const mat4 rot1      = glm::rotate( mat4(1.0f), glm::radians(light.theta), glm::vec3(0, 1, 0) );
-        const mat4 rot2      = glm::rotate( rot1, glm::radians(light.phi), glm::vec3(1, 0, 0) );
-        const vec3 lightDir  = glm::normalize( vec3(rot2 * vec4(0.0f, -1.0f, 0.0f, 1.0f)) );
-        const mat4 lightView = glm::lookAt( glm::vec3(0.0f), lightDir, vec3(0, 0, 1) );
-        
-        const BoundingBox boxLS = bigBoxWS.getTransformed( lightView );
-        const mat4 lightProj    = glm::orthoLH_ZO( boxLS.min_.x, boxLS.max_.x, boxLS.min_.y, boxLS.max_.y, boxLS.max_.z, boxLS.min_.z );
+        const mat4 rot1 = glm::rotate( mat4(1.0f), glm::radians(state.light.theta), glm::vec3(0, 1, 0) );
+        const mat4 rot2 = glm::rotate( rot1, glm::radians(state.light.phi), glm::vec3(1, 0, 0) );
+        state.lightDir  = glm::normalize( vec3(rot2 * vec4(0.0f, -1.0f, 0.0f, 1.0f)) );
+        state.lightView = glm::lookAt( glm::vec3(0.0f), state.lightDir, vec3(0, 0, 1) );
 
-        s32 updateMaterialIndex = -1;
+        const BoundingBox boxLS = bigBoxWS.getTransformed( state.lightView );
+        state.lightProj         = glm::orthoLH_ZO( boxLS.min_.x, boxLS.max_.x, boxLS.min_.y, boxLS.max_.y, boxLS.max_.z, boxLS.min_.z );
+
+        state.simulationMs = std::chrono::duration<f32, std::milli>( std::chrono::steady_clock::now() - simulationStart ).count();
+    };
+
+    // With pipelined simulation, frame N is recorded and submitted from one state while frame N+1 is simulated into the other one
+    mr::FrameState frameStates[2];
+    for ( mr::FrameState &state : frameStates ) {
+        state.instanceCounts.resize( mesh.drawNodes_.size(), 1 );
+        state.instanceBoxes.resize( mesh.drawNodes_.size() );
+        state.impostorInstances.reserve( impostors.getNumCandidateInstances() );
+        state.triangleCullInstances.reserve( triangleCuller.getNumCandidateInstances() );
+        state.globalTransforms = scene.globalTransform;
+    }
+    mr::FrameState *pendingState    = nullptr; // simulated during the previous frame, rendered in this one
+    mr::FrameState *stateToSimulate = nullptr;
+    mr::SimulationThread simulationThread( [&] { simulate( *stateToSimulate ); } );
+    u64 uploadedTransformsVersion = 0;
+
+    u64 numFrameAllocations = 0;
+
+    app.run( [&]( uint32_t width, uint32_t height, float aspectRatio, float deltaSeconds ) {
+        const auto frameStart       = std::chrono::steady_clock::now();
+        const u64  allocationsStart = mr::GetNumAllocations();
+
+        if ( sweep ) {
+            sweep->beginFrame();
+            app.camera = Camera( sweep->getCameraPositioner() );
+        } else if ( benchmarkCfg.enabled ) {
+            benchmark.beginFrame( app.options );
+            app.camera = Camera( benchmark.getCameraPositioner() );
+        } else if ( cameraPlayback.playing ) {
+            cameraPathPlayer.update( cameraPlayback.fixedRate ? cameraPlayback.fixedDeltaSeconds : deltaSeconds );
+            if ( cameraPlayback.applyOptions && cameraPlayback.hasOptions ) {
+                mr::UnpackRendererOptions( cameraPathPlayer.getCurrentKey().userFlags, app.options );
+            }
+            app.camera = Camera( cameraPathPlayer );
+            cameraPlayback.playing = !cameraPathPlayer.isFinished();
+        }
+        // A recording needs the frames even if the camera does not move
+        if ( cameraPlayback.playing || cameraRecorder.isRecording() ) {
+            app.requestRedraw();
+        }
+
+        u32 selectedAA = std::find( &app.options[mr::RendererOption::NoAA], &app.options[mr::RendererOption::TAA], true ) - app.options;
+        app._numSamples = selectedAA == mr::RendererOption::TAA ? 1 : 1 << ( selectedAA - mr::RendererOption::NoAA );
+        if ( width != fbSize.width || height != fbSize.height ) {
+            app.fpsCounter.markPhase( "Resize" );
+            createRenderTargets( { .width = width, .height = height } );
+        }
+        if ( prevNumSamples != app._numSamples ) {
+            app.fpsCounter.markPhase( "MSAA switch" );
+            createMSAATargets();
+
+            delete opaquePipeline;
+            opaquePipeline = new Pipeline( ctx, meshStreams, kOffscreenFormat, app.getDepthFormat(), app._numSamples,
+                loadShaderModule( ctx, "../shaders/main.vert", meshVertexDefines ),
+                loadShaderModule( ctx, "../shaders/main.frag" ), lvk::CullMode_Back );
+            impostors.createPipelines( kOffscreenFormat, app.getDepthFormat(), app._numSamples, ctx->getFormat( shadowMap ) );
+
+            prevNumSamples = app._numSamples;
+        }
+        s32 selectedToneMap = std::find( &app.options[mr::RendererOption::ToneMappingNone], &app.options[mr::RendererOption::ToneMappingKhronosPBR], true ) - app.options;
+        pcHDR.tonemapMode = selectedToneMap - mr::RendererOption::ToneMappingNone;
+
+        mr::FrameState &nextState = pendingState == &frameStates[0] ? frameStates[1] : frameStates[0];
+        nextState.view             = app.camera.getViewMatrix();
+        nextState.proj             = glm::perspective( 45.0f, aspectRatio, ssaoPC.zNear, ssaoPC.zFar );
+        nextState.light            = light;
+        nextState.cullingCPU       = app.options[mr::RendererOption::CullingCPU];
+        nextState.hlod             = app.options[mr::RendererOption::HLODProxies];
+        nextState.impostors        = app.options[mr::RendererOption::TreeImpostors];
+        nextState.projScale        = nextState.proj[1][1] * 0.5f * f32( height );
+        nextState.occlusionCulling = app.options[mr::RendererOption::OcclusionCulling];
+        nextState.pvs              = app.options[mr::RendererOption::PVSCulling];
+        nextState.triangleCulling  = app.options[mr::RendererOption::TriangleCulling];
+
+        cameraRecorder.addFrame( deltaSeconds, nextState.view, app.camera.getPosition(), app.options );
+
+        // Pipelining delays the frame by one more frame, which defeats the low-latency mode
+        const bool pipelined = app.options[mr::RendererOption::PipelinedSimulation] && !app.lowLatency.enabled;
+        const mr::FrameState &state = pipelined && pendingState ? *pendingState : nextState;
+        if ( pipelined && pendingState ) {
+            stateToSimulate = &nextState;
+            simulationThread.kick();
+        } else {
+            simulate( nextState );
+        }
+
+        const mat4 view = state.view;
+        const mat4 proj = state.proj;
+
+        const u32 numVisibleMeshes    = state.numVisibleMeshes;
+        const u64 numVisibleTriangles = state.numVisibleTriangles;
+
+        const vec3 lightDir  = state.lightDir;
+        const mat4 lightView = state.lightView;
+        const mat4 lightProj = state.lightProj;
+
+        s32  updateMaterialIndex = -1;
+        bool transformEdited     = false;
+        mat4 editedLocalTransform;
         lvk::ICommandBuffer &buf = ctx->acquireCommandBuffer(); {
+            profiler.beginFrame( buf );
+            triangleCuller.upload( buf, state.triangleCullInstances );
+
+            // Without CPU culling everything is submitted, GPU culling results are not read back
+            if ( state.cullingCPU || selectsInstances ) {
+                mesh.cullInstances( buf, state.instanceCounts.data() );
+            } else if ( wasCullingCPU ) {
+                // Draw everything again instead of the last culling results
+                mesh.cullInstances( buf, nullptr );
+            }
+            wasCullingCPU = state.cullingCPU;
+            impostors.upload( buf, state.impostorInstances );
+
+            // TAA object motion: the transforms rendered in the previous frame are the previous ones of this frame. Checked again in the
+            // frame after a change, the moved nodes are the same as in the previous frame then and the list becomes empty
+            const bool transformsChanged = state.transformsVersion != uploadedTransformsVersion;
+            if ( transformsChanged || !movedIndirect._drawCommands.empty() ) {
+                cmdUpdateBufferChunked( buf, bufferPrevTransforms, 0, prevGlobalTransforms.size() * sizeof(mat4), prevGlobalTransforms.data() );
+                mesh.bufferIndirect_.selectTo( movedIndirect, [&]( const DrawIndexedIndirectCommand &cmd ) {
+                    // all instances of the command, the unmoved ones only add their camera motion
+                    const auto first = mesh.drawNodes_.begin() + cmd.baseInstance;
+                    return std::any_of( first, first + cmd.instanceCount, [&]( const DrawNode &d ) {
+                        return prevGlobalTransforms[d.node] != state.globalTransforms[d.node];
+                    });
+                }, &buf );
+                prevGlobalTransforms = state.globalTransforms;
+            }
+            if ( transformsChanged ) {
+                mesh.updateGlobalTransforms( buf, state.globalTransforms.data(), state.globalTransforms.size() );
+                uploadedTransformsVersion = state.transformsVersion;
+            }
+
+            dynamicResolution.update( profiler );
+            renderSize           = dynamicResolution.getRenderSize( fbSize );
+            const bool upscale   = renderSize.width != fbSize.width || renderSize.height != fbSize.height;
+            const lvk::Dimensions renderGroups = { .width = 1 + renderSize.width / 16, .height = 1 + renderSize.height / 16 };
+            ssaoPC.uvMaxX = f32( renderSize.width )  / f32( fbSize.width );
+            ssaoPC.uvMaxY = f32( renderSize.height ) / f32( fbSize.height );
+
+            // Only the scene is rendered with the jittered projection, culling and the UI gizmos use the unjittered one
+            temporalAA.update( app.options[mr::RendererOption::TAA], proj * view, renderSize );
+            const mat4 projRender = temporalAA.jitter( proj );
 
 #pragma region Render_Shadow_Map
-            if ( prevLight != light ) { // Only update shadow map when the light parameters changed
-                prevLight = light;
+            // Only update shadow map when the light parameters changed, or the impostors that replace meshes in it. They are picked by
+            // the distance to the camera, see Impostors::getSelectionHash()
+            if ( benchmarkCfg.shadowEveryFrame || prevLight != state.light || prevImpostorSelection != state.impostorSelection ) {
+                prevLight             = state.light;
+                prevImpostorSelection = state.impostorSelection;
+                app.fpsCounter.markPhase( "Shadow map update" );
+                // Both faces are drawn into the shadow map, see shadowPipeline
+                if ( state.triangleCulling ) {
+                    profiler.pushScope( buf, "Shadow Triangle Culling", 0xFFFF00FF );
+                        triangleCuller.cull( buf, mr::TriangleCuller::Pass_Shadow, lightProj * lightView, ctx->getDimensions( shadowMap ), false, true );
+                    profiler.popScope( buf );
+                }
                 buf.cmdBeginRendering(
                     lvk::RenderPass  { .depth = { .loadOp = lvk::LoadOp_Clear, .clearDepth = 1.0f } },
-                    lvk::Framebuffer { .depthStencil = { .texture = shadowMap } }
+                    lvk::Framebuffer { .depthStencil = { .texture = shadowMap } },
+                    { .buffers = { triangleCuller.getIndexBuffer( mr::TriangleCuller::Pass_Shadow ), triangleCuller.getCommandBuffer( mr::TriangleCuller::Pass_Shadow ) } }
                 );
-                buf.cmdPushDebugGroupLabel( "Shadow Pass", 0xFFFF00FF );
-                    buf.cmdSetDepthBias( light.depthBiasConst, light.depthBiasSlope );
+                profiler.pushScope( buf, "Shadow Pass", 0xFFFF00FF );
+                    buf.cmdSetDepthBias( state.light.depthBiasConst, state.light.depthBiasSlope );
                     buf.cmdSetDepthBiasEnable( true );
                     mesh.draw( buf, shadowPipeline, lightView, lightProj );
+                    triangleCuller.draw( buf, mr::TriangleCuller::Pass_Shadow, shadowPipeline, lightProj * lightView, ctx->gpuAddress( mesh.bufferMaterials_ ),
+                        0, 0, false );
+                profiler.popScope( buf );
+                profiler.pushScope( buf, "Shadow Impostors", 0xFFFF00FF );
+                    impostors.draw( buf, true, lightProj * lightView, vec4( -lightDir, 0.0f ), ctx->gpuAddress( mesh.bufferTransforms_ ), 0, 0 );
                     buf.cmdSetDepthBiasEnable( false );
-                buf.cmdPopDebugGroupLabel();
+                profiler.popScope( buf );
                 buf.cmdEndRendering();
                 
                 buf.cmdUpdateBuffer( bufferLight, LightData {
@@ -401,11 +1215,26 @@ int main( void ) {
                     .resolveTexture = app.IsMSAAEnabled() ? offscreenDepth : lvk::TextureHandle{}
                 }
             };
-            buf.cmdBeginRendering( renderPass, offscreen, { .textures = lvk::TextureHandle(shadowMap) } );
-                app.drawSkybox( buf, view, proj );
-                app.drawGrid( buf, proj );
+            // With the jittered projection and the viewport of the dynamic resolution, like the rasterization. The MSAA samples
+            // are not at the pixel centers, and the wireframe pipeline draws the back faces too
+            const bool wireframe = app.options[mr::RendererOption::Wireframe];
+            if ( state.triangleCulling ) {
+                profiler.pushScope( buf, "Triangle Culling", 0xFF0000FF );
+                    triangleCuller.cull( buf, mr::TriangleCuller::Pass_Main, projRender * view, renderSize, !wireframe, app._numSamples == 1 );
+                profiler.popScope( buf );
+            }
+            buf.cmdBeginRendering( renderPass, offscreen, {
+                .textures = { lvk::TextureHandle(shadowMap) },
+                .buffers  = { triangleCuller.getIndexBuffer( mr::TriangleCuller::Pass_Main ), triangleCuller.getCommandBuffer( mr::TriangleCuller::Pass_Main ) }
+            });
+                if ( upscale ) {
+                    buf.cmdBindViewport( { .x = 0.0f, .y = 0.0f, .width = f32( renderSize.width ), .height = f32( renderSize.height ) } );
+                    buf.cmdBindScissorRect( { .x = 0, .y = 0, .width = renderSize.width, .height = renderSize.height } );
+                }
+                app.drawSkybox( buf, view, projRender );
+                app.drawGrid( buf, projRender );
 
-                buf.cmdPushDebugGroupLabel( "Mesh", 0xFF0000FF );
+                profiler.pushScope( buf, "Mesh", 0xFF0000FF );
                     const struct {
                         mat4 viewProj;
                         u64  bufferTransforms;
@@ -413,35 +1242,46 @@ int main( void ) {
                         u64  bufferMaterials;
                         u64  bufferLight;
                         u32  skyboxIrradiance;
+                        u64  bufferVertexBounds;
+                        u64  bufferVertices;
                     } pc {
-                        .viewProj         = proj * view,
-                        .bufferTransforms = ctx->gpuAddress( mesh.bufferTransforms_ ),
-                        .bufferDrawData   = ctx->gpuAddress( mesh.bufferDrawData_ ),
-                        .bufferMaterials  = ctx->gpuAddress( mesh.bufferMaterials_ ),
-                        .bufferLight      = ctx->gpuAddress( bufferLight ),
-                        .skyboxIrradiance = app.skyboxIrradiance.index()
+                        .viewProj           = projRender * view,
+                        .bufferTransforms   = ctx->gpuAddress( mesh.bufferTransforms_ ),
+                        .bufferDrawData     = ctx->gpuAddress( mesh.bufferDrawData_ ),
+                        .bufferMaterials    = ctx->gpuAddress( mesh.bufferMaterials_ ),
+                        .bufferLight        = ctx->gpuAddress( bufferLight ),
+                        .skyboxIrradiance   = app.skyboxIrradiance.index(),
+                        .bufferVertexBounds = ctx->gpuAddress( mesh.bufferVertexBounds_ ),
+                        .bufferVertices     = ctx->gpuAddress( mesh.bufferVertices_ )
                     };
                     static_assert( sizeof(pc) <= 128 );
                     mesh.draw( buf, *opaquePipeline, &pc, sizeof(pc), lvk::DepthState {.compareOp = lvk::CompareOp_Less, .isDepthWriteEnabled = true},
-                        app.options[mr::RendererOption::Wireframe] );
-                buf.cmdPopDebugGroupLabel();
+                        wireframe );
+                    triangleCuller.draw( buf, mr::TriangleCuller::Pass_Main, *opaquePipeline, pc.viewProj, pc.bufferMaterials, pc.bufferLight,
+                        pc.skyboxIrradiance, wireframe );
+                profiler.popScope( buf );
+
+                profiler.pushScope( buf, "Impostors", 0xFF00A0FF );
+                    impostors.draw( buf, false, projRender * view, vec4( vec3( glm::inverse( view )[3] ), 1.0f ), ctx->gpuAddress( mesh.bufferTransforms_ ),
+                        ctx->gpuAddress( bufferLight ), app.skyboxIrradiance.index() );
+                profiler.popScope( buf );
 
                 canvas3d.clear();
-                canvas3d.setMatrix( proj * view );
+                canvas3d.setMatrix( projRender * view );
 
                 if ( app.options[mr::RendererOption::BoundingBox] ) {
-                    const DrawIndexedIndirectCommand *cmd = mesh.getDrawIndexedIndirectCommand();
-                    for ( auto &p : scene.meshForNode ) {
-                        if ( (cmd++)->instanceCount == 0 && app.options[mr::RendererOption::CullingCPU] )
+                    for ( u32 i = 0; i != mesh.drawNodes_.size(); ++i ) {
+                        if ( state.instanceCounts[i] == 0 && ( state.cullingCPU || selectsInstances ) )
                             continue;
-                        const BoundingBox box = meshData.boxes[p.second];
-                        canvas3d.box( scene.globalTransform[p.first], box, vec4(1, 0, 0, 1) );
+                        const DrawNode &d     = mesh.drawNodes_[i];
+                        const BoundingBox box = meshData.boxes[d.mesh];
+                        canvas3d.box( state.globalTransforms[d.node], box, vec4(1, 0, 0, 1) );
                     }
                 }
                 if ( selectedNode > -1 && scene.hierarchy[selectedNode].firstChild < 0 ) {
                     const u32 meshId      = scene.meshForNode[selectedNode];
                     const BoundingBox box = meshData.boxes[meshId];
-                    canvas3d.box( scene.globalTransform[selectedNode], box, vec4(0, 1, 0, 1) );
+                    canvas3d.box( state.globalTransforms[selectedNode], box, vec4(0, 1, 0, 1) );
                 }
 
                 if ( app.options[mr::RendererOption::LightFrustum] ) {
@@ -453,42 +1293,30 @@ int main( void ) {
 
 #pragma region Compute_SSAO
             if ( app.options[mr::RendererOption::SSAO] ) {
-                buf.cmdPushDebugGroupLabel( "Compute SSAO", 0xFF805020 );
+                profiler.pushScope( buf, "Compute SSAO", 0xFF805020 );
                     buf.cmdBindComputePipeline( pipelineSSAO );
                     buf.cmdPushConstants( ssaoPC );
-                    buf.cmdDispatchThreadGroups({
-                        .width  = 1 + (u32)fbSize.width / 16,
-                        .height = 1 + (u32)fbSize.height / 16
-                    }, {
+                    buf.cmdDispatchThreadGroups( renderGroups, {
                         .textures = { lvk::TextureHandle( offscreenDepth ), lvk::TextureHandle( textureSSAO ) }
                     });
-                buf.cmdPopDebugGroupLabel();
+                profiler.popScope( buf );
             }
 #pragma endregion
 
 #pragma region Blur_SSAO
             if ( app.options[mr::RendererOption::BlurSSAO] ) {
-                buf.cmdPushDebugGroupLabel( "Blur SSAO", 0xFF205080 );
-                    const lvk::Dimensions blurDim = {
-                        .width  = 1 + (u32)fbSize.width / 16,
-                        .height = 1 + (u32)fbSize.height / 16 
-                    };
+                profiler.pushScope( buf, "Blur SSAO", 0xFF205080 );
+                    const lvk::Dimensions blurDim = renderGroups;
                     struct BlurPC {
                         u32 textureDepth;
                         u32 textureIn;
                         u32 textureOut;
                         f32 depthThreshold;
                     };
-                    blurPassesSSAO.clear();
-                    blurPassesSSAO.push_back( { textureSSAO, textureBlur[0] } );
-                    for ( s32 i = 0; i != numBlurPassesSSAO - 1; ++i ) {
-                        blurPassesSSAO.push_back( { textureBlur[0], textureBlur[1] } );
-                        blurPassesSSAO.push_back( { textureBlur[1], textureBlur[0] } );
-                    }
-                    blurPassesSSAO.push_back( { textureBlur[0], textureSSAO } );
+                    buildBlurPasses( blurPassesSSAO, numBlurPassesSSAO, blurKernelSSAO, textureSSAO, textureSSAO, textureBlur[0], textureBlur[1] );
                     for ( u32 i = 0; i != blurPassesSSAO.size(); ++i ) {
                         const BlurPass p = blurPassesSSAO[i];
-                        buf.cmdBindComputePipeline( i & 1 ? pipelineBlurX : pipelineBlurY );
+                        buf.cmdBindComputePipeline( pipelineBlur[blurKernelSSAO][i & 1 ? kHorizontal : kVertical] );
                         buf.cmdPushConstants( BlurPC {
                             .textureDepth   = offscreenDepth.index(),
                             .textureIn      = p.textureIn.index(),
@@ -497,54 +1325,257 @@ int main( void ) {
                         });
                         buf.cmdDispatchThreadGroups( blurDim, { .textures = { p.textureIn, p.textureOut, lvk::TextureHandle(offscreenDepth) } } );
                     }
-                buf.cmdPopDebugGroupLabel();
+                profiler.popScope( buf );
             }
 #pragma endregion
 
 #pragma region Render_Scene_With_SSAO
-            buf.cmdPushDebugGroupLabel( "Combine Pass", 0xFF204060 );
-                if ( app.options[mr::RendererOption::SSAO] ) {
-                    buf.cmdCopyImage( textureSSAO, ctx->getCurrentSwapchainTexture(), offscreenSize );
-                } else {
-                    buf.cmdCopyImage( offscreenColor, ctx->getCurrentSwapchainTexture(), offscreenSize );
-                }
-
-            buf.cmdBeginRendering(
-                { .color = {{ .loadOp = lvk::LoadOp_Load, .clearColor = { 1.0f, 1.0f, 1.0f, 1.0f } }} },
-                { .color = { { .texture = offscreenColor } } },
-                { .textures = { app.options[mr::RendererOption::SSAO] ? lvk::TextureHandle(textureSSAO) : lvk::TextureHandle() } } );
+            // The fused post-processing pass applies SSAO itself
+            if ( !app.options[mr::RendererOption::FusedPostProcess] ) {
+                profiler.pushScope( buf, "Combine Pass", 0xFF204060 );
                     if ( app.options[mr::RendererOption::SSAO] ) {
-                        buf.cmdBindRenderPipeline( pipelineCombine );
-                        buf.cmdPushConstants( combinePC );
-                        buf.cmdBindDepthState({});
-                        buf.cmdDraw(3);
+                        buf.cmdCopyImage( textureSSAO, app.getPresentTexture(), fbSize );
+                    } else {
+                        buf.cmdCopyImage( offscreenColor, app.getPresentTexture(), fbSize );
+                    }
+
+                buf.cmdBeginRendering(
+                    { .color = {{ .loadOp = lvk::LoadOp_Load, .clearColor = { 1.0f, 1.0f, 1.0f, 1.0f } }} },
+                    { .color = { { .texture = offscreenColor } } },
+                    { .textures = { app.options[mr::RendererOption::SSAO] ? lvk::TextureHandle(textureSSAO) : lvk::TextureHandle() } } );
+                        if ( app.options[mr::RendererOption::SSAO] ) {
+                            buf.cmdBindRenderPipeline( pipelineCombine );
+                            buf.cmdPushConstants( combinePC );
+                            buf.cmdBindDepthState({});
+                            buf.cmdDraw(3);
+                            buf.cmdEndRendering();
+                        }
+                profiler.popScope( buf );
+            }
+#pragma endregion
+
+#pragma region TAA
+            if ( temporalAA.isEnabled() ) {
+                profiler.pushScope( buf, "TAA", 0xFF406010 );
+                    const vec2 jitterNDC  = temporalAA.getJitterNDC();
+                    const u32  numMoved   = (u32)movedIndirect._drawCommands.size();
+                    const mat4 prevViewProj = temporalAA.getPrevViewProj();
+                    const lvk::TextureHandle history    = texHistory[temporalAA.getPrevHistoryIndex()];
+                    const lvk::TextureHandle historyOut = texHistory[temporalAA.getHistoryIndex()];
+
+                    // Object motion of the moved nodes, the resolve reprojects everything else with the camera
+                    if ( numMoved ) {
+                        buf.cmdUpdateBuffer( bufferMotion, MotionData {
+                            .viewProj     = projRender * view,
+                            .prevViewProj = prevViewProj,
+                            .jitter       = vec4( jitterNDC, 0.0f, 0.0f )
+                        });
+                        buf.cmdBeginRendering(
+                            { .color = { { .loadOp = lvk::LoadOp_Clear, .clearColor = { 0.0f, 0.0f, 0.0f, 0.0f } } },
+                              .depth = { .loadOp = lvk::LoadOp_Load, .storeOp = lvk::StoreOp_Store } },
+                            { .color = { { .texture = texVelocity } }, .depthStencil = { .texture = offscreenDepth } },
+                            { .textures = { history } } ); // for the resolve, see below
+                            if ( upscale ) {
+                                buf.cmdBindViewport( { .x = 0.0f, .y = 0.0f, .width = f32( renderSize.width ), .height = f32( renderSize.height ) } );
+                                buf.cmdBindScissorRect( { .x = 0, .y = 0, .width = renderSize.width, .height = renderSize.height } );
+                            }
+                            const struct {
+                                u64 bufferMotion;
+                                u64 bufferTransforms;
+                                u64 bufferPrevTransforms;
+                                u64 bufferDrawData;
+                                u64 bufferVertexBounds;
+                                u64 bufferVertices;
+                            } pc {
+                                .bufferMotion         = ctx->gpuAddress( bufferMotion ),
+                                .bufferTransforms     = ctx->gpuAddress( mesh.bufferTransforms_ ),
+                                .bufferPrevTransforms = ctx->gpuAddress( bufferPrevTransforms ),
+                                .bufferDrawData       = ctx->gpuAddress( mesh.bufferDrawData_ ),
+                                .bufferVertexBounds   = ctx->gpuAddress( mesh.bufferVertexBounds_ ),
+                                .bufferVertices       = ctx->gpuAddress( mesh.bufferVertices_ )
+                            };
+                            mesh.draw( buf, velocityPipeline, &pc, sizeof(pc), lvk::DepthState { .compareOp = lvk::CompareOp_LessEqual, .isDepthWriteEnabled = false },
+                                false, &movedIndirect );
                         buf.cmdEndRendering();
                     }
-            buf.cmdPopDebugGroupLabel();
+
+                    struct TAAPC {
+                        mat4 reprojection;
+                        vec2 jitter;
+                        u32  texColor;
+                        u32  texDepth;
+                        u32  texVelocity;
+                        u32  texHistory;
+                        u32  texOut;
+                        u32  sampler;
+                        u32  renderWidth;
+                        u32  renderHeight;
+                        f32  feedbackMin;
+                        f32  feedbackMax;
+                        f32  clipGamma;
+                        u32  reset;
+                    };
+                    static_assert( sizeof(TAAPC) <= 128 );
+                    buf.cmdBindComputePipeline( pipelineTAA );
+                    buf.cmdPushConstants( TAAPC {
+                        .reprojection = prevViewProj * glm::inverse( projRender * view ),
+                        .jitter       = jitterNDC,
+                        .texColor     = offscreenColor.index(),
+                        .texDepth     = offscreenDepth.index(),
+                        .texVelocity  = numMoved ? texVelocity.index() : 0u,
+                        .texHistory   = history.index(),
+                        .texOut       = historyOut.index(),
+                        .sampler      = samplerClamp.index(),
+                        .renderWidth  = renderSize.width,
+                        .renderHeight = renderSize.height,
+                        .feedbackMin  = temporalAA.params.feedbackMin,
+                        .feedbackMax  = temporalAA.params.feedbackMax,
+                        .clipGamma    = temporalAA.params.clipGamma,
+                        .reset        = temporalAA.isHistoryValid() ? 0u : 1u
+                    });
+                    // At most LVK_MAX_SUBMIT_DEPENDENCIES textures: with the velocity pass, history is transitioned by its cmdBeginRendering()
+                    buf.cmdDispatchThreadGroups( renderGroups, {
+                        .textures = {
+                            lvk::TextureHandle( offscreenColor ),
+                            lvk::TextureHandle( offscreenDepth ),
+                            numMoved ? lvk::TextureHandle( texVelocity ) : history,
+                            historyOut
+                        }
+                    });
+                    // The resolved frame is the history of the next one and the input of everything below
+                    buf.cmdCopyImage( historyOut, offscreenColor, renderSize );
+                profiler.popScope( buf );
+                temporalAA.endFrame();
+            }
+#pragma endregion
+
+#pragma region Upscale
+            // The fused post-processing would apply SSAO at full resolution, so the upsample does it on the rendered region instead.
+            // After this region offscreenColor holds the full resolution image again
+            const bool ssaoInUpscale = upscale && app.options[mr::RendererOption::SSAO] && app.options[mr::RendererOption::FusedPostProcess];
+            if ( upscale ) {
+                profiler.pushScope( buf, "Upscale", 0xFF107050 );
+                    struct UpscalePC {
+                        u32 texIn;
+                        u32 texSSAO;
+                        u32 texOut;
+                        u32 inputWidth;
+                        u32 inputHeight;
+                        f32 ssaoScale;
+                        f32 ssaoBias;
+                        f32 sharpness;
+                    };
+                    const lvk::Dimensions upscaleGroups = { .width = ( fbSize.width + 15 ) / 16, .height = ( fbSize.height + 15 ) / 16 };
+                    buf.cmdBindComputePipeline( pipelineUpscale[ssaoInUpscale ? 1 : 0] );
+                    buf.cmdPushConstants( UpscalePC {
+                        .texIn       = offscreenColor.index(),
+                        .texSSAO     = textureSSAO.index(),
+                        .texOut      = texUpscaled.index(),
+                        .inputWidth  = renderSize.width,
+                        .inputHeight = renderSize.height,
+                        .ssaoScale   = combinePC.scale,
+                        .ssaoBias    = combinePC.bias
+                    });
+                    buf.cmdDispatchThreadGroups( upscaleGroups, packDependencies({
+                        offscreenColor,
+                        ssaoInUpscale ? lvk::TextureHandle( textureSSAO ) : lvk::TextureHandle(),
+                        texUpscaled
+                    }) );
+                    buf.cmdBindComputePipeline( pipelineUpscale[2] );
+                    buf.cmdPushConstants( UpscalePC {
+                        .texIn     = texUpscaled.index(),
+                        .texOut    = offscreenColor.index(),
+                        .sharpness = dynamicResolution.params.sharpness
+                    });
+                    buf.cmdDispatchThreadGroups( upscaleGroups, { .textures = { lvk::TextureHandle( texUpscaled ), lvk::TextureHandle( offscreenColor ) } } );
+                profiler.popScope( buf );
+            }
+#pragma endregion
+
+#pragma region Luminance
+            profiler.pushScope( buf, "Luminance", 0xFF305080 );
+                pcLuminance.exposure     = pcHDR.exposure;
+                pcLuminance.deltaSeconds = deltaSeconds;
+                buf.cmdBindComputePipeline( pipelineLuminance );
+                buf.cmdPushConstants( pcLuminance );
+                buf.cmdDispatchThreadGroups( luminanceGroups, {
+                    .textures = { lvk::TextureHandle( offscreenColor ) },
+                    .buffers  = { lvk::BufferHandle( bufferLuminance ) }
+                });
+            profiler.popScope( buf );
 #pragma endregion
 
 #pragma region Bright_Pass
-            buf.cmdPushDebugGroupLabel( "Bright Pass", 0xFF803050 );
-                BrightPassPC pcBrightPass = {
-                    .texColor     = offscreenColor.index(),
-                    .texOut       = texBrightPass.index(),
-                    .texLuminance = texLumViews[0].index(),
-                    .sampler      = samplerClamp.index(),
-                    .exposure     = pcHDR.exposure
-                };
-                buf.cmdBindComputePipeline( pipelineBrightPass );
-                buf.cmdPushConstants( pcBrightPass );
-                buf.cmdDispatchThreadGroups( sizeBloom.divide2D(16), { .textures = {
-                    lvk::TextureHandle( offscreenColor ),
-                    lvk::TextureHandle( texLumViews[0] )
-                } });
-                buf.cmdGenerateMipmap( texLumViews[0] );
-            buf.cmdPopDebugGroupLabel();
+            BrightPassPC pcBrightPass = {
+                .texColor = offscreenColor.index(),
+                .texOut   = texBrightPass.index(),
+                .sampler  = samplerClamp.index(),
+                .exposure = pcHDR.exposure
+            };
+            // The mip-chain bloom does its own thresholding in the first downsample
+            if ( app.options[mr::RendererOption::Bloom] && !bloomParams.mipChain ) {
+                profiler.pushScope( buf, "Bright Pass", 0xFF803050 );
+                    buf.cmdBindComputePipeline( pipelineBrightPass );
+                    buf.cmdPushConstants( pcBrightPass );
+                    buf.cmdDispatchThreadGroups( sizeBloom.divide2D(16), { .textures = { lvk::TextureHandle( offscreenColor ) } } );
+                profiler.popScope( buf );
+            }
 #pragma endregion
 
 #pragma region Bloom_Pass
-            if ( app.options[mr::RendererOption::Bloom] ) {
-                buf.cmdPushDebugGroupLabel( "Bloom Pass", 0xFF503080 );
+            lvk::TextureHandle texBloomResult = texBloomPass;
+            if ( app.options[mr::RendererOption::Bloom] && bloomParams.mipChain ) {
+                profiler.pushScope( buf, "Bloom Pass (mip chain)", 0xFF503080 );
+                    struct BloomDownsamplePC {
+                        u32 texIn;
+                        u32 texOut;
+                        u32 sampler;
+                        f32 exposure;
+                    };
+                    struct BloomUpsamplePC {
+                        u32 texLow;
+                        u32 texCurrent;
+                        u32 texOut;
+                        u32 sampler;
+                        f32 radius;
+                        f32 scale;
+                    };
+                    const u32 numMips = (u32)bloomParams.numMips;
+                    for ( u32 i = 0; i != numMips; ++i ) {
+                        const lvk::TextureHandle texIn = i == 0 ? lvk::TextureHandle(offscreenColor) : lvk::TextureHandle(texBloomDown[i - 1]);
+                        const lvk::Dimensions    size  = bloomMipSize( i );
+                        buf.cmdBindComputePipeline( i == 0 ? pipelineBloomPrefilter : pipelineBloomDownsample );
+                        buf.cmdPushConstants( BloomDownsamplePC {
+                            .texIn    = texIn.index(),
+                            .texOut   = texBloomDown[i].index(),
+                            .sampler  = samplerClamp.index(),
+                            .exposure = pcHDR.exposure
+                        });
+                        buf.cmdDispatchThreadGroups( { .width = (size.width + 15) / 16, .height = (size.height + 15) / 16 }, {
+                            .textures = { texIn, lvk::TextureHandle(texBloomDown[i]) }
+                        });
+                    }
+                    // The smallest level of the upsample chain is the smallest level of the downsample chain
+                    for ( s32 i = (s32)numMips - 2; i >= 0; --i ) {
+                        const lvk::TextureHandle texLow = i == (s32)numMips - 2 ? lvk::TextureHandle(texBloomDown[i + 1]) : lvk::TextureHandle(texBloomUp[i + 1]);
+                        const lvk::Dimensions    size   = bloomMipSize( i );
+                        buf.cmdBindComputePipeline( pipelineBloomUpsample );
+                        buf.cmdPushConstants( BloomUpsamplePC {
+                            .texLow     = texLow.index(),
+                            .texCurrent = texBloomDown[i].index(),
+                            .texOut     = texBloomUp[i].index(),
+                            .sampler    = samplerClamp.index(),
+                            .radius     = bloomParams.radius,
+                            .scale      = i == 0 ? 1.0f / numMips : 1.0f
+                        });
+                        buf.cmdDispatchThreadGroups( { .width = (size.width + 15) / 16, .height = (size.height + 15) / 16 }, {
+                            .textures = { texLow, lvk::TextureHandle(texBloomDown[i]), lvk::TextureHandle(texBloomUp[i]) }
+                        });
+                    }
+                    texBloomResult = texBloomUp[0];
+                profiler.popScope( buf );
+            } else if ( app.options[mr::RendererOption::Bloom] ) {
+                profiler.pushScope( buf, "Bloom Pass", 0xFF503080 );
                     struct BloomPC {
                         u32 texIn;
                         u32 texOut;
@@ -556,16 +1587,10 @@ int main( void ) {
                         u32 texRotationPattern;
                         u32 sampler;
                     };
-                    blurPassesBloom.clear();
-                    blurPassesBloom.push_back( { texBrightPass, texBloom[0] } );
-                    for ( s32 i = 0; i != numBlurPassesBloom - 1; ++i ) {
-                        blurPassesBloom.push_back( { texBloom[0], texBloom[1] } );
-                        blurPassesBloom.push_back( { texBloom[1], texBloom[0] } );
-                    }
-                    blurPassesBloom.push_back( { texBloom[0], texBloomPass } );
+                    buildBlurPasses( blurPassesBloom, numBlurPassesBloom, blurKernelBloom, texBrightPass, texBloomPass, texBloom[0], texBloom[1] );
                     for ( u32 i = 0; i != blurPassesBloom.size(); ++i ) {
                         const BlurPass p = blurPassesBloom[i];
-                        buf.cmdBindComputePipeline( i & 1 ? pipelineBloomX : pipelineBloomY );
+                        buf.cmdBindComputePipeline( pipelineBloom[blurKernelBloom][i & 1 ? kHorizontal : kVertical] );
                         buf.cmdPushConstants( BloomPC {
                             .texIn   = p.textureIn.index(),
                             .texOut  = p.textureOut.index(),
@@ -575,10 +1600,12 @@ int main( void ) {
                             .textures = { p.textureIn, p.textureOut, lvk::TextureHandle(texBrightPass)
                         }});
                     }
-                buf.cmdPopDebugGroupLabel();
+                    texBloomResult = texBloomPass;
+                profiler.popScope( buf );
             } else {
                 pcHDR.bloomStrength = 0.0f; // Instead of clearing the bloom texture, zero out its impact on the final image
             }
+            pcHDR.texBloom = texBloomResult.index();
 #pragma endregion
 
 #pragma region ToneMapping
@@ -586,81 +1613,131 @@ int main( void ) {
                 .color = { { .loadOp = lvk::LoadOp_Load, .clearColor = { 1.0f, 1.0f, 1.0f, 1.0f } } }
             };
             const lvk::Framebuffer framebufferMain = {
-                .color = { { .texture = ctx->getCurrentSwapchainTexture() } }
+                .color = { { .texture = app.getPresentTexture() } }
             };
 
-            buf.cmdPushDebugGroupLabel( "ToneMapping", 0xFF701080 );
-                buf.cmdBeginRendering( renderPassMain, framebufferMain, {
-                    .textures = { lvk::TextureHandle(texLumViews[0]) }
-                });
-                buf.cmdBindRenderPipeline( pipelineToneMap );
-                buf.cmdPushConstants( pcHDR );
-                buf.cmdBindDepthState( {} );
-                buf.cmdDraw( 3 );
-            buf.cmdPopDebugGroupLabel();
-#pragma endregion
-
-#pragma region Render_UI
-            app.imgui->beginFrame( framebufferMain );
-                const ImVec2 statsSize         = mr::ImGuiFPSComponent( app.fpsCounter.getFPS() );
-                const ImVec2 camControlSize    = mr::ImGuiCameraControlsComponent( app.cameraPos, app.cameraAngles, app.cameraType, { 10.0f, statsSize.y + mr::COMPONENT_PADDING } );
-                if ( app.cameraType == false ) {
-                    app.camera = Camera( app.fpsPositioner );
-                } else {
-                    app.moveToPositioner.setDesiredPosition( app.cameraPos );
-                    app.moveToPositioner.setDesiredAngles( app.cameraAngles );
-                    app.camera = Camera( app.moveToPositioner );
-                }
-                const ImVec2 renderOptionsSize = mr::ImGuiRenderOptionsComponent( app.options, { 10.0f, camControlSize.y + mr::COMPONENT_PADDING } );
-                u32 selectedAA = std::find( &app.options[mr::RendererOption::NoAA], &app.options[mr::RendererOption::MSAAx16], true ) - app.options;
-                app._numSamples = 1 << ( selectedAA - mr::RendererOption::NoAA );
-                if ( prevNumSamples != app._numSamples ) {
-                    msaaColor = nullptr;
-                    msaaDepth = nullptr;
-
-                    msaaColor = ctx->createTexture({
-                        .format     = kOffscreenFormat,
-                        .dimensions = fbSize,
-                        .numSamples = app._numSamples,
-                        .usage      = lvk::TextureUsageBits_Attachment,
-                        .storage    = lvk::StorageType_Memoryless,
-                        .debugName  = "MSAA: Color"
+            if ( app.options[mr::RendererOption::FusedPostProcess] ) {
+                profiler.pushScope( buf, "Post Processing", 0xFF701080 );
+                    struct PostProcessPC {
+                        u64 bufferLuminance;
+                        u32 texColor;
+                        u32 texSSAO;
+                        u32 texBloom;
+                        u32 sampler;
+                        f32 ssaoScale;
+                        f32 ssaoBias;
+                        f32 exposure;
+                        f32 bloomStrength;
+                        f32 maxWhite;
+                        f32 P, a, m, l, c, b;
+                        f32 startCompression;
+                        f32 desaturation;
+                    };
+                    static_assert( sizeof(PostProcessPC) <= 128 );
+                    const bool ssao = app.options[mr::RendererOption::SSAO] && !ssaoInUpscale;
+                    // every pixel is written, nothing to load
+                    buf.cmdBeginRendering( { .color = { { .loadOp = lvk::LoadOp_DontCare } } }, framebufferMain, packDependencies({
+                            offscreenColor,
+                            ssao ? lvk::TextureHandle( textureSSAO ) : lvk::TextureHandle(),
+                            texBloomResult
+                        }, { bufferLuminance } ) );
+                    buf.cmdBindRenderPipeline( pipelinePostProcess[pcHDR.tonemapMode][ssao ? 1 : 0] );
+                    buf.cmdPushConstants( PostProcessPC {
+                        .bufferLuminance  = pcHDR.bufferLuminance,
+                        .texColor         = pcHDR.texColor,
+                        .texSSAO          = combinePC.textureSSAO,
+                        .texBloom         = pcHDR.texBloom,
+                        .sampler          = pcHDR.sampler,
+                        .ssaoScale        = combinePC.scale,
+                        .ssaoBias         = combinePC.bias,
+                        .exposure         = pcHDR.exposure,
+                        .bloomStrength    = pcHDR.bloomStrength,
+                        .maxWhite         = pcHDR.maxWhite,
+                        .P = pcHDR.P, .a = pcHDR.a, .m = pcHDR.m, .l = pcHDR.l, .c = pcHDR.c, .b = pcHDR.b,
+                        .startCompression = pcHDR.startCompression,
+                        .desaturation     = pcHDR.desaturation
                     });
-                    msaaDepth = ctx->createTexture({
-                        .format     = app.getDepthFormat(),
-                        .dimensions = fbSize,
-                        .numSamples = app._numSamples,
-                        .usage      = lvk::TextureUsageBits_Attachment,
-                        .storage    = lvk::StorageType_Memoryless,
-                        .debugName  = "MSAA: Depth"
+                    buf.cmdBindDepthState( {} );
+                    buf.cmdDraw( 3 );
+                profiler.popScope( buf );
+            } else {
+                profiler.pushScope( buf, "ToneMapping", 0xFF701080 );
+                    buf.cmdBeginRendering( renderPassMain, framebufferMain, {
+                        .textures = { texBloomResult },
+                        .buffers  = { lvk::BufferHandle(bufferLuminance) }
                     });
+                    buf.cmdBindRenderPipeline( pipelineToneMap );
+                    buf.cmdPushConstants( pcHDR );
+                    buf.cmdBindDepthState( {} );
+                    buf.cmdDraw( 3 );
+                profiler.popScope( buf );
+            }
+#pragma endregion
 
-                    delete opaquePipeline;
-                    opaquePipeline = new Pipeline( ctx, meshData.streams, kOffscreenFormat, app.getDepthFormat(), app._numSamples,
-                        loadShaderModule( ctx, "../shaders/main.vert" ),
-                        loadShaderModule( ctx, "../shaders/main.frag" ), lvk::CullMode_Back );
-
-                    prevNumSamples = app._numSamples;
-                }
-                s32 selectedToneMap = std::find( &app.options[mr::RendererOption::ToneMappingNone], &app.options[mr::RendererOption::ToneMappingKhronosPBR], true ) - app.options;
-                pcHDR.tonemapMode = selectedToneMap - mr::RendererOption::ToneMappingNone;
-
-                const ImVec2 lightControlsSize = mr::ImGuiLightControlsComponent( light, shadowMap.index(), { 10.0f, renderOptionsSize.y + mr::COMPONENT_PADDING } );
-                const ImVec2 ssaoControlsSize  = mr::ImGuiSSAOControlsComponent( ssaoPC, combinePC, numBlurPassesSSAO, app.ssaoDepthThreshold,
-                    textureSSAO.index(), { 10.0f, lightControlsSize.y + mr::COMPONENT_PADDING } );
-                const ImVec2 bloomControlsSize = mr::ImGuiBloomToneMapControlsComponent( pcHDR, pcBrightPass, numBlurPassesBloom, { 10.0f, ssaoControlsSize.y + mr::COMPONENT_PADDING } );
-                const ImVec2 sceneGraphSize    = mr::ImGuiSceneGraphComponent( scene, selectedNode, { 10.0f, bloomControlsSize.y + mr::COMPONENT_PADDING } );
-                mr::ImGuiEditNodeComponent( scene, meshData, view, proj, selectedNode, updateMaterialIndex, mesh.textureCache_ );
-            app.imgui->endFrame( buf );
+#pragma region Render_UI
+            if ( !benchmarkCfg.enabled ) { // fixed render options and no UI cost in the timings
+                profiler.pushScope( buf, "UI", 0xFF808080 );
+                app.imgui->beginFrame( framebufferMain );
+                    const ImVec2 statsSize         = mr::ImGuiFPSComponent( app.fpsCounter, numFrameAllocations, app.onDemand, app.lowLatency );
+                    const ImVec2 camControlSize    = mr::ImGuiCameraControlsComponent( app.cameraPos, app.cameraAngles, app.cameraType, { 10.0f, statsSize.y + mr::COMPONENT_PADDING } );
+                    if ( app.cameraType == false ) {
+                        app.camera = Camera( app.fpsPositioner );
+                    } else {
+                        app.moveToPositioner.setDesiredPosition( app.cameraPos );
+                        app.moveToPositioner.setDesiredAngles( app.cameraAngles );
+                        app.camera = Camera( app.moveToPositioner );
+                    }
+                    const ImVec2 camPathSize       = mr::ImGuiCameraPathComponent( cameraRecorder, cameraPathPlayer, cameraPlayback, { 10.0f, camControlSize.y + mr::COMPONENT_PADDING } );
+                    const ImVec2 renderOptionsSize = mr::ImGuiRenderOptionsComponent( app.options, { 10.0f, camPathSize.y + mr::COMPONENT_PADDING } );
+                    const ImVec2 lightControlsSize = mr::ImGuiLightControlsComponent( light, shadowMap.index(), { 10.0f, renderOptionsSize.y + mr::COMPONENT_PADDING } );
+                    const ImVec2 ssaoControlsSize  = mr::ImGuiSSAOControlsComponent( ssaoPC, combinePC, numBlurPassesSSAO, blurKernelSSAO, app.ssaoDepthThreshold,
+                        textureSSAO.index(), { 10.0f, lightControlsSize.y + mr::COMPONENT_PADDING } );
+                    const ImVec2 bloomControlsSize = mr::ImGuiBloomToneMapControlsComponent( pcHDR, pcBrightPass, pcLuminance, bloomParams, numBlurPassesBloom, blurKernelBloom, { 10.0f, ssaoControlsSize.y + mr::COMPONENT_PADDING } );
+                    const ImVec2 dynResControlSize = mr::ImGuiDynamicResolutionComponent( dynamicResolution, renderSize, fbSize, { 10.0f, bloomControlsSize.y + mr::COMPONENT_PADDING } );
+                    const ImVec2 sceneGraphSize    = mr::ImGuiSceneGraphComponent( scene, selectedNode, app.frameArena, { 10.0f, dynResControlSize.y + mr::COMPONENT_PADDING } );
+                    mr::ImGuiEditNodeComponent( scene, meshData, view, proj, selectedNode, selectedNode > -1 ? state.globalTransforms[selectedNode] : mat4( 1.0f ),
+                        transformEdited, editedLocalTransform, updateMaterialIndex, mesh.textureCache_, app.frameArena );
+                    mr::ImGuiGPUProfilerComponent( profiler, { width - 520.0f, 10.0f } );
+                app.imgui->endFrame( buf );
+                profiler.popScope( buf );
+            }
             buf.cmdEndRendering();
 #pragma endregion
+            profiler.endFrame( buf );
         }
-        ctx->submit( buf, ctx->getCurrentSwapchainTexture() );
+        profiler.frameSubmitted( app.submitFrame( buf ) );
 
-        if ( recalculateGlobalTransforms( scene ) ) {
-            mesh.updateGlobalTransforms( scene.globalTransform.data(), scene.globalTransform.size() );
+        // The next frame renders nextState. When pipelining was just enabled that is the state rendered in this frame
+        simulationThread.wait();
+        pendingState = pipelined ? &nextState : nullptr;
+
+        // Recalculated by the next simulation
+        if ( transformEdited ) {
+            scene.localTransform[selectedNode] = editedLocalTransform;
+            markAsChanged( scene, selectedNode );
         }
+
+        // Everything recorded and submitted, the benchmark bookkeeping below is not counted
+        numFrameAllocations = mr::GetNumAllocations() - allocationsStart;
+
+        if ( sweep ) {
+            const f32 cpuMs = std::chrono::duration<f32, std::milli>( std::chrono::steady_clock::now() - frameStart ).count();
+            sweep->addFrame( cpuMs, profiler );
+            if ( sweep->isFinished() ) {
+                sweep->writeReport( benchmarkCfg.outputFileName );
+                app.requestExit();
+            }
+        } else if ( benchmarkCfg.enabled ) {
+            const f32 cpuMs = std::chrono::duration<f32, std::milli>( std::chrono::steady_clock::now() - frameStart ).count();
+            benchmark.addFrame( cpuMs, numVisibleMeshes, numVisibleTriangles, numFrameAllocations, profiler );
+            if ( benchmark.isFinished() ) {
+                benchmark.writeJSON( app.options, mr::RendererOption::MAX );
+                app.requestExit();
+            }
+        }
+
         if ( updateMaterialIndex > -1 ) {
+            app.fpsCounter.markPhase( "Material update" );
             mesh.updateMaterial( meshData.materials.data(), updateMaterialIndex );
         } 
     });
@@ -668,5 +1745,5 @@ int main( void ) {
     delete opaquePipeline;
 
     ctx.release();
-    return 0;
+    return benchmark.hasFailed() ? 1 : 0;
 }
@@ -0,0 +1,88 @@
+#include "../include/OcclusionCuller.hpp"
+
+#include <stdio.h>
+
+// CPU-only checks of OcclusionCuller: a building shell in front of a camera at the origin looking down -z, no window and no GPU.
+// Returns the number of failed checks
+namespace {
+	u32 numFailed = 0;
+
+	void check( bool passed, const char *name ) {
+		printf( "%s %s\n", passed ? "[PASS]" : "[FAIL]", name );
+		numFailed += passed ? 0 : 1;
+	}
+
+	// One opaque mesh, the 12 triangles of the box, float vertices
+	MeshData makeShell( const BoundingBox &box ) {
+		MeshData md;
+		md.streams = {
+			.attributes    = { { .location = 0, .format = lvk::VertexFormat::Float3, .offset = 0 } },
+			.inputBindings = { { .stride = sizeof( vec3 ) } },
+		};
+		for ( u32 i = 0; i != 8; i++ ) {
+			put( md.vertexData, vec3( i & 1 ? box.max_.x : box.min_.x, i & 2 ? box.max_.y : box.min_.y, i & 4 ? box.max_.z : box.min_.z ) );
+		}
+		const u32 faces[6][4] = { { 0, 1, 3, 2 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 3, 7, 5 } };
+		for ( const u32 *f : faces ) {
+			md.indexData.insert( md.indexData.end(), { f[0], f[1], f[2], f[0], f[2], f[3] } );
+		}
+
+		Mesh mesh;
+		mesh.vertexCount  = 8;
+		mesh.lodOffset[1] = u32( md.indexData.size() );
+		md.meshes.push_back( mesh );
+		md.boxes.push_back( box );
+		md.materials.push_back( Material() );
+		return md;
+	}
+}
+
+int main() {
+	const BoundingBox             shell( vec3( -3.0f, -3.0f, -11.0f ), vec3( 3.0f, 3.0f, -10.0f ) );
+	const MeshData                meshData = makeShell( shell );
+	const std::vector<DrawNode>   drawNodes        = { { .node = 0, .mesh = 0 } };
+	const std::vector<glm::mat4>  globalTransforms = { glm::mat4( 1.0f ) };
+
+	mr::OcclusionCuller culler( meshData, drawNodes, globalTransforms, mr::OcclusionCuller::Params(), 2 );
+	check( culler.getNumOccluders() == 1, "the shell is an occluder" );
+
+	const mat4 viewProj = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 1000.0f ) *
+		glm::lookAt( vec3( 0.0f ), vec3( 0.0f, 0.0f, -1.0f ), vec3( 0.0f, 1.0f, 0.0f ) );
+	const u32 occluderVisible = 1;
+	culler.renderOccluders( viewProj, globalTransforms, &occluderVisible );
+
+	const BoundingBox covered( vec3( -1.0f, -1.0f, -31.0f ), vec3( 1.0f, 1.0f, -29.0f ) );
+	check( !culler.isBoxVisible( covered ), "a box fully covered by the occluder is culled" );
+
+	// Through the batch of the worker threads as well
+	std::vector<BoundingBox> boxes( 1000, covered );
+	std::vector<u32>         visible( boxes.size(), 1 );
+	check( culler.cullInstances( boxes.data(), visible.data(), u32( boxes.size() ) ) == boxes.size(), "cullInstances() culls all covered boxes" );
+
+	const BoundingBox nearCrossing( vec3( -1.0f, -1.0f, -31.0f ), vec3( 1.0f, 1.0f, 1.0f ) );
+	check( culler.isBoxVisible( nearCrossing ), "a box crossing the near plane stays visible" );
+
+	// A patch of the front face of the occluder against the occluder itself, from a few points of view and pushed back by half of the
+	// depth tolerance. It covers only whole tiles of the front face, where the rasterized depths and the projected corners are rounded
+	// differently: an exact comparison culls it
+	const mat4 proj = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 1000.0f );
+	bool neverCullsItself = true;
+	for ( u32 i = 0; i != 9; i++ ) {
+		const vec3 eye = vec3( f32( i % 3 ) - 1.0f, f32( i / 3 ) - 1.0f, 0.0f ) * 0.7f;
+		const mat4 vp  = proj * glm::lookAt( eye, vec3( 0.0f, 0.0f, -10.5f ), vec3( 0.0f, 1.0f, 0.0f ) );
+		culler.renderOccluders( vp, globalTransforms, &occluderVisible );
+
+		// z / w of the front face and 1 cm behind it
+		const auto getDepth = [&vp]( f32 z ) {
+			const vec4 clip = vp * vec4( 0.0f, 0.0f, z, 1.0f );
+			return clip.z / clip.w;
+		};
+		const f32 push = 0.5f * mr::OcclusionCuller::kDepthTolerance * 0.01f / ( getDepth( -10.01f ) - getDepth( -10.0f ) );
+		const BoundingBox patch( vec3( -1.0f, -1.0f, shell.max_.z - push ), vec3( 1.0f, 1.0f, shell.max_.z - push ) );
+		neverCullsItself = neverCullsItself && culler.isBoxVisible( patch );
+	}
+	check( neverCullsItself, "an occluder never culls its own surface, within the depth tolerance" );
+
+	printf( numFailed ? "[ERROR] %u checks failed\n" : "[INFO] All checks passed\n", numFailed );
+	return int( numFailed );
+}
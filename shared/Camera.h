@@ -2,11 +2,13 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <vector>
 
 #include "shared/UtilsMath.h"
 #include "shared/Trackball.h"
 
 #include "glm/gtx/euler_angles.hpp"
+#include "glm/gtx/spline.hpp"
 
 class CameraPositionerInterface
 {
@@ -230,3 +232,90 @@ private:
 		return glm::vec3(clipAngle(d.x), clipAngle(d.y), clipAngle(d.z));
 	}
 };
+
+struct CameraPathKey
+{
+	float time = 0.0f; // seconds since the first key
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::quat orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); // same convention as the view matrix rotation
+	uint32_t userFlags = 0; // not used by the camera, e.g. the renderer options at the time of recording
+};
+
+// Replays a recorded camera track: Catmull-Rom interpolation of the positions and slerp of the orientations.
+// update() advances the playback by the given time step, pass the measured frame time for a real-time replay
+// or a constant for a fixed-rate (frame-exact, reproducible) replay.
+class CameraPositioner_Path final : public CameraPositionerInterface
+{
+public:
+	CameraPositioner_Path() = default;
+	explicit CameraPositioner_Path(const std::vector<CameraPathKey>& keys, bool looping = false)
+	{
+		setKeys(keys, looping);
+	}
+
+	void setKeys(const std::vector<CameraPathKey>& keys, bool looping = false)
+	{
+		keys_ = keys;
+		looping_ = looping;
+		setTime(0.0f);
+	}
+
+	void update(float deltaSeconds)
+	{
+		setTime(time_ + deltaSeconds);
+	}
+
+	void setTime(float t)
+	{
+		const float duration = getDuration();
+		time_ = (looping_ && duration > 0.0f) ? std::fmod(t, duration) : std::min(t, duration);
+
+		if (keys_.empty())
+			return;
+
+		// first key after the current time
+		const auto it = std::upper_bound(keys_.begin(), keys_.end(), time_, [](float t, const CameraPathKey& k) { return t < k.time; });
+
+		const size_t last = keys_.size() - 1;
+		const size_t i1 = std::min(size_t(it - keys_.begin()), last);
+		const size_t i0 = i1 > 0 ? i1 - 1 : 0;
+
+		const CameraPathKey& k0 = keys_[i0];
+		const CameraPathKey& k1 = keys_[i1];
+
+		const float span = k1.time - k0.time;
+		const float alpha = span > 0.0f ? glm::clamp((time_ - k0.time) / span, 0.0f, 1.0f) : 0.0f;
+
+		// the tangents at both ends are clamped to the end keys
+		const glm::vec3& p0 = keys_[i0 > 0 ? i0 - 1 : 0].position;
+		const glm::vec3& p3 = keys_[std::min(i1 + 1, last)].position;
+
+		position_ = glm::catmullRom(p0, k0.position, k1.position, p3, alpha);
+		orientation_ = glm::slerp(k0.orientation, k1.orientation, alpha); // takes the shortest arc
+		currentKey_ = alpha < 0.5f ? i0 : i1;
+	}
+
+	float getTime() const { return time_; }
+	float getDuration() const { return keys_.empty() ? 0.0f : keys_.back().time; }
+	bool isFinished() const { return !looping_ && time_ >= getDuration(); }
+	bool empty() const { return keys_.empty(); }
+
+	// nearest key to the current time, e.g. to restore the recorded render options
+	const CameraPathKey& getCurrentKey() const { return keys_[currentKey_]; }
+	const std::vector<CameraPathKey>& getKeys() const { return keys_; }
+
+	virtual glm::mat4 getViewMatrix() const override
+	{
+		return glm::mat4_cast(orientation_) * glm::translate(glm::mat4(1.0f), -position_);
+	}
+
+	virtual glm::vec3 getPosition() const override { return position_; }
+
+private:
+	std::vector<CameraPathKey> keys_;
+	bool looping_ = false;
+	float time_ = 0.0f;
+	size_t currentKey_ = 0;
+	glm::vec3 position_ = glm::vec3(0.0f);
+	glm::quat orientation_ = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+};
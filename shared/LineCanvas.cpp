@@ -1,5 +1,7 @@
 #include "LineCanvas.h"
 
+#include <algorithm>
+
 static const char* codeVS = R"(
 layout (location = 0) out vec4 out_color;
 
@@ -194,12 +196,13 @@ void LineCanvas3D::render(lvk::IContext& ctx, const lvk::Framebuffer& desc, lvk:
   const uint32_t requiredSize = lines_.size() * sizeof(LineData);
 
   if (currentBufferSize_[currentFrame_] < requiredSize) {
-    linesBuffer_[currentFrame_] = ctx.createBuffer(
-        { .usage = lvk::BufferUsageBits_Storage, .storage = lvk::StorageType_HostVisible, .size = requiredSize, .data = lines_.data() });
-    currentBufferSize_[currentFrame_] = requiredSize;
-  } else {
-    ctx.upload(linesBuffer_[currentFrame_], lines_.data(), requiredSize);
+    // grow geometrically so a slowly growing number of lines does not recreate the buffer every frame
+    const uint32_t newSize = std::max(requiredSize, 2 * currentBufferSize_[currentFrame_]);
+    linesBuffer_[currentFrame_] =
+        ctx.createBuffer({ .usage = lvk::BufferUsageBits_Storage, .storage = lvk::StorageType_HostVisible, .size = newSize });
+    currentBufferSize_[currentFrame_] = newSize;
   }
+  ctx.upload(linesBuffer_[currentFrame_], lines_.data(), requiredSize);
 
   if (pipeline_.empty() || pipelineSamples_ != numSamples) {
     pipelineSamples_ = numSamples;
@@ -1,6 +1,11 @@
 #include "shared/Scene/MergeUtil.h"
 #include "shared/Scene/Scene.h"
 
+#include <glm/gtc/packing.hpp>
+
+#include <map>
+#include <string.h>
+#include <tuple>
 #include <unordered_map>
 
 static uint32_t shiftMeshIndices(MeshData& meshData, const std::vector<uint32_t>& meshesToMerge)
@@ -107,6 +112,365 @@ void mergeNodesWithMaterial(Scene& scene, MeshData& meshData, const std::string&
   deleteSceneNodes(scene, toDelete);
 }
 
+// Removes the meshes no node refers to and their vertices and indices. The vertices and indices are compacted in their old order,
+// so the mesh-local indices never grow
+static void removeUnusedMeshes(Scene& scene, MeshData& md)
+{
+  const uint32_t numMeshes = (uint32_t)md.meshes.size();
+  const uint32_t stride    = md.streams.getVertexSize();
+
+  std::vector<bool> isUsed(numMeshes, false);
+  for (const auto& n : scene.meshForNode)
+    isUsed[n.second] = true;
+
+  std::vector<uint32_t> newVertex(md.vertexData.size() / stride, ~0u);
+  for (uint32_t m = 0; m != numMeshes; m++) {
+    const Mesh& mesh = md.meshes[m];
+    if (!isUsed[m])
+      continue;
+    for (uint32_t i = 0; i != mesh.getIndicesCount(); i++)
+      newVertex[mesh.vertexOffset + md.indexData[mesh.indexOffset + i]] = 0;
+  }
+
+  std::vector<uint8_t> vertexData;
+  for (uint32_t v = 0; v != newVertex.size(); v++) {
+    if (newVertex[v] == ~0u)
+      continue;
+    newVertex[v] = (uint32_t)(vertexData.size() / stride);
+    vertexData.insert(vertexData.end(), md.vertexData.begin() + v * stride, md.vertexData.begin() + (v + 1) * stride);
+  }
+
+  std::vector<uint32_t> newIndexForMesh(numMeshes, ~0u);
+  std::vector<Mesh> meshes;
+  std::vector<uint32_t> indexData;
+  for (uint32_t m = 0; m != numMeshes; m++) {
+    if (!isUsed[m])
+      continue;
+
+    Mesh mesh                 = md.meshes[m];
+    const uint32_t* indices   = md.indexData.data() + mesh.indexOffset;
+    const uint32_t numIndices = mesh.getIndicesCount();
+    const uint32_t newOffset  = numIndices ? newVertex[mesh.vertexOffset + *std::min_element(indices, indices + numIndices)] : 0;
+    const uint32_t lodOffset0 = mesh.lodOffset[0];
+
+    mesh.indexOffset = (uint32_t)indexData.size();
+    for (uint32_t i = 0; i != numIndices; i++)
+      indexData.push_back(newVertex[mesh.vertexOffset + indices[i]] - newOffset);
+    for (uint32_t l = 0; l <= mesh.lodCount; l++)
+      mesh.lodOffset[l] -= lodOffset0;
+    mesh.vertexOffset = newOffset;
+    mesh.vertexCount  = numIndices ? *std::max_element(indexData.begin() + mesh.indexOffset, indexData.end()) + 1 : 0;
+
+    newIndexForMesh[m] = (uint32_t)meshes.size();
+    meshes.push_back(mesh);
+  }
+
+  for (auto& n : scene.meshForNode)
+    n.second = newIndexForMesh[n.second];
+
+  md.meshes     = std::move(meshes);
+  md.indexData  = std::move(indexData);
+  md.vertexData = std::move(vertexData);
+  md.boxes.clear();
+}
+
+// Candidates for deduplication have the same hash of everything that does not change with a rigid transform
+static uint64_t hashMeshTopology(const MeshData& md, const Mesh& mesh)
+{
+  const uint32_t stride   = md.streams.getVertexSize();
+  const uint32_t uvOffset = md.streams.attributes[1].offset;
+
+  uint64_t hash = 14695981039346656037ull; // FNV-1a
+  auto add      = [&hash](uint32_t v) {
+    hash = (hash ^ v) * 1099511628211ull;
+  };
+
+  add(mesh.materialID);
+  add(mesh.getIndicesCount());
+  for (uint32_t i = 0; i != mesh.getIndicesCount(); i++)
+    add(md.indexData[mesh.indexOffset + i]);
+  for (uint32_t v = 0; v != mesh.vertexCount; v++)
+    add(*(const uint32_t*)&md.vertexData[(mesh.vertexOffset + v) * stride + uvOffset]);
+
+  return hash;
+}
+
+static vec3 getMeshVertexNormal(const MeshData& md, const Mesh& mesh, uint32_t v)
+{
+  const uint32_t offset = (mesh.vertexOffset + v) * md.streams.getVertexSize() + md.streams.attributes[2].offset;
+  return vec3(glm::unpackSnorm3x10_1x2(*(const uint32_t*)&md.vertexData[offset]));
+}
+
+// Orthonormal frame at vertex 0 of the mesh from 2 other vertices chosen on the original (so the same vertices are used for
+// every copy), returns false for degenerate meshes
+static bool getMeshFrame(const MeshData& md, const Mesh& mesh, uint32_t v1, uint32_t v2, mat4& frame)
+{
+  const vec3 p0 = getVertexPosition(md, 0, mesh.vertexOffset);
+  const vec3 e1 = getVertexPosition(md, 0, mesh.vertexOffset + v1) - p0;
+  const vec3 n  = glm::cross(e1, getVertexPosition(md, 0, mesh.vertexOffset + v2) - p0);
+
+  if (glm::length(e1) < 1e-6f || glm::length(n) < 1e-12f)
+    return false;
+
+  const vec3 x = glm::normalize(e1);
+  const vec3 z = glm::normalize(n);
+  frame        = mat4(vec4(x, 0.0f), vec4(glm::cross(z, x), 0.0f), vec4(z, 0.0f), vec4(p0, 1.0f));
+  return true;
+}
+
+// Rigid transform from the vertices of the original to the ones of the copy, if every vertex matches within the tolerance
+static bool findMeshTransform(const MeshData& md, const Mesh& original, const Mesh& copy, uint32_t v1, uint32_t v2, mat4& transform)
+{
+  mat4 frameOriginal, frameCopy;
+  if (!getMeshFrame(md, original, v1, v2, frameOriginal) || !getMeshFrame(md, copy, v1, v2, frameCopy)) {
+    // translation only
+    transform = glm::translate(mat4(1.0f), getVertexPosition(md, 0, copy.vertexOffset) - getVertexPosition(md, 0, original.vertexOffset));
+  } else {
+    transform = frameCopy * glm::inverse(frameOriginal);
+  }
+
+  vec3 vmin(std::numeric_limits<float>::max());
+  vec3 vmax(std::numeric_limits<float>::lowest());
+  for (uint32_t v = 0; v != original.vertexCount; v++) {
+    const vec3 p = getVertexPosition(md, 0, original.vertexOffset + v);
+    vmin         = glm::min(vmin, p);
+    vmax         = glm::max(vmax, p);
+  }
+  const float tolerance = std::max(glm::length(vmax - vmin) * 1e-4f, 1e-5f);
+  const glm::mat3 rotation(transform);
+
+  for (uint32_t v = 0; v != original.vertexCount; v++) {
+    const vec3 p = vec3(transform * vec4(getVertexPosition(md, 0, original.vertexOffset + v), 1.0f));
+    if (glm::length(p - getVertexPosition(md, 0, copy.vertexOffset + v)) > tolerance)
+      return false;
+    // 10-bit normals
+    if (glm::dot(rotation * getMeshVertexNormal(md, original, v), getMeshVertexNormal(md, copy, v)) < 0.99f)
+      return false;
+  }
+
+  return true;
+}
+
+uint32_t deduplicateMeshes(Scene& scene, MeshData& md)
+{
+  LVK_ASSERT(!md.isQuantized());
+  if (md.isQuantized())
+    return 0;
+
+  rebaseMeshIndices(md);
+
+  const uint32_t numMeshes = (uint32_t)md.meshes.size();
+
+  // The vertex count is not updated for the meshes merged by mergeNodesWithMaterial()
+  for (Mesh& mesh : md.meshes) {
+    const uint32_t* indices = md.indexData.data() + mesh.indexOffset;
+    mesh.vertexCount        = mesh.getIndicesCount() ? *std::max_element(indices, indices + mesh.getIndicesCount()) + 1 : 0;
+  }
+
+  // original mesh for every mesh and the transform from the original to it
+  std::vector<uint32_t> originalForMesh(numMeshes);
+  std::vector<mat4> transformForMesh(numMeshes, mat4(1.0f));
+  std::unordered_map<uint64_t, std::vector<uint32_t>> originals;
+
+  for (uint32_t m = 0; m != numMeshes; m++) {
+    const Mesh& mesh   = md.meshes[m];
+    originalForMesh[m] = m;
+    if (!mesh.vertexCount)
+      continue;
+
+    std::vector<uint32_t>& candidates = originals[hashMeshTopology(md, mesh)];
+    for (uint32_t c : candidates) {
+      const Mesh& original = md.meshes[c];
+      if (original.vertexCount != mesh.vertexCount || original.materialID != mesh.materialID ||
+          original.getIndicesCount() != mesh.getIndicesCount() ||
+          !std::equal(
+              md.indexData.begin() + original.indexOffset, md.indexData.begin() + original.indexOffset + original.getIndicesCount(),
+              md.indexData.begin() + mesh.indexOffset))
+        continue;
+
+      // the frame vertices: the farthest one from vertex 0 and the one that makes the largest triangle with them
+      const vec3 p0 = getVertexPosition(md, 0, original.vertexOffset);
+      uint32_t v1   = 0;
+      for (uint32_t v = 1; v != original.vertexCount; v++)
+        if (glm::length(getVertexPosition(md, 0, original.vertexOffset + v) - p0) >
+            glm::length(getVertexPosition(md, 0, original.vertexOffset + v1) - p0))
+          v1 = v;
+      const vec3 e1 = getVertexPosition(md, 0, original.vertexOffset + v1) - p0;
+      uint32_t v2   = 0;
+      for (uint32_t v = 1; v != original.vertexCount; v++)
+        if (glm::length(glm::cross(e1, getVertexPosition(md, 0, original.vertexOffset + v) - p0)) >
+            glm::length(glm::cross(e1, getVertexPosition(md, 0, original.vertexOffset + v2) - p0)))
+          v2 = v;
+
+      if (findMeshTransform(md, original, mesh, v1, v2, transformForMesh[m])) {
+        originalForMesh[m] = c;
+        break;
+      }
+    }
+    if (originalForMesh[m] == m)
+      candidates.push_back(m);
+  }
+
+  for (auto& n : scene.meshForNode) {
+    const uint32_t original = originalForMesh[n.second];
+    if (original != n.second) {
+      scene.localTransform[n.first] = scene.localTransform[n.first] * transformForMesh[n.second];
+      markAsChanged(scene, n.first);
+      n.second = original;
+    }
+  }
+
+  removeUnusedMeshes(scene, md);
+
+  return numMeshes - (uint32_t)md.meshes.size();
+}
+
+uint32_t appendTransformedMesh(
+    const MeshData& md, uint32_t meshIndex, const mat4& transform, uint32_t baseVertex, std::vector<uint8_t>& vertexData,
+    std::vector<uint32_t>& indexData)
+{
+  LVK_ASSERT(!md.isQuantized());
+
+  const uint32_t stride       = md.streams.getVertexSize();
+  const uint32_t posOffset    = md.streams.attributes[0].offset;
+  const uint32_t normalOffset = md.streams.attributes[2].offset;
+
+  const Mesh& mesh          = md.meshes[meshIndex];
+  const uint32_t* indices   = md.indexData.data() + mesh.indexOffset;
+  const uint32_t numIndices = mesh.getLODIndicesCount(0);
+  if (!numIndices)
+    return 0;
+  const uint32_t numVertices = *std::max_element(indices, indices + numIndices) + 1;
+
+  const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+  for (uint32_t v = 0; v != numVertices; v++) {
+    const uint8_t* src = &md.vertexData[(mesh.vertexOffset + v) * stride];
+    vertexData.insert(vertexData.end(), src, src + stride);
+    uint8_t* dst = &vertexData[vertexData.size() - stride];
+
+    vec3 pos;
+    memcpy(&pos, dst + posOffset, sizeof(pos));
+    pos = vec3(transform * vec4(pos, 1.0f));
+    memcpy(dst + posOffset, &pos, sizeof(pos));
+
+    uint32_t normal;
+    memcpy(&normal, dst + normalOffset, sizeof(normal));
+    const vec3 n = glm::normalize(normalMatrix * vec3(glm::unpackSnorm3x10_1x2(normal)));
+    normal       = glm::packSnorm3x10_1x2(vec4(n, 0.0f));
+    memcpy(dst + normalOffset, &normal, sizeof(normal));
+  }
+  for (uint32_t i = 0; i != numIndices; i++)
+    indexData.push_back(indices[i] + baseVertex);
+
+  return numVertices;
+}
+
+uint32_t batchStaticNodes(Scene& scene, MeshData& md, float cellSize, float alphaTestedCellSize)
+{
+  LVK_ASSERT(!md.isQuantized());
+  if (md.isQuantized())
+    return 0;
+
+  recalculateGlobalTransforms(scene);
+
+  const uint32_t stride = md.streams.getVertexSize();
+
+  std::vector<uint32_t> numNodesForMesh(md.meshes.size(), 0);
+  for (const auto& n : scene.meshForNode)
+    numNodesForMesh[n.second]++;
+
+  // (alpha-tested, material, cell) -> nodes, ordered so the result does not depend on the order of meshForNode
+  std::map<std::tuple<bool, uint32_t, int, int, int>, std::vector<uint32_t>> cells;
+  for (const auto& n : scene.meshForNode) {
+    const Mesh& mesh       = md.meshes[n.second];
+    const bool alphaTested = md.materials[mesh.materialID].alphaTest > 0.0f;
+    const float size       = alphaTested ? alphaTestedCellSize : cellSize;
+    if (numNodesForMesh[n.second] != 1 || !mesh.getLODIndicesCount(0) || size < 0.0f)
+      continue;
+
+    vec3 vmin(std::numeric_limits<float>::max());
+    vec3 vmax(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i != mesh.getLODIndicesCount(0); i++) {
+      const vec3 v = getVertexPosition(md, n.second, mesh.vertexOffset + md.indexData[mesh.indexOffset + i]);
+      vmin         = glm::min(vmin, v);
+      vmax         = glm::max(vmax, v);
+    }
+    const vec3 center     = vec3(scene.globalTransform[n.first] * vec4(0.5f * (vmin + vmax), 1.0f));
+    const glm::ivec3 cell  = size > 0.0f ? glm::ivec3(glm::floor(center / size)) : glm::ivec3(0);
+    cells[{ alphaTested, mesh.materialID, cell.x, cell.y, cell.z }].push_back(n.first);
+  }
+
+  const mat4 rootInverse = glm::inverse(scene.globalTransform[0]);
+
+  std::vector<Mesh> batches;
+  std::vector<uint32_t> batchMaterials; // materialForNode of the new nodes
+  std::vector<uint8_t> vertexData;
+  std::vector<uint32_t> indexData;
+  std::vector<uint32_t> nodesToDelete;
+
+  const uint32_t firstVertex = (uint32_t)(md.vertexData.size() / stride);
+  const uint32_t firstIndex  = (uint32_t)md.indexData.size();
+
+  for (auto& cell : cells) {
+    std::vector<uint32_t>& nodes = cell.second;
+    if (nodes.size() < 2)
+      continue;
+    std::sort(nodes.begin(), nodes.end());
+
+    uint32_t numBatchVertices = 0;
+    bool newBatch             = true;
+    for (uint32_t node : nodes) {
+      const uint32_t meshIndex  = scene.meshForNode.at(node);
+      const Mesh& mesh          = md.meshes[meshIndex];
+      const uint32_t* indices   = md.indexData.data() + mesh.indexOffset;
+      const uint32_t numIndices = mesh.getLODIndicesCount(0);
+      const uint32_t numVerts   = *std::max_element(indices, indices + numIndices) + 1;
+
+      if (newBatch || numBatchVertices + numVerts > 65536) {
+        // LOD generation is off for the batched scenes, every batch has one LOD
+        Mesh batch         = {};
+        batch.lodCount     = 1;
+        batch.indexOffset  = firstIndex + (uint32_t)indexData.size();
+        batch.vertexOffset = firstVertex + (uint32_t)(vertexData.size() / stride);
+        batch.materialID   = std::get<1>(cell.first);
+        batches.push_back(batch);
+        batchMaterials.push_back(scene.materialForNode.contains(node) ? scene.materialForNode.at(node) : mesh.materialID);
+        numBatchVertices = 0;
+        newBatch         = false;
+      }
+
+      // this resolves the assumption of identity transforms in mergeNodesWithMaterial()
+      appendTransformedMesh(md, meshIndex, rootInverse * scene.globalTransform[node], numBatchVertices, vertexData, indexData);
+
+      Mesh& batch = batches.back();
+      numBatchVertices += numVerts;
+      batch.vertexCount = numBatchVertices;
+      batch.lodOffset[1] += numIndices;
+
+      nodesToDelete.push_back(node);
+    }
+  }
+
+  mergeVectors(md.vertexData, vertexData);
+  mergeVectors(md.indexData, indexData);
+
+  std::sort(nodesToDelete.begin(), nodesToDelete.end());
+  deleteSceneNodes(scene, nodesToDelete);
+
+  for (size_t b = 0; b != batches.size(); b++) {
+    const int node              = addNode(scene, 0, 1);
+    scene.meshForNode[node]     = (uint32_t)md.meshes.size();
+    scene.materialForNode[node] = batchMaterials[b];
+    md.meshes.push_back(batches[b]);
+  }
+
+  removeUnusedMeshes(scene, md);
+  markAsChanged(scene, 0);
+  recalculateGlobalTransforms(scene);
+
+  return (uint32_t)batches.size();
+}
+
 void mergeMaterialLists(
     const std::vector<std::vector<Material>*>& oldMaterials, const std::vector<std::vector<std::string>*>& oldTextures,
     std::vector<Material>& allMaterials, std::vector<std::string>& newTextures)
@@ -5,6 +5,27 @@
 
 void mergeNodesWithMaterial(Scene& scene, MeshData& meshData, const std::string& materialName);
 
+// Finds meshes that are rigidly transformed copies of each other (same material, indices and uvs, positions and normals within a
+// tolerance), keeps one copy and moves the transform into the local transforms of the nodes, so the copies can be drawn instanced.
+// Unreferenced vertex and index data is removed. Works on float vertices, i.e. before quantizeVertices(). Returns the number of
+// removed meshes
+uint32_t deduplicateMeshes(Scene& scene, MeshData& meshData);
+
+// Static batching: merges the nodes with the same material whose centers fall into the same cell of a world space grid into one mesh
+// per cell, with the vertices pre-transformed into the space of the root node, so every cell keeps its own bounding box for culling.
+// Only meshes used by a single node are batched, the instanced ones (see deduplicateMeshes()) stay instanced. The alpha-tested nodes,
+// the foliage, are batched apart from the opaque ones in cells of alphaTestedCellSize, small enough to keep the batches replaceable by
+// impostors, and their batches come after the opaque ones. A batch is split before it exceeds 65536 vertices to stay in 16-bit indices.
+// A cell size of 0 uses one cell for the whole scene, a negative one leaves those nodes unbatched. Works on float vertices.
+// Returns the number of batches
+uint32_t batchStaticNodes(Scene& scene, MeshData& meshData, float cellSize, float alphaTestedCellSize);
+
+// Appends the LOD 0 vertices of a mesh with float vertices, with the positions and normals transformed, and its LOD 0 indices offset
+// by baseVertex. Returns the number of appended vertices
+uint32_t appendTransformedMesh(
+    const MeshData& meshData, uint32_t meshIndex, const mat4& transform, uint32_t baseVertex, std::vector<uint8_t>& vertexData,
+    std::vector<uint32_t>& indexData);
+
 // Merge material lists from multiple scenes (follows the logic of merging in mergeScenes)
 void mergeMaterialLists(
     // Input:
@@ -1,5 +1,7 @@
 #include "shared/Scene/VtxData.h"
 
+#include <glm/gtc/packing.hpp>
+
 #include <algorithm>
 #include <assert.h>
 #include <stdio.h>
@@ -21,12 +23,18 @@ bool isMeshDataValid(const char* fileName)
   if (fread(&header, 1, sizeof(header), f) != sizeof(header))
     return false;
 
-  if (fseek(f, sizeof(Mesh) * header.meshCount, SEEK_CUR))
+  if (header.magicValue != kMeshFileMagic)
+    return false;
+
+  if (fseek(f, sizeof(lvk::VertexInput) + sizeof(Mesh) * header.meshCount, SEEK_CUR))
     return false;
 
   if (fseek(f, sizeof(BoundingBox) * header.meshCount, SEEK_CUR))
     return false;
 
+  if ((header.flags & sMeshFileFlags_QuantizedVertices) && fseek(f, sizeof(BoundingBox) * header.meshCount, SEEK_CUR))
+    return false;
+
   if (fseek(f, header.indexDataSize, SEEK_CUR))
     return false;
 
@@ -119,6 +127,15 @@ MeshFileHeader loadMeshData(const char* meshFile, MeshData& out)
     assert(false);
     exit(EXIT_FAILURE);
   }
+  out.vertexBounds.clear();
+  if (header.flags & sMeshFileFlags_QuantizedVertices) {
+    out.vertexBounds.resize(header.meshCount);
+    if (fread(out.vertexBounds.data(), sizeof(BoundingBox), header.meshCount, f) != header.meshCount) {
+      printf("Could not read vertex bounds.\n");
+      assert(false);
+      exit(EXIT_FAILURE);
+    }
+  }
 
   out.indexData.resize(header.indexDataSize / sizeof(uint32_t));
   out.vertexData.resize(header.vertexDataSize);
@@ -190,16 +207,14 @@ void saveMeshData(const char* fileName, const MeshData& m)
     exit(EXIT_FAILURE);
   }
 
-  const MeshFileHeader header = {
-    .meshCount      = (uint32_t)m.meshes.size(),
-    .indexDataSize  = (uint32_t)(m.indexData.size() * sizeof(uint32_t)),
-    .vertexDataSize = (uint32_t)(m.vertexData.size()),
-  };
+  const MeshFileHeader header = m.getMeshFileHeader();
 
   fwrite(&header, 1, sizeof(header), f);
   fwrite(&m.streams, 1, sizeof(m.streams), f);
   fwrite(m.meshes.data(), sizeof(Mesh), header.meshCount, f);
   fwrite(m.boxes.data(), sizeof(BoundingBox), header.meshCount, f);
+  if (m.isQuantized())
+    fwrite(m.vertexBounds.data(), sizeof(BoundingBox), header.meshCount, f);
   fwrite(m.indexData.data(), 1, header.indexDataSize, f);
   fwrite(m.vertexData.data(), 1, header.vertexDataSize, f);
 
@@ -282,23 +297,21 @@ MeshFileHeader mergeMeshData(MeshData& m, const std::vector<MeshData*> md)
 
   for (const MeshData* i : md) {
     LVK_ASSERT(m.streams == i->streams);
+    LVK_ASSERT(i->vertexBounds.size() == (md[0]->isQuantized() ? i->meshes.size() : 0));
     mergeVectors(m.indexData, i->indexData);
     mergeVectors(m.vertexData, i->vertexData);
     mergeVectors(m.meshes, i->meshes);
     mergeVectors(m.boxes, i->boxes);
+    mergeVectors(m.vertexBounds, i->vertexBounds);
 
     for (size_t j = 0; j != i->meshes.size(); j++) {
       // m.vertexCount, m.lodCount and m.streamCount do not change
-      // m.vertexOffset also does not change, because vertex offsets are local (i.e., baked into the indices)
+      // the indices stay relative to the mesh, baseVertex applies the vertex offset when drawing
       m.meshes[offset + j].indexOffset += numTotalIndices;
+      m.meshes[offset + j].vertexOffset += numTotalVertices;
       m.meshes[offset + j].materialID += mtlOffset;
     }
 
-    // shift individual indices
-    for (size_t j = 0; j != i->indexData.size(); j++) {
-      m.indexData[numTotalIndices + j] += numTotalVertices;
-    }
-
     offset += (uint32_t)i->meshes.size();
     mtlOffset += (uint32_t)i->materials.size();
 
@@ -307,23 +320,37 @@ MeshFileHeader mergeMeshData(MeshData& m, const std::vector<MeshData*> md)
   }
 
   return MeshFileHeader{
-    .magicValue     = 0x12345678,
+    .magicValue     = kMeshFileMagic,
     .meshCount      = (uint32_t)offset,
     .indexDataSize  = static_cast<uint32_t>(numTotalIndices * sizeof(uint32_t)),
     .vertexDataSize = static_cast<uint32_t>(m.vertexData.size()),
+    .flags          = m.isQuantized() ? (uint32_t)sMeshFileFlags_QuantizedVertices : 0u,
   };
 }
 
-void recalculateBoundingBoxes(MeshData& m)
+vec3 getVertexPosition(const MeshData& m, uint32_t meshIndex, uint32_t vertex)
 {
-  LVK_ASSERT(m.streams.attributes[0].format == lvk::VertexFormat::Float3);
+  const uint8_t* v = &m.vertexData[vertex * m.streams.getVertexSize()];
+
+  if (!m.isQuantized()) {
+    LVK_ASSERT(m.streams.attributes[0].format == lvk::VertexFormat::Float3);
+    const float* vf = (const float*)v;
+    return vec3(vf[0], vf[1], vf[2]);
+  }
 
-  const uint32_t stride = m.streams.getVertexSize();
+  LVK_ASSERT(m.streams.attributes[0].format == lvk::VertexFormat::UShort4Norm);
+  const uint16_t* q        = (const uint16_t*)v;
+  const BoundingBox& range = m.vertexBounds[meshIndex];
+  return range.min_ + range.getSize() * (vec3(q[0], q[1], q[2]) / 65535.0f);
+}
 
+void recalculateBoundingBoxes(MeshData& m)
+{
   m.boxes.clear();
   m.boxes.reserve(m.meshes.size());
 
-  for (const Mesh& mesh : m.meshes) {
+  for (uint32_t meshIndex = 0; meshIndex != m.meshes.size(); meshIndex++) {
+    const Mesh& mesh          = m.meshes[meshIndex];
     const uint32_t numIndices = mesh.getLODIndicesCount(0);
 
     glm::vec3 vmin(std::numeric_limits<float>::max());
@@ -331,12 +358,154 @@ void recalculateBoundingBoxes(MeshData& m)
 
     for (uint32_t i = 0; i != numIndices; i++) {
       const uint32_t vtxOffset = m.indexData[mesh.indexOffset + i] + mesh.vertexOffset;
-      const float* vf          = (const float*)&m.vertexData[vtxOffset * stride];
+      const vec3 v             = getVertexPosition(m, meshIndex, vtxOffset);
 
-      vmin = glm::min(vmin, vec3(vf[0], vf[1], vf[2]));
-      vmax = glm::max(vmax, vec3(vf[0], vf[1], vf[2]));
+      vmin = glm::min(vmin, v);
+      vmax = glm::max(vmax, v);
     }
 
     m.boxes.emplace_back(vmin, vmax);
   }
 }
+
+namespace
+{
+// 8 bits per axis, decoded by octDecode() in mediumRare/shaders/VertexInput.sp
+uint16_t encodeOctahedral8(vec3 n)
+{
+  const float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+  if (sum < 1e-6f)
+    n = vec3(0.0f, 0.0f, 1.0f);
+  else
+    n /= sum;
+
+  vec2 e(n.x, n.y);
+  if (n.z < 0.0f) {
+    e = vec2((1.0f - fabsf(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - fabsf(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+  }
+  const uint32_t x = (uint32_t)roundf(glm::clamp(e.x * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f);
+  const uint32_t y = (uint32_t)roundf(glm::clamp(e.y * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f);
+  return uint16_t(x | (y << 8));
+}
+} // namespace
+
+bool rebaseMeshIndices(MeshData& m)
+{
+  bool changed = false;
+
+  for (Mesh& mesh : m.meshes) {
+    uint32_t* indices         = m.indexData.data() + mesh.indexOffset;
+    const uint32_t numIndices = mesh.getIndicesCount();
+    if (!numIndices)
+      continue;
+
+    const uint32_t minIndex = *std::min_element(indices, indices + numIndices);
+    if (!minIndex)
+      continue;
+
+    for (uint32_t i = 0; i != numIndices; i++)
+      indices[i] -= minIndex;
+    mesh.vertexOffset += minIndex;
+    changed = true;
+  }
+
+  return changed;
+}
+
+void quantizeVertices(MeshData& m)
+{
+  if (m.isQuantized())
+    return;
+
+  // the layout written by convertAIMesh()
+  LVK_ASSERT(m.streams.attributes[0].format == lvk::VertexFormat::Float3);
+  LVK_ASSERT(m.streams.attributes[1].format == lvk::VertexFormat::HalfFloat2);
+  LVK_ASSERT(m.streams.attributes[2].format == lvk::VertexFormat::Int_2_10_10_10_REV);
+
+  const uint32_t strideIn    = m.streams.getVertexSize();
+  const uint32_t strideOut   = 4 * sizeof(uint16_t) + sizeof(uint32_t);
+  const uint32_t numVertices = (uint32_t)(m.vertexData.size() / strideIn);
+
+  const uint32_t numMeshes   = (uint32_t)m.meshes.size();
+
+  // Vertices are only reachable through the indices of their mesh, every LOD uses a subset of the LOD 0 vertices. A vertex
+  // referenced by several meshes is stored once but dequantized with the bounds of each of them, so meshes sharing vertices
+  // are grouped and every mesh of a group gets the bounds of the whole group
+  std::vector<uint32_t> group(numMeshes);
+  for (uint32_t i = 0; i != numMeshes; i++)
+    group[i] = i;
+  const auto findGroup = [&group](uint32_t i) {
+    while (group[i] != i)
+      i = group[i] = group[group[i]];
+    return i;
+  };
+
+  std::vector<uint32_t> owner(numVertices, ~0u); // the first mesh referencing a vertex
+  std::vector<vec3> vmin(numMeshes, vec3(std::numeric_limits<float>::max()));
+  std::vector<vec3> vmax(numMeshes, vec3(std::numeric_limits<float>::lowest()));
+
+  for (uint32_t mi = 0; mi != numMeshes; mi++) {
+    const Mesh& mesh = m.meshes[mi];
+    for (uint32_t i = mesh.indexOffset, last = mesh.indexOffset + mesh.getIndicesCount(); i != last; i++) {
+      const uint32_t vertex = m.indexData[i] + mesh.vertexOffset;
+      const float* vf       = (const float*)&m.vertexData[vertex * strideIn];
+      vmin[mi]              = glm::min(vmin[mi], vec3(vf[0], vf[1], vf[2]));
+      vmax[mi]              = glm::max(vmax[mi], vec3(vf[0], vf[1], vf[2]));
+      if (owner[vertex] == ~0u)
+        owner[vertex] = mi;
+      else
+        group[findGroup(mi)] = findGroup(owner[vertex]);
+    }
+  }
+  for (uint32_t mi = 0; mi != numMeshes; mi++) {
+    const uint32_t g = findGroup(mi);
+    vmin[g]          = glm::min(vmin[g], vmin[mi]);
+    vmax[g]          = glm::max(vmax[g], vmax[mi]);
+  }
+
+  m.vertexBounds.clear();
+  m.vertexBounds.reserve(numMeshes);
+  for (uint32_t mi = 0; mi != numMeshes; mi++) {
+    const uint32_t g = findGroup(mi);
+    // meshes without indices have no vertices
+    m.vertexBounds.push_back(m.meshes[mi].getIndicesCount() ? BoundingBox(vmin[g], vmax[g]) : BoundingBox(vec3(0.0f), vec3(0.0f)));
+  }
+
+  std::vector<uint8_t> vertices(numVertices * strideOut, 0);
+  for (uint32_t vertex = 0; vertex != numVertices; vertex++) {
+    if (owner[vertex] == ~0u)
+      continue;
+
+    const BoundingBox& range = m.vertexBounds[owner[vertex]];
+    const vec3 size          = range.getSize();
+
+    const uint8_t* in = &m.vertexData[vertex * strideIn];
+    vec3 pos;
+    uint32_t uv, normal;
+    memcpy(&pos, in, sizeof(pos));
+    memcpy(&uv, in + m.streams.attributes[1].offset, sizeof(uv));
+    memcpy(&normal, in + m.streams.attributes[2].offset, sizeof(normal));
+
+    const vec3 t = glm::clamp((pos - range.min_) / glm::max(size, vec3(1e-12f)), 0.0f, 1.0f);
+    const uint16_t q[4] = {
+      (uint16_t)roundf(t.x * 65535.0f),
+      (uint16_t)roundf(t.y * 65535.0f),
+      (uint16_t)roundf(t.z * 65535.0f),
+      encodeOctahedral8(vec3(glm::unpackSnorm3x10_1x2(normal))),
+    };
+    uint8_t* out = &vertices[vertex * strideOut];
+    memcpy(out, q, sizeof(q));
+    memcpy(out + sizeof(q), &uv, sizeof(uv));
+  }
+
+  m.vertexData = std::move(vertices);
+
+  // position + octahedral normal, uv
+  m.streams = {
+    .attributes    = {
+      { .location = 0, .format = lvk::VertexFormat::UShort4Norm, .offset = 0 },
+      { .location = 1, .format = lvk::VertexFormat::HalfFloat2, .offset = 4 * sizeof(uint16_t) }
+    },
+    .inputBindings = { { .stride = strideOut } },
+  };
+}
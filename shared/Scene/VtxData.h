@@ -9,6 +9,14 @@
 
 constexpr const uint32_t kMaxLODs = 7;
 
+// Changes whenever the layout or the preprocessing of the mesh file changes, older files are reported as invalid by isMeshDataValid()
+constexpr const uint32_t kMeshFileMagic = 0x1234567D;
+
+enum MeshFileFlags {
+  // 12-byte vertices, see quantizeVertices(). MeshData::vertexBounds follows the bounding boxes in the file
+  sMeshFileFlags_QuantizedVertices = 0x1,
+};
+
 // All offsets are relative to the beginning of the data block (excluding headers with a Mesh list)
 struct Mesh final {
   // Number of LODs in this mesh. Strictly less than MAX_LODS, last LOD offset is used as a marker only
@@ -29,12 +37,15 @@ struct Mesh final {
 
   inline uint32_t getLODIndicesCount(uint32_t lod) const { return lod < lodCount ? lodOffset[lod + 1] - lodOffset[lod] : 0; }
 
+  // All LODs, starting at indexOffset
+  inline uint32_t getIndicesCount() const { return lodOffset[lodCount] - lodOffset[0]; }
+
   // Any additional information, such as mesh name, can be added here...
 };
 
 struct MeshFileHeader {
   // Unique 64-bit value to check integrity of the file
-  uint32_t magicValue = 0x12345678;
+  uint32_t magicValue = kMeshFileMagic;
 
   // Number of mesh descriptors following this header
   uint32_t meshCount = 0;
@@ -45,6 +56,9 @@ struct MeshFileHeader {
   // How much space vertex data takes in bytes
   uint32_t vertexDataSize = 0;
 
+  // MeshFileFlags
+  uint32_t flags = 0;
+
   // According to your needs, you may add additional metadata fields...
 };
 
@@ -75,14 +89,18 @@ struct MeshData {
   std::vector<uint8_t> vertexData;
   std::vector<Mesh> meshes;
   std::vector<BoundingBox> boxes;
+  // Only with quantized vertices: per mesh, the range the positions are normalized to
+  std::vector<BoundingBox> vertexBounds;
   std::vector<Material> materials;
   std::vector<std::string> textureFiles;
+  bool isQuantized() const { return !vertexBounds.empty(); }
   MeshFileHeader getMeshFileHeader() const
   {
     return {
       .meshCount      = (uint32_t)meshes.size(),
       .indexDataSize  = (uint32_t)(indexData.size() * sizeof(uint32_t)),
       .vertexDataSize = (uint32_t)vertexData.size(),
+      .flags          = isQuantized() ? (uint32_t)sMeshFileFlags_QuantizedVertices : 0u,
     };
   }
 };
@@ -99,6 +117,19 @@ void saveMeshDataMaterials(const char* fileName, const MeshData& m);
 
 void recalculateBoundingBoxes(MeshData& m);
 
+// Makes the smallest index of every mesh 0 and moves the difference into Mesh::vertexOffset (applied as baseVertex when drawing),
+// so the indices of most meshes fit into 16 bits. Returns false if nothing had to change
+bool rebaseMeshIndices(MeshData& m);
+
+// Converts the vertices written by convertAIMesh() (float3 position, half2 uv, 2_10_10_10 normal, 20 bytes) into 12 bytes:
+// UShort4Norm with the position normalized to the bounds of its mesh in xyz and an 8:8 octahedral normal in w, followed by the uv.
+// The shaders dequantize with the per-mesh MeshData::vertexBounds. Meshes sharing vertices share their bounds.
+// LODs have to be generated before, they need float positions
+void quantizeVertices(MeshData& m);
+
+// Object space position of a vertex in either layout. vertex is an index into MeshData::vertexData, i.e. with Mesh::vertexOffset added
+vec3 getVertexPosition(const MeshData& m, uint32_t meshIndex, uint32_t vertex);
+
 // combine a list of meshes to a single mesh container
 MeshFileHeader mergeMeshData(MeshData& m, const std::vector<MeshData*> md);
 
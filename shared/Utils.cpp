@@ -112,14 +112,18 @@ lvk::ShaderStage lvkShaderStageFromFileName(const char* fileName)
   return lvk::Stage_Vert;
 }
 
-lvk::Holder<lvk::ShaderModuleHandle> loadShaderModule(const std::unique_ptr<lvk::IContext>& ctx, const char* fileName) {
-  const std::string code = readShaderFile(fileName);
+lvk::Holder<lvk::ShaderModuleHandle> loadShaderModule(const std::unique_ptr<lvk::IContext>& ctx, const char* fileName, const char* defines) {
+  std::string code = readShaderFile(fileName);
   const lvk::ShaderStage stage = lvkShaderStageFromFileName(fileName);
 
   if (code.empty()) {
     return {};
   }
 
+  if (defines) {
+    code.insert(0, defines);
+  }
+
   lvk::Result res;
 
   lvk::Holder<lvk::ShaderModuleHandle> handle =
@@ -134,6 +138,14 @@ lvk::Holder<lvk::ShaderModuleHandle> loadShaderModule(const std::unique_ptr<lvk:
   return handle;
 }
 
+void cmdUpdateBufferChunked(lvk::ICommandBuffer& buf, lvk::BufferHandle buffer, size_t bufferOffset, size_t size, const void* data)
+{
+  constexpr size_t kMaxUpdateSize = 65536;
+  for (size_t offset = 0; offset < size; offset += kMaxUpdateSize) {
+    buf.cmdUpdateBuffer(buffer, bufferOffset + offset, std::min(kMaxUpdateSize, size - offset), static_cast<const uint8_t*>(data) + offset);
+  }
+}
+
 lvk::Holder<lvk::TextureHandle> loadTexture(
     const std::unique_ptr<lvk::IContext>& ctx, const char* fileName, lvk::TextureType textureType, bool sRGB)
 {
@@ -20,10 +20,16 @@ std::string readShaderFile(const char* fileName);
 
 VkShaderStageFlagBits vkShaderStageFromFileName(const char* fileName);
 
-lvk::Holder<lvk::ShaderModuleHandle> loadShaderModule(const std::unique_ptr<lvk::IContext>& ctx, const char* fileName);
+// defines, e.g. "#define FOO 1\n", are inserted in front of the code; only for shaders without their own #version line
+lvk::Holder<lvk::ShaderModuleHandle> loadShaderModule(
+    const std::unique_ptr<lvk::IContext>& ctx, const char* fileName, const char* defines = nullptr);
 lvk::Holder<lvk::TextureHandle> loadTexture(
     const std::unique_ptr<lvk::IContext>& ctx, const char* fileName, lvk::TextureType textureType = lvk::TextureType_2D, bool sRGB = false);
 
+// cmdUpdateBuffer() in pieces of at most 65536 bytes, the limit of vkCmdUpdateBuffer(). The data is recorded into the command buffer,
+// so the frames still in flight keep reading what was there before. Outside of rendering
+void cmdUpdateBufferChunked(lvk::ICommandBuffer& buf, lvk::BufferHandle buffer, size_t bufferOffset, size_t size, const void* data);
+
 template <typename T> inline void mergeVectors(std::vector<T>& v1, const std::vector<T>& v2)
 {
   v1.insert(v1.end(), v2.begin(), v2.end());
@@ -2,10 +2,41 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <math.h>
 
+#include <algorithm>
+#include <atomic>
+
+// Average FPS over an interval, plus the raw frame times of the last kHistorySize frames:
+// a log-bucketed histogram, percentiles and a hitch detector.
+// Everything lives in fixed-size arrays, tick() never allocates. markPhase() can be called from any thread.
 class FramesPerSecondCounter
 {
 public:
+  static constexpr unsigned int kHistorySize = 512;
+  static constexpr unsigned int kMaxHitches  = 16;
+
+  // 4 buckets per octave starting at kHistogramMinMs, the last bucket also counts everything above
+  static constexpr unsigned int kNumBuckets       = 48;
+  static constexpr unsigned int kBucketsPerOctave = 4;
+  static constexpr float kHistogramMinMs          = 0.25f;
+
+  struct Stats
+  {
+    float p50 = 0.0f;
+    float p90 = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+    float max = 0.0f;
+  };
+
+  struct Hitch
+  {
+    unsigned long long frame = 0;
+    float ms = 0.0f;
+    const char* phase = nullptr;
+  };
+
   explicit FramesPerSecondCounter(float avgInterval = 0.5f)
   : avgInterval_(avgInterval)
   {
@@ -15,7 +46,10 @@ public:
   bool tick(float deltaSeconds, bool frameRendered = true)
   {
     if (frameRendered)
+    {
       numFrames_++;
+      addFrameTime(deltaSeconds * 1000.0f);
+    }
 
     accumulatedTime_ += deltaSeconds;
 
@@ -25,6 +59,10 @@ public:
         printf("FPS: %.1f\n", currentFPS_);
       numFrames_       = 0;
       accumulatedTime_ = 0;
+      updateStats();
+      if (logStats_ && historyCount_)
+        printf("[FRAMES] last %u frames: p50 %.2f ms, p90 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n", historyCount_, stats_.p50, stats_.p90,
+               stats_.p95, stats_.p99, stats_.max);
       return true;
     }
 
@@ -33,11 +71,106 @@ public:
 
   inline float getFPS() const { return currentFPS_; }
 
+  // Names what the frame that is being produced is doing besides rendering (e.g. "MSAA switch", "Texture load"),
+  // reported with the hitch if the frame turns out to be one. The string must outlive the counter (literals).
+  void markPhase(const char* phase) { phase_.store(phase, std::memory_order_relaxed); }
+
+  // For a frame whose time is not measured (e.g. after an idle period): forgets its phase, so that it is not blamed on a later hitch
+  void skipFrame() { phase_.store(nullptr, std::memory_order_relaxed); }
+
+  // Percentiles of the frame times in the history, updated together with the FPS
+  const Stats& getStats() const { return stats_; }
+
+  const unsigned int* getHistogram() const { return histogram_; }
+  static float getBucketMinMs(unsigned int bucket) { return kHistogramMinMs * exp2f(float(bucket) / kBucketsPerOctave); }
+
+  // Raw frame times in milliseconds, oldest first once the ring buffer is full (starting at getHistoryOffset())
+  const float* getHistory() const { return history_; }
+  unsigned int getHistoryCount() const { return historyCount_; }
+  unsigned int getHistoryOffset() const { return historyCount_ == kHistorySize ? historyHead_ : 0; }
+
+  // Last kMaxHitches hitches, the most recent one is getHitch(0)
+  unsigned int getNumHitches() const { return numHitches_ < kMaxHitches ? numHitches_ : kMaxHitches; }
+  unsigned long long getTotalHitches() const { return numHitches_; }
+  const Hitch& getHitch(unsigned int i) const { return hitches_[(numHitches_ - 1 - i) % kMaxHitches]; }
+
   bool printFPS_ = true;
+  bool logHitches_ = true;
+  bool logStats_ = true; // the percentiles, every avgInterval_
+
+  // a frame is a hitch if it is slower than both of these
+  float hitchThresholdMs_ = 33.3f;
+  float hitchMedianFactor_ = 2.0f;
+
+private:
+  static unsigned int getBucket(float ms)
+  {
+    if (ms <= kHistogramMinMs)
+      return 0;
+    const int bucket = int(log2f(ms / kHistogramMinMs) * kBucketsPerOctave);
+    return static_cast<unsigned int>(std::min(bucket, int(kNumBuckets - 1)));
+  }
+
+  void addFrameTime(float ms)
+  {
+    // evict the oldest sample from the histogram
+    if (historyCount_ == kHistorySize)
+      histogram_[getBucket(history_[historyHead_])]--;
+    else
+      historyCount_++;
+
+    history_[historyHead_] = ms;
+    historyHead_ = (historyHead_ + 1) % kHistorySize;
+    histogram_[getBucket(ms)]++;
+
+    const char* phase = phase_.exchange(nullptr, std::memory_order_relaxed);
+
+    // compare against the median of the previous interval, the current one is not computed yet
+    if (ms > hitchThresholdMs_ && (stats_.p50 == 0.0f || ms > hitchMedianFactor_ * stats_.p50))
+    {
+      hitches_[numHitches_ % kMaxHitches] = { frameIndex_, ms, phase ? phase : "Render" };
+      numHitches_++;
+      if (logHitches_)
+        printf("[HITCH] frame %llu: %.2f ms (median %.2f ms), phase: %s\n", frameIndex_, ms, stats_.p50, phase ? phase : "Render");
+    }
+
+    frameIndex_++;
+  }
+
+  void updateStats()
+  {
+    const unsigned int n = historyCount_;
+    if (!n)
+      return;
+
+    std::copy(history_, history_ + n, scratch_);
+    std::sort(scratch_, scratch_ + n);
+
+    const auto percentile = [this, n](float q) { return scratch_[std::min(n - 1, static_cast<unsigned int>(q * n))]; };
+
+    stats_.p50 = percentile(0.50f);
+    stats_.p90 = percentile(0.90f);
+    stats_.p95 = percentile(0.95f);
+    stats_.p99 = percentile(0.99f);
+    stats_.max = scratch_[n - 1];
+  }
 
 public:
   float avgInterval_ = 0.5f;
   unsigned int numFrames_  = 0;
   double accumulatedTime_  = 0;
   float currentFPS_        = 0.0f;
+
+private:
+  float history_[kHistorySize] = {};
+  float scratch_[kHistorySize] = {};
+  unsigned int historyHead_  = 0;
+  unsigned int historyCount_ = 0;
+  unsigned int histogram_[kNumBuckets] = {};
+  Stats stats_;
+
+  std::atomic<const char*> phase_ = nullptr;
+  Hitch hitches_[kMaxHitches] = {};
+  unsigned long long numHitches_ = 0;
+  unsigned long long frameIndex_ = 0;
 };